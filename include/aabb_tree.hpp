@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace kanso {
+
+	class raycast;
+
+	// Dynamic bounding volume hierarchy over world space boxes of user values. Leaves are placed by surface area
+	// and rotated to keep tree balanced, so queries stay logarithmic in any insertion order. Leaves keep a box
+	// enlarged by a margin, objects moving a little stay in their leaf and only ones leaving it are reinserted.
+	class aabb_tree {
+		public:
+			static constexpr int32_t NULL_NODE = -1;
+
+			struct ray_hit {
+				uint32_t value;
+				float    distance; // along ray direction, 0 if ray starts inside
+			};
+
+			// exact distance of value along ray, infinity if ray misses it. Only asked for boxes ray enters at
+			// box_distance nearer than best hit so far
+			using hit_test = std::function<float(uint32_t value, float box_distance)>;
+			using box_test = std::function<bool(const glm::vec3& min, const glm::vec3& max)>;
+
+			// proxy moves or removes box later
+			int32_t insert(const glm::vec3& min, const glm::vec3& max, uint32_t value);
+			void    remove(int32_t proxy);
+			// true if box left its enlarged leaf and was reinserted
+			bool move(int32_t proxy, const glm::vec3& min, const glm::vec3& max);
+			void clear();
+
+			[[nodiscard]] uint32_t value(int32_t proxy) const {
+				return nodes_[static_cast<size_t>(proxy)].value;
+			}
+
+			[[nodiscard]] size_t size() const {
+				return leaves_;
+			}
+
+			// 0 for a single leaf, -1 when empty
+			[[nodiscard]] int32_t height() const {
+				return root_ == NULL_NODE ? -1 : nodes_[static_cast<size_t>(root_)].height;
+			}
+
+			// nearest value along ray, by its box unless test refines it
+			[[nodiscard]] std::optional<ray_hit> nearest_hit(const raycast& ray, const hit_test& test = {}) const;
+			// values whose boxes are hit, in no particular order
+			void all_hits(const raycast& ray, std::vector<uint32_t>& values) const;
+
+			// values whose boxes overlap, in no particular order
+			void overlap_box(const glm::vec3& min, const glm::vec3& max, std::vector<uint32_t>& values) const;
+			void overlap_sphere(const glm::vec3& center, float radius, std::vector<uint32_t>& values) const;
+			// planes as frustum_culler::planes(), normals pointing inside
+			void overlap_frustum(const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& values) const;
+			// values whose boxes pass test, subtrees whose box fails it are skipped
+			void collect(const box_test& test, std::vector<uint32_t>& values) const;
+
+			// up to k values whose boxes are closest to point, nearest first. Boxes around point are at distance 0
+			void nearest(const glm::vec3& point, size_t k, std::vector<uint32_t>& values) const;
+
+		private:
+			struct node {
+				// enlarged for leaves, exact box_min and box_max are what queries answer with
+				glm::vec3 min;
+				glm::vec3 max;
+				glm::vec3 box_min;
+				glm::vec3 box_max;
+				// parent is next free node while node is free, children are null for leaves
+				int32_t  parent = NULL_NODE;
+				int32_t  left   = NULL_NODE;
+				int32_t  right  = NULL_NODE;
+				int32_t  height = 0; // leaves are 0, free nodes -1
+				uint32_t value  = 0;
+
+				[[nodiscard]] bool leaf() const {
+					return left == NULL_NODE;
+				}
+			};
+
+			std::vector<node> nodes_;
+			int32_t           root_   = NULL_NODE;
+			int32_t           free_   = NULL_NODE;
+			size_t            leaves_ = 0;
+
+			int32_t allocate_node();
+			void    release_node(int32_t index);
+
+			void insert_leaf(int32_t leaf);
+			void remove_leaf(int32_t leaf);
+			// from index up to root, rotates unbalanced nodes and recomputes boxes and heights
+			void refit(int32_t index);
+			// rotates taller grandchild up if children of index differ in height by more than one, new subtree root
+			int32_t rotate(int32_t index);
+
+			node& at(int32_t index) {
+				return nodes_[static_cast<size_t>(index)];
+			}
+
+			[[nodiscard]] const node& at(int32_t index) const {
+				return nodes_[static_cast<size_t>(index)];
+			}
+	};
+
+} // namespace kanso
@@ -3,6 +3,7 @@
 #include <string>
 
 #include "window.hpp"
+#include "geometry_arena.hpp"
 #include "loader.hpp"
 #include "event_system.hpp"
 #include "gui.hpp"
@@ -10,7 +11,7 @@
 namespace kanso {
 	class app {
 		public:
-			app(nlohmann::json json);
+			app(scene_description scene);
 
 			// if using opengl this method must be in main thread
 			void run();
@@ -18,6 +19,8 @@ namespace kanso {
 		private:
 			bool                          close_;
 			std::shared_ptr<window>       window_;
+			// mesh geometry, freed after loader and scene drop their meshes and before window ends GL context
+			geometry_arenas               arenas_;
 			std::unique_ptr<loader>       loader_;
 			std::shared_ptr<scene>        scene_;
 			std::shared_ptr<camera>       camera_;
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace kanso {
+
+	// Helpers shared by on-disk caches of cooked assets.
+
+	constexpr uint64_t FNV1A_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+	constexpr uint64_t FNV1A_PRIME        = 0x100000001b3ULL;
+
+	// pass previous result as hash to continue over several buffers
+	uint64_t fnv1a(const uint8_t* bytes, size_t size, uint64_t hash = FNV1A_OFFSET_BASIS);
+
+	// source file modification time and size, entries cooked from it are stale once either changes
+	bool source_stamp(std::string_view path, int64_t& mtime, uint64_t& size);
+
+	// writes aside and renames into place, so concurrent writers and readers never see partial file
+	bool write_file_atomically(const std::string& path, const std::function<void(std::ostream&)>& writer);
+
+	// read-only view of the whole file, mmap'ed where available
+	class mapped_file {
+		public:
+			mapped_file(const std::string& path);
+			~mapped_file();
+
+			mapped_file(const mapped_file&)            = delete;
+			mapped_file& operator=(const mapped_file&) = delete;
+
+			[[nodiscard]] const uint8_t* data() const {
+				return data_;
+			}
+
+			[[nodiscard]] size_t size() const {
+				return size_;
+			}
+
+		private:
+			const uint8_t* data_ = nullptr;
+			size_t         size_ = 0;
+#ifdef _WIN32
+			std::vector<char> buffer_;
+#endif
+	};
+
+	// bounds checked cursor over mapped bytes, any overrun marks the entry as corrupt
+	class byte_reader {
+		public:
+			byte_reader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+			bool read(void* dst, size_t bytes) {
+				if (bytes > size_ - offset_) {
+					return false;
+				}
+				std::memcpy(dst, data_ + offset_, bytes); // NOLINT(*pointer-arithmetic)
+				offset_ += bytes;
+				return true;
+			}
+
+			template <typename T>
+			bool read(T& value) {
+				return read(&value, sizeof(T));
+			}
+
+			bool read(std::string& str, size_t bytes) {
+				if (bytes > size_ - offset_) {
+					return false;
+				}
+				str.resize(bytes);
+				return read(str.data(), bytes);
+			}
+
+			template <typename T>
+			bool read(std::vector<T>& values, size_t count) {
+				if (count > (size_ - offset_) / sizeof(T)) {
+					return false;
+				}
+				values.resize(count);
+				return read(values.data(), count * sizeof(T));
+			}
+
+			[[nodiscard]] size_t offset() const {
+				return offset_;
+			}
+
+		private:
+			const uint8_t* data_;
+			size_t         size_;
+			size_t         offset_ = 0;
+	};
+
+	template <typename T>
+	void write(std::ostream& out, const T& value) {
+		out.write(reinterpret_cast<const char*>(&value), sizeof(T)); // NOLINT(*reinterpret-cast)
+	}
+
+	template <typename T>
+	void write(std::ostream& out, const std::vector<T>& values) {
+		out.write(reinterpret_cast<const char*>(values.data()), // NOLINT(*reinterpret-cast)
+		          static_cast<std::streamsize>(values.size() * sizeof(T)));
+	}
+
+} // namespace kanso
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace kanso {
+
+	// BCn block formats, every block covers 4x4 texels
+	enum class block_format : uint32_t { bc1, bc3, bc4, bc5, bc7 };
+
+	// texture with every mip level already encoded, level 0 is full resolution
+	struct compressed_texture {
+		block_format                      format{};
+		int                               width{};
+		int                               height{};
+		int                               nr_channels{}; // channels of source image
+		std::vector<std::vector<uint8_t>> levels;
+
+		[[nodiscard]] size_t size() const;
+	};
+
+	// BC1 for RGB, BC3 or BC7 for RGBA, BC4 for grey and BC5 for grey with alpha
+	block_format pick_block_format(int nr_channels, bool allow_bc7);
+
+	size_t block_bytes(block_format format);
+
+	// rgba holds width * height RGBA8 texels, blocks are returned row by row
+	std::vector<uint8_t> compress_blocks(const uint8_t* rgba, int width, int height, block_format format);
+
+	namespace bc {
+
+		// texels are 16 RGBA8 values of one block
+		void encode_bc1(const uint8_t* texels, uint8_t* out);
+		void encode_bc3(const uint8_t* texels, uint8_t* out);
+		void encode_bc4(const uint8_t* texels, uint8_t* out, int channel = 0);
+		void encode_bc5(const uint8_t* texels, uint8_t* out);
+		void encode_bc7(const uint8_t* texels, uint8_t* out);
+
+	} // namespace bc
+
+} // namespace kanso
@@ -1,13 +1,27 @@
 #pragma once
 
+#include <cstddef>
 #include <map>
 
 namespace kanso {
-	constexpr char const* DEFAULT_SCENE_PATH    = "scene/default_scene.json";
-	constexpr int         DEFAULT_WINDOW_WIDTH  = 800;
-	constexpr int         DEFAULT_WINDOW_HEIGHT = 600;
-	constexpr char const* DEFAULT_WINDOW_TITLE  = "Kanso Engine";
-	constexpr char const* DEFAULT_CONFIG_PATH   = "cfg/window.json";
+	constexpr char const* DEFAULT_SCENE_PATH         = "scene/default_scene.json";
+	constexpr int         DEFAULT_WINDOW_WIDTH       = 800;
+	constexpr int         DEFAULT_WINDOW_HEIGHT      = 600;
+	constexpr char const* DEFAULT_WINDOW_TITLE       = "Kanso Engine";
+	constexpr char const* DEFAULT_CONFIG_PATH        = "cfg/window.json";
+	constexpr char const* DEFAULT_MODEL_CACHE_PATH   = "cache/models";
+	constexpr char const* DEFAULT_TEXTURE_CACHE_PATH = "cache/textures";
+	constexpr char const* DEFAULT_SHADER_CACHE_PATH  = "cache/shaders";
+	constexpr size_t      DEFAULT_UPLOAD_BUDGET      = 16 * 1024 * 1024; // bytes uploaded to GPU per frame
+	constexpr float       DEFAULT_LOD_SCREEN_ERROR   = 0.002f; // max LOD error as fraction of viewport height
+	constexpr float       DEFAULT_CULL_SCREEN_SIZE   = 0.0f;   // smaller objects are culled, 0 keeps all in view
+	constexpr unsigned    LIGHTS_BLOCK_BINDING       = 0;      // uniform buffer binding of Lights block
+	constexpr unsigned    CAMERA_BLOCK_BINDING       = 1;      // and of Camera block
+	constexpr unsigned    CULL_BLOCK_BINDING         = 2;      // and of CullParams block
+	constexpr unsigned    DEPTH_PYRAMID_UNIT         = 12;
+	constexpr unsigned    LIGHT_DATA_UNIT            = 13;     // texture units kept free of material textures
+	constexpr unsigned    CLUSTER_GRID_UNIT          = 14;
+	constexpr unsigned    LIGHT_INDEX_UNIT           = 15;
 
 	using uint = unsigned int;
 
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "core.hpp"
+
+namespace kanso {
+
+	// frames CPU may run ahead of GPU before writing a region waits
+	constexpr size_t DEFAULT_RING_FRAMES = 3;
+
+	// waits on fences, counted since ring was created
+	struct ring_stats {
+		uint64_t frames     = 0;
+		uint64_t stalls     = 0;   // frames whose region was still read by GPU
+		double   stall_ms   = 0.0; // total time spent waiting
+		size_t   peak_bytes = 0;   // most bytes allocated in one frame
+	};
+
+	// Upload buffer for data rewritten every frame, split into one region per frame in flight. Each region is
+	// fenced after the draws reading it and written again only once its fence signaled, so CPU writes straight
+	// into GL memory and never races GPU or waits on a driver copy. With ARB_buffer_storage the buffer stays
+	// mapped persistent and coherent for its whole life. On plain GL 4.1 the region of a frame is mapped
+	// unsynchronized instead, the fences keep that safe, and must be unmapped by flush() before drawing.
+	class dynamic_ring {
+		public:
+			// slice of current region, offset is from start of buffer()
+			struct allocation {
+				std::byte* data   = nullptr;
+				size_t     offset = 0;
+			};
+
+			explicit dynamic_ring(size_t region_size);
+			~dynamic_ring();
+
+			dynamic_ring(const dynamic_ring&)            = delete;
+			dynamic_ring& operator=(const dynamic_ring&) = delete;
+			dynamic_ring(dynamic_ring&&)                 = delete;
+			dynamic_ring& operator=(dynamic_ring&&)      = delete;
+
+			// moves to next region and waits until GPU is done with it, regions grow to min_size first
+			void begin_frame(size_t min_size = 0);
+			// alignment must be a power of two, data is nullptr if region has no room left
+			[[nodiscard]] allocation allocate(size_t size, size_t alignment);
+			// makes writes of this frame visible to GL, must come before draws reading them
+			void flush();
+			// fences region after last draw reading it
+			void end_frame();
+
+			// may change in begin_frame() when regions grow
+			[[nodiscard]] uint buffer() const {
+				return buffer_;
+			}
+
+			[[nodiscard]] bool persistent() const {
+				return persistent_;
+			}
+
+			[[nodiscard]] const ring_stats& stats() const {
+				return stats_;
+			}
+
+		private:
+			std::array<void*, DEFAULT_RING_FRAMES> fences_{}; // GLsync of every region, null when not in flight
+			uint                                   buffer_      = 0;
+			std::byte*                             mapped_      = nullptr; // whole buffer when persistent
+			size_t                                 region_size_ = 0;
+			size_t                                 region_      = 0;
+			size_t                                 used_        = 0; // bytes allocated in current region
+			bool                                   persistent_  = false;
+			bool                                   in_frame_    = false;
+			ring_stats                             stats_;
+
+			void create(size_t region_size);
+			void destroy();
+			void wait(size_t region);
+	};
+
+} // namespace kanso
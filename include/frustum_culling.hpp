@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace kanso {
+
+	class thread_pool;
+
+	// boxes tested per iteration, box lists are padded to a multiple of it
+	constexpr size_t CULL_BATCH = 8;
+
+	// axis aligned boxes as center and half extent, one array per component
+	struct box_list {
+		std::vector<float> center_x, center_y, center_z;
+		std::vector<float> extent_x, extent_y, extent_z;
+		size_t             count = 0;
+
+		void clear();
+		void push(const glm::vec3& min, const glm::vec3& max);
+		// min and max corner of box index
+		[[nodiscard]] std::pair<glm::vec3, glm::vec3> box(size_t index) const;
+	};
+
+	// box around local box min, max moved by matrix
+	[[nodiscard]] std::pair<glm::vec3, glm::vec3> transform_box(const glm::mat4& matrix, const glm::vec3& min,
+	                                                            const glm::vec3& max);
+
+	// boxes kept and dropped during one frame
+	struct cull_stats {
+		size_t models_visible  = 0;
+		size_t models_culled   = 0;
+		size_t models_occluded = 0; // in frustum but hidden behind occluders, not counted as visible
+		size_t meshes_visible  = 0;
+		size_t meshes_culled   = 0;
+	};
+
+	// Tests world space boxes against the six planes of a view frustum, CULL_BATCH boxes at a time. Boxes
+	// smaller than min_screen_size of viewport height can be dropped too, 0 keeps every box in frustum.
+	class frustum_culler {
+		public:
+			frustum_culler(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camera_pos,
+			               float min_screen_size = 0.0f);
+
+			// visible[i] is 1 if box i is kept, returns number of kept boxes. Large lists are split over pool.
+			size_t cull(const box_list& boxes, std::vector<uint8_t>& visible, thread_pool* pool = nullptr) const;
+
+			[[nodiscard]] cull_stats& stats() {
+				return stats_;
+			}
+
+			// inside where dot(xyz, plane) + w >= 0, normals have unit length
+			[[nodiscard]] const std::array<glm::vec4, 6>& planes() const {
+				return planes_;
+			}
+
+		private:
+			std::array<glm::vec4, 6> planes_{};
+			glm::vec3                camera_pos_;
+			float                    screen_scale_sq_ = 0.0f; // (proj[1][1] / min_screen_size)^2, 0 if disabled
+			cull_stats               stats_;
+
+			// bit i is set if box first + i is kept
+			[[nodiscard]] uint32_t batch_mask(const box_list& boxes, size_t first) const;
+	};
+
+} // namespace kanso
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <optional>
+
+#include "renderer.hpp"
+
+namespace kanso {
+
+	// First fit allocator of ranges in [0, capacity), neighbouring free ranges are merged on release
+	class range_allocator {
+		public:
+			explicit range_allocator(size_t capacity);
+
+			// offset of new range, nothing if no free range is large enough
+			[[nodiscard]] std::optional<size_t> allocate(size_t size);
+			void                                release(size_t offset, size_t size);
+
+			// adds free space at end
+			void grow(size_t capacity);
+
+			[[nodiscard]] size_t capacity() const {
+				return capacity_;
+			}
+
+		private:
+			std::map<size_t, size_t> free_; // offset to size
+			size_t                   capacity_;
+	};
+
+	class geometry_arena;
+
+	// Owner of arenas geometry_arena::get() hands out, their GL objects are deleted with it. Only one may exist at
+	// a time, it has to be created after GL context and destroyed before it, once every mesh using arenas is gone.
+	class geometry_arenas {
+		public:
+			geometry_arenas();
+			~geometry_arenas();
+
+			geometry_arenas(const geometry_arenas&)            = delete;
+			geometry_arenas& operator=(const geometry_arenas&) = delete;
+			geometry_arenas(geometry_arenas&&)                 = delete;
+			geometry_arenas& operator=(geometry_arenas&&)      = delete;
+
+		private:
+			friend class geometry_arena;
+
+			// by vertex format and index type
+			std::array<std::unique_ptr<geometry_arena>, 4> arenas_;
+	};
+
+	// One vertex array over vertex and index buffers shared by many meshes. Every arena holds a single vertex
+	// format and index type, so any of its meshes can be drawn without binding another vertex array, and several
+	// at once with one multi draw. Buffers double when full and are copied on GPU.
+	class geometry_arena {
+		public:
+			// ranges in vertices and indices
+			struct allocation {
+				size_t first_vertex = 0;
+				size_t vertex_count = 0;
+				size_t first_index  = 0;
+				size_t index_count  = 0;
+			};
+
+			// arena of format and index type, created on first use in current geometry_arenas. Must be called from
+			// thread owning GL context
+			static geometry_arena& get(vertex_format format, uint index_type);
+
+			~geometry_arena();
+
+			geometry_arena(const geometry_arena&)            = delete;
+			geometry_arena& operator=(const geometry_arena&) = delete;
+			geometry_arena(geometry_arena&&)                 = delete;
+			geometry_arena& operator=(geometry_arena&&)      = delete;
+
+			// copies vertices in arena's format and indices of its type into arena
+			allocation allocate(const void* vertices, size_t vertex_count, const void* indices, size_t index_count);
+			void       release(const allocation& range);
+
+			[[nodiscard]] uint vertex_array() const {
+				return vao_;
+			}
+
+			[[nodiscard]] uint index_type() const {
+				return index_type_;
+			}
+
+		private:
+			geometry_arena(vertex_format format, uint index_type);
+
+			vertex_format   format_;
+			uint            index_type_;
+			size_t          vertex_stride_;
+			size_t          index_stride_;
+			uint            vao_ = 0;
+			uint            vbo_ = 0;
+			uint            ebo_ = 0;
+			range_allocator vertices_;
+			range_allocator indices_;
+
+			// replaces buffer with one of new_capacity elements, keeping its first old_capacity elements
+			static uint grow_buffer(uint buffer, size_t old_capacity, size_t new_capacity, size_t stride);
+			size_t      reserve(range_allocator& ranges, uint& buffer, size_t stride, size_t count);
+			void        bind_buffers();
+	};
+
+	// Mesh geometry living in geometry_arena. Ranges passed to draws are relative to mesh, base_index() and
+	// base_vertex() place them in arena.
+	class arena_renderer : public opengl_renderer {
+		public:
+			arena_renderer(const std::vector<mesh_vertex>& vertices, const std::vector<int>& indices,
+			               vertex_format format = DEFAULT_VERTEX_FORMAT);
+			~arena_renderer() override;
+
+			arena_renderer(const arena_renderer&)            = delete;
+			arena_renderer& operator=(const arena_renderer&) = delete;
+			arena_renderer(arena_renderer&&)                 = delete;
+			arena_renderer& operator=(arena_renderer&&)      = delete;
+
+			void draw_triangles() override;
+			void draw_triangles(size_t first_index, size_t index_count) override;
+			void bind() override;
+			void draw_bound(size_t first_index, size_t index_count) override;
+			void draw_bound_instanced(size_t first_index, size_t index_count, size_t instances) override;
+			uint vertex_array() const override;
+
+			vertex_layout layout() const override;
+			size_t        base_index() const override;
+			int           base_vertex() const override;
+			uint          index_type() const override;
+
+		private:
+			geometry_arena*            arena_;
+			geometry_arena::allocation allocation_;
+			vertex_layout              layout_;
+	};
+
+} // namespace kanso
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "core.hpp"
+#include "shader.hpp"
+
+namespace kanso {
+
+	// Frustum and occlusion culling of multi draw instances in compute shaders. Every instance carries its
+	// world box and the indirect command drawing it. shaders/cull.comp drops boxes outside frustum or behind
+	// the depth pyramid of previous frame, and appends the rest to their command: it bumps instance count and
+	// copies instance data to base instance plus slot in instance_buffer(). Commands therefore start with zero
+	// instances and base instances reserving room for all of them. shaders/hiz.comp rebuilds pyramid from
+	// depth buffer once a frame is drawn. Boxes appearing from behind an occluder show up one frame late.
+	class gpu_culler {
+		public:
+			// world box of instance, command is index of indirect command drawing it
+			struct instance_bounds {
+				glm::vec3 min;
+				uint32_t  command;
+				glm::vec3 max;
+				uint32_t  padding;
+			};
+
+			// std140 layout of CullParams block
+			struct cull_params {
+				glm::mat4                occlusion_view_proj; // matrix pyramid was drawn with
+				std::array<glm::vec4, 6> planes;              // frustum of this frame
+				glm::vec4                pyramid;             // width, height, levels, 1 once it holds a frame
+				glm::uvec4               counts;              // instances
+			};
+
+			// buffers of one cull() call, offsets are from start of buffer
+			struct cull_input {
+				uint   buffer;
+				size_t params_offset;
+				size_t bounds_offset;
+				size_t instances_offset;
+				size_t commands_offset;
+				size_t instance_count;
+				size_t command_count;
+			};
+
+			// true if context offers compute shaders, storage buffers, immutable textures and multi draw
+			// indirect with base instance, as every GL 4.3 context does
+			static bool supported();
+
+			gpu_culler();
+			~gpu_culler();
+
+			gpu_culler(const gpu_culler&)            = delete;
+			gpu_culler& operator=(const gpu_culler&) = delete;
+			gpu_culler(gpu_culler&&)                 = delete;
+			gpu_culler& operator=(gpu_culler&&)      = delete;
+
+			[[nodiscard]] cull_params params(const glm::mat4& view, const glm::mat4& proj,
+			                                 size_t instance_count) const;
+
+			// fills instance_buffer() and instance counts of commands, must come before draws reading them
+			void cull(const cull_input& input);
+
+			// reduces depth of default framebuffer into pyramid tested by next cull()
+			void build_pyramid(const glm::mat4& view, const glm::mat4& proj);
+
+			// storage buffer ranges must start at multiples of it
+			[[nodiscard]] size_t storage_alignment() const {
+				return storage_alignment_;
+			}
+
+			[[nodiscard]] uint instance_buffer() const {
+				return instance_buffer_;
+			}
+
+		private:
+			uint         cull_program_      = 0;
+			uint         pyramid_program_   = 0;
+			uniform<int> source_level_;
+			uniform<int> copy_depth_;
+			uint         instance_buffer_   = 0;
+			size_t       instance_capacity_ = 0; // in instances
+			uint         depth_fbo_         = 0;
+			uint         depth_texture_     = 0; // copy of default framebuffer's depth
+			uint         pyramid_           = 0;
+			int          width_             = 0;
+			int          height_            = 0;
+			int          levels_            = 0;
+			bool         pyramid_valid_     = false;
+			glm::mat4    pyramid_view_proj_{ 1.0f };
+			size_t       storage_alignment_ = 0;
+
+			void resize(int width, int height);
+			void release_textures();
+	};
+
+} // namespace kanso
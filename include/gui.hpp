@@ -11,7 +11,7 @@ namespace kanso {
 
 	class gui {
 		public:
-			gui(const std::shared_ptr<const window>& w, const std::shared_ptr<const scene>& scene);
+			gui(const std::shared_ptr<const window>& w, const std::shared_ptr<scene>& scene);
 			virtual ~gui() = default;
 
 			virtual void draw();
@@ -28,13 +28,13 @@ namespace kanso {
 
 		protected:
 			bool enable_draw_ = true;
-			std::shared_ptr<const scene> scene_;
+			std::shared_ptr<scene> scene_;
 			bool char_input_ = false;
 	};
 
 	class opengl_gui : public gui {
 		public:
-			opengl_gui(const std::shared_ptr<const window>& w, const std::shared_ptr<const scene>& scene);
+			opengl_gui(const std::shared_ptr<const window>& w, const std::shared_ptr<scene>& scene);
 			~opengl_gui() override;
 
 			void draw() override;
@@ -51,6 +51,6 @@ namespace kanso {
 	};
 
 	namespace gui_factory {
-		std::unique_ptr<gui> make_gui(const std::shared_ptr<window>& window, const std::shared_ptr<const scene>& scene);
+		std::unique_ptr<gui> make_gui(const std::shared_ptr<window>& window, const std::shared_ptr<scene>& scene);
 	};
 } // namespace kanso
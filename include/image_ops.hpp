@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace kanso {
+
+	struct rgba_image {
+		int                  width{};
+		int                  height{};
+		std::vector<uint8_t> pixels;
+	};
+
+	// widens 1-4 channel image to RGBA8, grey is replicated to RGB, missing alpha is opaque
+	rgba_image expand_to_rgba(const uint8_t* pixels, int width, int height, int nr_channels);
+
+	// next mip level with 2x2 box filter, odd edges are clamped
+	rgba_image downsample(const rgba_image& image);
+
+	// every level down to 1x1, level 0 is image itself
+	std::vector<rgba_image> build_mip_chain(rgba_image image);
+
+} // namespace kanso
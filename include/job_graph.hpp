@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace kanso {
+
+	class thread_pool;
+
+	// Jobs with dependencies scheduled on thread_pool. Node starts as soon as every node it depends on is done.
+	// Running nodes may add new nodes and make not yet started nodes wait for them, which is how stages whose
+	// fan out is known only at run time (e.g. one job per mesh of a file) are expressed.
+	class job_graph {
+		public:
+			using node_id = size_t;
+
+			struct timing {
+				std::string                         name;
+				std::chrono::steady_clock::duration start{}; // since graph creation
+				std::chrono::steady_clock::duration duration{};
+			};
+
+			explicit job_graph(thread_pool& pool);
+			~job_graph();
+
+			job_graph(const job_graph&)            = delete;
+			job_graph& operator=(const job_graph&) = delete;
+			job_graph(job_graph&&)                 = delete;
+			job_graph& operator=(job_graph&&)      = delete;
+
+			// work must not throw, exceptions are logged and node counts as done
+			node_id add(std::string name, std::function<void()> work, std::initializer_list<node_id> dependencies = {});
+			node_id add(std::string name, std::function<void()> work, const std::vector<node_id>& dependencies);
+
+			// node must not have started yet, e.g. it depends on the node calling this
+			void depend(node_id id, node_id dependency);
+
+			// blocks until every node is done, calling thread runs pool jobs meanwhile
+			void wait();
+
+			// chain of nodes that decided when the last node finished, first node first
+			[[nodiscard]] std::vector<timing> critical_path() const;
+
+		private:
+			struct node {
+				std::string                           name;
+				std::function<void()>                 work;
+				std::vector<node_id>                  successors;
+				size_t                                remaining{}; // unfinished dependencies, +1 until added
+				bool                                  done{};
+				node_id                               critical{}; // dependency that finished last
+				bool                                  has_critical{};
+				std::chrono::steady_clock::time_point start;
+				std::chrono::steady_clock::time_point end;
+			};
+
+			thread_pool&                          pool_;
+			std::deque<node>                      nodes_; // stable addresses while graph grows
+			size_t                                unfinished_ = 0;
+			std::chrono::steady_clock::time_point created_  = std::chrono::steady_clock::now();
+			mutable std::mutex                    mut_;
+			std::condition_variable               finished_;
+
+			// both expect mut_ to be held
+			void add_dependency(node_id id, node_id dependency);
+			void finish_dependency(node_id id, node_id dependency, std::vector<node_id>& ready);
+
+			void schedule(const std::vector<node_id>& ready);
+			void run(node_id id);
+	};
+
+} // namespace kanso
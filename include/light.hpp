@@ -1,11 +1,17 @@
 #pragma once
 
+#include <cstdint>
+
 #include <glm/ext/vector_float3.hpp>
 
 #include "core.hpp"
 
 namespace kanso {
 
+	struct gpu_light;
+
+	enum class light_type { directional, point, spot };
+
 	struct light_data {
 		glm::vec3 ambient{};
 		glm::vec3 diffuse{};
@@ -18,15 +24,30 @@ namespace kanso {
 			light(light_data&& common_part);
 			virtual ~light() = default;
 
-			virtual void bind_to(uint shader) const = 0;
+			[[nodiscard]] virtual light_type type() const = 0;
+
+			virtual void pack(gpu_light& out) const = 0;
+
+			// distance at which light no longer changes 8 bit output, infinite for directional lights
+			[[nodiscard]] virtual float range() const = 0;
+
+			void set_common_data(const light_data& common_part);
+
+			// bumped on every change, light_buffer re-uploads lights whose revision it has not seen
+			[[nodiscard]] uint64_t revision() const {
+				return revision_;
+			}
 
 		protected:
 			[[nodiscard]] const light_data& common_data() const {
 				return common_part_;
 			}
 
+			void touch();
+
 		private:
 			light_data common_part_;
+			uint64_t   revision_;
 	};
 
 	struct point_light_data {
@@ -41,7 +62,14 @@ namespace kanso {
 			point_light(const light_data& common_part, const point_light_data& point_light_part);
 			point_light(light_data&& common_part, point_light_data&& point_light_part);
 
-			void bind_to(uint shader) const override;
+			[[nodiscard]] light_type type() const override {
+				return light_type::point;
+			}
+
+			void  pack(gpu_light& out) const override;
+			float range() const override;
+
+			void set_point_data(const point_light_data& point_light_part);
 
 		private:
 			point_light_data point_light_part_;
@@ -52,7 +80,14 @@ namespace kanso {
 			directional_light(const light_data& common, const glm::vec3& direction);
 			directional_light(light_data&& common, glm::vec3&& direction);
 
-			void bind_to(uint shader) const override;
+			[[nodiscard]] light_type type() const override {
+				return light_type::directional;
+			}
+
+			void  pack(gpu_light& out) const override;
+			float range() const override;
+
+			void set_direction(const glm::vec3& direction);
 
 		private:
 			glm::vec3 direction_;
@@ -61,8 +96,8 @@ namespace kanso {
 	struct spot_light_data {
 		point_light_data point_light_part;
 		glm::vec3        direction{};
-		float            inner_cut_off{};
-		float            outer_cut_off{};
+		float            inner_cut_off{}; // degrees
+		float            outer_cut_off{}; // degrees
 	};
 
 	class spot_light : public light {
@@ -70,7 +105,14 @@ namespace kanso {
 			spot_light(const light_data& common_part, const spot_light_data& spot_light_part);
 			spot_light(light_data&& common_part, spot_light_data&& spot_light_part);
 
-			void bind_to(uint shader) const override;
+			[[nodiscard]] light_type type() const override {
+				return light_type::spot;
+			}
+
+			void  pack(gpu_light& out) const override;
+			float range() const override;
+
+			void set_spot_data(const spot_light_data& spot_light_part);
 
 		private:
 			spot_light_data spot_light_part_;
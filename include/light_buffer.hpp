@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "core.hpp"
+#include "dynamic_ring.hpp"
+#include "light_clusters.hpp"
+
+namespace kanso {
+
+	class light;
+	class thread_pool;
+
+	// directional lights live in Lights block, point and spot lights in texture buffer, shaders/default.frag
+	// declares the same capacities
+	constexpr size_t MAX_DIRECTIONAL_LIGHTS = 4;
+	constexpr size_t MAX_LOCAL_LIGHTS       = 4096; // indices are 16 bit
+
+	// Any light as five vec4s, scalars ride in w. Points carry a cone wider than any direction, so shader
+	// handles them like spots
+	struct gpu_light {
+		glm::vec4 pos;       // w is constant attenuation
+		glm::vec4 ambient;   // w is linear attenuation
+		glm::vec4 diffuse;   // w is quadratic attenuation
+		glm::vec4 specular;  // w is cosine of outer cut off
+		glm::vec4 direction; // w is cosine of inner cut off
+	};
+
+	// std140 layout of Lights block
+	struct light_block {
+		glm::ivec4                                    counts;         // directional, local
+		glm::ivec4                                    cluster_dims;   // x, y, z
+		glm::vec4                                     cluster_depth;  // scale, bias, near, far
+		glm::vec4                                     cluster_screen; // clusters per pixel in x and y
+		std::array<gpu_light, MAX_DIRECTIONAL_LIGHTS> directional;
+	};
+
+	// Lights of the scene for clustered forward shading. update() packs lights once per frame and uploads only
+	// point and spot lights that changed or moved to another slot, then assigns them to view clusters. Lights
+	// block is written whole into a dynamic_ring region every frame. Fragments find their cluster's range in grid
+	// buffer and loop over its entries of index buffer.
+	class light_buffer {
+		public:
+			explicit light_buffer(thread_pool& pool);
+			~light_buffer();
+
+			light_buffer(const light_buffer&)            = delete;
+			light_buffer& operator=(const light_buffer&) = delete;
+			light_buffer(light_buffer&&)                 = delete;
+			light_buffer& operator=(light_buffer&&)      = delete;
+
+			// lights beyond capacity are dropped with a warning, width and height are framebuffer size in pixels
+			// must be called from thread owning GL context
+			void update(const std::vector<std::shared_ptr<light>>& lights, const glm::mat4& view,
+			            const glm::mat4& proj, int width, int height);
+			// fences Lights block of this frame, must come after last draw reading it
+			void end_frame();
+
+		private:
+			// what slot held last time it was uploaded
+			struct slot_state {
+				const light* source   = nullptr;
+				uint64_t     revision = 0;
+
+				[[nodiscard]] bool holds(const light& light) const;
+			};
+
+			// buffer viewed by shaders as samplerBuffer
+			struct texture_buffer {
+				uint buffer  = 0;
+				uint texture = 0;
+			};
+
+			dynamic_ring   ring_; // Lights block of every frame in flight
+			texture_buffer local_lights_;
+			texture_buffer grid_;
+			texture_buffer indices_;
+			size_t         max_indices_ = 0;
+
+			light_block                block_{};
+			std::vector<gpu_light>     locals_; // copy of local lights buffer
+			std::vector<slot_state>    uploaded_directional_;
+			std::vector<slot_state>    uploaded_local_;
+			std::vector<float>         ranges_; // per local slot
+			std::vector<cluster_light> view_lights_;
+			light_clusters             clusters_;
+			bool                       overflow_reported_         = false;
+			bool                       cluster_overflow_reported_ = false;
+			bool                       in_frame_                  = false;
+
+			void bind_textures() const;
+	};
+
+} // namespace kanso
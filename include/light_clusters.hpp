@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace kanso {
+
+	class thread_pool;
+
+	// view frustum is split into CLUSTER_X * CLUSTER_Y screen tiles and CLUSTER_Z exponential depth slices
+	constexpr uint32_t CLUSTER_X     = 16;
+	constexpr uint32_t CLUSTER_Y     = 9;
+	constexpr uint32_t CLUSTER_Z     = 24;
+	constexpr uint32_t CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+
+	// point or spot light in view space, points have cos_outer below -1 so their cone covers everything
+	struct cluster_light {
+		glm::vec3 pos;
+		float     radius;
+		glm::vec3 direction;
+		float     cos_outer;
+	};
+
+	// slice of index list holding lights of one cluster
+	struct cluster_range {
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	// Assigns lights to clusters of view frustum, so fragments loop only over lights near them. Each depth slice
+	// is one job on pool, spheres are tested against cluster bounds four lights at a time.
+	class light_clusters {
+		public:
+			explicit light_clusters(thread_pool& pool);
+
+			// proj has to come from glm::perspective, cluster bounds are rebuilt whenever it changes.
+			// Lights past max_indices references in total are dropped
+			void build(const glm::mat4& proj, const std::vector<cluster_light>& lights, size_t max_indices);
+
+			// one range per cluster, cluster (x, y, z) is at x + y * CLUSTER_X + z * CLUSTER_X * CLUSTER_Y
+			[[nodiscard]] const std::vector<cluster_range>& grid() const {
+				return grid_;
+			}
+
+			[[nodiscard]] const std::vector<uint16_t>& indices() const {
+				return indices_;
+			}
+
+			// slice of view depth d is floor(log(d) * depth_scale() + depth_bias())
+			[[nodiscard]] float depth_scale() const {
+				return depth_scale_;
+			}
+
+			[[nodiscard]] float depth_bias() const {
+				return depth_bias_;
+			}
+
+			[[nodiscard]] float near() const {
+				return near_;
+			}
+
+			[[nodiscard]] float far() const {
+				return far_;
+			}
+
+			// true if last build() had to drop lights
+			[[nodiscard]] bool overflowed() const {
+				return overflowed_;
+			}
+
+		private:
+			struct cluster_bounds {
+				glm::vec3 min;
+				glm::vec3 max;
+			};
+
+			// lights touching one depth slice, SoA and padded to multiple of 4 for SIMD
+			struct slice_lights {
+				std::vector<float>    x, y, z, radius_sq;
+				std::vector<uint16_t> index;
+			};
+
+			thread_pool&                       pool_;
+			glm::mat4                          proj_{ 0.0f };
+			float                              near_        = 0.0f;
+			float                              far_         = 0.0f;
+			float                              depth_scale_ = 0.0f;
+			float                              depth_bias_  = 0.0f;
+			std::vector<cluster_bounds>        bounds_;
+			std::vector<slice_lights>          slices_;
+			std::vector<std::vector<uint16_t>> slice_indices_;
+			std::vector<cluster_range>         grid_;
+			std::vector<uint16_t>              indices_;
+			bool                               overflowed_ = false;
+
+			void rebuild_bounds(const glm::mat4& proj);
+			void build_slice(uint32_t z, const std::vector<cluster_light>& lights);
+	};
+
+} // namespace kanso
@@ -1,17 +1,25 @@
 #pragma once
 
 #include "model.hpp"
-#include "primitive.hpp"
+#include "renderer.hpp"
 #include "model_data_loader.hpp"
 
 namespace kanso {
 
+	// exact hit of a ray on a loaded model
+	struct model_hit {
+		size_t            mesh; // index in model_data meshes
+		triangle_bvh::hit triangle;
+	};
+
 	class loaded_model : public scene_model {
 		public:
-			void draw(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camera_pos) const override;
+			void enqueue(render_queue& queue, frustum_culler& culler, const glm::mat4& proj,
+			             const glm::vec3& camera_pos) const override;
 
 			loaded_model(const shader& render_shader, const shader& outline_shader, const glm::vec3& pos,
-			             const glm::vec3& scale, const glm::vec3& rot, std::shared_ptr<model_data> data);
+			             const glm::vec3& scale, const glm::vec3& rot, std::shared_ptr<model_data> data,
+			             float lod_screen_error = DEFAULT_LOD_SCREEN_ERROR);
 
 			loaded_model(const loaded_model&&)             = delete;
 			loaded_model&& operator=(const loaded_model&&) = delete;
@@ -19,6 +27,14 @@ namespace kanso {
 			glm::vec3 aabb_min() const override;
 			glm::vec3 aabb_max() const override;
 
+			// nearest triangle of full detail meshes, distance is along world ray
+			[[nodiscard]] std::optional<model_hit> intersect(const raycast& ray) const;
+			float hit_distance(const raycast& ray, float box_distance) const override;
+
+			const occluder_mesh* occluder_hull() const override {
+				return occluder_ ? &data_->occluder() : nullptr;
+			}
+
 			std::string type() const override {
 				return "loaded_model";
 			}
@@ -27,14 +43,23 @@ namespace kanso {
 			}
 
 		private:
-			std::shared_ptr<model_data> data_;
-			std::unique_ptr<renderer>   renderer_;
-			std::vector<line>           aabb_box_;
+			std::shared_ptr<model_data>  data_;
+			std::unique_ptr<renderer>    renderer_;
+			float                        lod_screen_error_;
+			glm::vec3                    world_min_{};
+			glm::vec3                    world_max_{};
+			box_list                     mesh_boxes_; // world space, recomputed whenever model moves
+			mutable std::vector<uint8_t> mesh_visible_;
 
-			void draw_model(uint shader, const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camera_pos) const;
-			void draw_bounding_box(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camera_pos) const;
+			// coarsest level of mesh whose error covers at most lod_screen_error_ of viewport height
+			size_t select_lod(const mesh& mesh, float world_scale, float error_to_screen) const;
+			// model matrix and world boxes of current transform, touches no GL objects
 			void recalculate_bounding_box();
-			glm::vec3 calculate_aabb(glm::vec3 p) const;
+
+		protected:
+			void transform_changed() override {
+				recalculate_bounding_box();
+			}
 	};
 
 } // namespace kanso
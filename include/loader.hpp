@@ -2,24 +2,21 @@
 
 #include <cmath>
 #include <fstream>
-
 #include "model.hpp"
 #include "scene.hpp"
 #include "camera.hpp"
-
-#include <nlohmann/json.hpp>
+#include "upload_queue.hpp"
+#include "scene_format.hpp"
+#include "task.hpp"
 
 namespace kanso {
 
 	class model_data;
+	class model_data_loader;
+	class thread_pool;
 
 	namespace exception {
 
-		class bad_scene_file_exception : public base_kanso_exception {
-			public:
-				bad_scene_file_exception(std::string&& msg) : base_kanso_exception(std::move(msg)) {}
-		};
-
 		class camera_not_found_exception : public base_kanso_exception {
 			public:
 				camera_not_found_exception(std::string&& msg) : base_kanso_exception(std::move(msg)) {}
@@ -32,23 +29,38 @@ namespace kanso {
 
 	class loader {
 		public:
-			loader(nlohmann::json&& json);
+			loader(scene_description&& scene);
+			~loader();
 
+			// scene starts with lights only, models are added by update() as soon as their data is on GPU. Scene
+			// shares pool of this loader and has to be destroyed first
 			std::unique_ptr<scene>  make_scene();
 			std::shared_ptr<camera> make_camera();
 
-		private:
-			template<typename OutputIt>
-			void init_load(OutputIt out_it);
+			// uploads queued GPU data within per frame budget and continues coroutines waiting for models that became
+			// resident, first call also starts placing models of scene description into scene.
+			// Must be called from thread owning GL context
+			void update(scene& scene);
 
-			nlohmann::json                                     json_;
-			std::map<std::string, std::shared_ptr<model_data>> models_{};
+			// completes on thread calling update() once model at path is on GPU, models not in scene description
+			// are imported on demand
+			task<std::shared_ptr<model_data>> load_model(std::string path);
+
+		private:
+			void init_load();
 
-			template<typename OutputIt>
-			static void load_models_data(const nlohmann::json& models_json, OutputIt out_map);
+			scene_description                  scene_;
+			upload_queue                       uploads_;
+			// imports, texture decoding, light clustering and culling. Declared after uploads_, so texture jobs
+			// still queuing uploads are joined before queue goes away
+			std::unique_ptr<thread_pool>       pool_;
+			std::unique_ptr<model_data_loader> models_loader_;
+			bool                               models_placed_ = false;
 
+			// adds scene_.models[index] to scene once its data is resident
+			task<void> place_model(scene& scene, size_t index);
 
-			void load_models(const nlohmann::json& models_json, back_inserter<std::shared_ptr<model>> inserter);
+			std::unique_ptr<model> make_model(const scene_model_entry& entry, std::shared_ptr<model_data> data) const;
 	};
 
 } // namespace kanso
@@ -7,33 +7,104 @@
 
 #include "texture.hpp"
 #include "renderer.hpp"
+#include "mesh_simplifier.hpp"
+#include "triangle_bvh.hpp"
 
 namespace kanso {
 
 	struct mesh_data {
-		mesh_data(std::vector<mesh_vertex> vertices, std::vector<int> indices, std::vector<raw_tex> maps, const glm::vec3& aabb_min, const glm::vec3& aabb_max)
+		mesh_data(std::vector<mesh_vertex> vertices, std::vector<int> indices, std::vector<raw_tex> maps,
+		          const glm::vec3& aabb_min, const glm::vec3& aabb_max, std::vector<mesh_lod> lods = {},
+		          triangle_bvh bvh = {})
 			: vertices(std::move(vertices)),
 			  indices(std::move(indices)),
 			  raw_maps(std::move(maps)),
 			  aabb_min(aabb_min),
-			  aabb_max(aabb_max){}
+			  aabb_max(aabb_max),
+			  lods(std::move(lods)),
+			  bvh(std::move(bvh)){}
 
 		std::vector<mesh_vertex> vertices;
 		std::vector<int>         indices;
 		std::vector<raw_tex>     raw_maps;
 		glm::vec3 aabb_min;
 		glm::vec3 aabb_max;
+		std::vector<mesh_lod> lods; // coarser levels, indices above are LOD 0
+		triangle_bvh          bvh;  // over LOD 0
 	};
 
+	// CPU side of mesh is built on import workers, GPU buffers are created later by upload()
 	class mesh {
 		public:
 			mesh(mesh_data data);
 
-			void draw(uint shader);
+			// creates GL buffers, must be called from thread owning GL context
+			void upload();
+
+			// true once buffers and all textures are on GPU
+			bool resident();
+
+			[[nodiscard]] size_t upload_size() const;
+
+			[[nodiscard]] size_t lod_count() const;
+
+			// max deviation of lod from full detail in model units
+			[[nodiscard]] float lod_error(size_t lod) const;
+
+			// index range of lod in geometry(), lod 0 is full detail and out of range lod is clamped to coarsest one
+			[[nodiscard]] size_t first_index(size_t lod) const;
+			[[nodiscard]] size_t index_count(size_t lod) const;
+
+			// CPU copy kept after upload, for work that needs geometry on CPU
+			[[nodiscard]] const std::vector<mesh_vertex>& vertices() const {
+				return vertices_;
+			}
+
+			// lod clamped like first_index()
+			[[nodiscard]] const std::vector<int>& indices(size_t lod) const;
+
+			// nearest full detail triangle ray hits in model space, empty if mesh was imported without hierarchy
+			[[nodiscard]] std::optional<triangle_bvh::hit> intersect(const glm::vec3& origin,
+			                                                         const glm::vec3& direction) const {
+				return bvh_.intersect(vertices_, indices_, origin, direction);
+			}
+
+			[[nodiscard]] const triangle_bvh& bvh() const {
+				return bvh_;
+			}
+
+			// only valid once resident
+			[[nodiscard]] const texture& maps() const {
+				return texture_;
+			}
+
+			[[nodiscard]] renderer& geometry() const {
+				return *renderer_;
+			}
+
+			// bounds in model space
+			[[nodiscard]] glm::vec3 aabb_min() const {
+				return aabb_min_;
+			}
+
+			[[nodiscard]] glm::vec3 aabb_max() const {
+				return aabb_max_;
+			}
 
 		private:
+			struct lod_range {
+				size_t first_index{};
+				size_t index_count{};
+				float  error{};
+			};
+
 			std::vector<mesh_vertex> vertices_;
 			std::vector<int>         indices_;
+			std::vector<mesh_lod>    lods_;
+			std::vector<lod_range>   lod_ranges_;
+			triangle_bvh             bvh_;
+			glm::vec3                aabb_min_;
+			glm::vec3                aabb_max_;
 			texture texture_;
 			std::unique_ptr<renderer> renderer_;
 	};
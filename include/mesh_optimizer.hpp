@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+#include "renderer.hpp"
+
+namespace kanso {
+
+	constexpr size_t VERTEX_CACHE_SIZE = 32;
+
+	struct mesh_optimization_stats {
+		size_t vertices_before{};
+		size_t vertices_after{};
+		size_t triangles_before{};
+		size_t triangles_after{};
+		// vertex shader invocations simulated with FIFO post-transform cache of VERTEX_CACHE_SIZE entries
+		size_t transforms_before{};
+		size_t transforms_after{};
+
+		[[nodiscard]] float acmr_before() const {
+			return triangles_before == 0 ? 0.0f : static_cast<float>(transforms_before) / static_cast<float>(triangles_before);
+		}
+
+		[[nodiscard]] float acmr_after() const {
+			return triangles_after == 0 ? 0.0f : static_cast<float>(transforms_after) / static_cast<float>(triangles_after);
+		}
+
+		[[nodiscard]] size_t bytes_before() const {
+			return vertices_before * sizeof(mesh_vertex) + triangles_before * 3 * sizeof(int);
+		}
+
+		[[nodiscard]] size_t bytes_after() const {
+			return vertices_after * sizeof(mesh_vertex) + triangles_after * 3 * sizeof(int);
+		}
+
+		mesh_optimization_stats& operator+=(const mesh_optimization_stats& other);
+	};
+
+	// Import-time mesh optimizations. Every pass works in place on triangle list indices.
+	namespace mesh_optimizer {
+
+		// runs every pass below in order and reports what changed
+		mesh_optimization_stats optimize(std::vector<mesh_vertex>& vertices, std::vector<int>& indices);
+
+		// merges bitwise identical vertices
+		void weld_vertices(std::vector<mesh_vertex>& vertices, std::vector<int>& indices);
+
+		// drops triangles with repeated indices or zero area
+		void remove_degenerate_triangles(const std::vector<mesh_vertex>& vertices, std::vector<int>& indices);
+
+		// reorders triangles for post-transform vertex cache hits (Forsyth)
+		void optimize_vertex_cache(std::vector<int>& indices, size_t vertex_count);
+
+		// reorders cache friendly clusters of triangles so outward facing ones are drawn first
+		void optimize_overdraw(const std::vector<mesh_vertex>& vertices, std::vector<int>& indices);
+
+		// reorders vertices by first use in index buffer and drops unreferenced ones
+		void optimize_vertex_fetch(std::vector<mesh_vertex>& vertices, std::vector<int>& indices);
+
+		// vertex shader invocations for indices with FIFO cache of cache_size entries
+		size_t simulate_vertex_cache(const std::vector<int>& indices, size_t vertex_count, size_t cache_size);
+
+	} // namespace mesh_optimizer
+
+} // namespace kanso
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+#include "renderer.hpp"
+
+namespace kanso {
+
+	constexpr size_t MAX_LOD_COUNT       = 4;    // coarser levels generated in addition to base mesh
+	constexpr float  LOD_REDUCTION       = 0.5f; // index count of each level relative to previous one
+	constexpr size_t MIN_LOD_INDICES     = 3 * 64;
+	constexpr float  MAX_LOD_ERROR_RATIO = 0.05f; // simplification stops at this fraction of mesh extent
+
+	// coarser version of mesh, indices refer to the same vertices as base level
+	struct mesh_lod {
+		std::vector<int> indices;
+		float            error{}; // max deviation from base level in model units
+	};
+
+	// Quadric error metric edge collapse (Garland-Heckbert). Vertices are only collapsed onto neighbours,
+	// so vertex buffer is shared by every level. Border and attribute seam vertices stay in place.
+	namespace mesh_simplifier {
+
+		// simplifies until indices.size() <= target_index_count or collapse error would exceed max_error
+		mesh_lod simplify(const std::vector<mesh_vertex>& vertices, const std::vector<int>& indices,
+		                  size_t target_index_count, float max_error);
+
+		// levels with decreasing detail, stops early once a level fails to reduce mesh noticeably
+		std::vector<mesh_lod> build_lod_chain(const std::vector<mesh_vertex>& vertices, const std::vector<int>& indices);
+
+	} // namespace mesh_simplifier
+
+} // namespace kanso
@@ -2,15 +2,30 @@
 
 #include <string>
 
+#include "frustum_culling.hpp"
+#include "occlusion_culling.hpp"
+#include "render_queue.hpp"
 #include "shader.hpp"
 
 #include <glm/vec3.hpp>
 
 namespace kanso {
 
+	class raycast;
+
 	class drawable {
 		public:
-			virtual ~drawable()                                                                          = default;
+			virtual ~drawable() = default;
+
+			// adds draw packets of this object to queue, objects made of several parts may drop those culler rejects
+			virtual void enqueue(render_queue& queue, frustum_culler& culler, const glm::mat4& proj,
+			                     const glm::vec3& camera_pos) const = 0;
+	};
+
+	// Object issuing its own GL calls, queue calls draw() when custom packet of object comes up
+	class immediate_drawable {
+		public:
+			virtual ~immediate_drawable()                                                                      = default;
 			virtual void draw(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camera_pos) const = 0;
 	};
 
@@ -73,10 +88,38 @@ namespace kanso {
 			virtual glm::vec3 aabb_min() const = 0;
 			virtual glm::vec3 aabb_max() const = 0;
 
+			// distance along ray to model's surface once ray enters its box at box_distance, infinity if it misses.
+			// Models without geometry on CPU are hit by their box
+			virtual float hit_distance(const raycast& ray, float box_distance) const {
+				(void)ray;
+				return box_distance;
+			}
+
+			// model space triangles drawn into occlusion_buffer, null unless model is a designated occluder
+			virtual const occluder_mesh* occluder_hull() const {
+				return nullptr;
+			}
+
+			void set_occluder(bool occluder) {
+				occluder_ = occluder;
+			}
+
+			bool is_occluder() const {
+				return occluder_;
+			}
+
 			void select_toggle() override {
 				selected_ = !selected_;
 			}
 
+			// places model anew, owner has to refit its bounds afterwards
+			void set_transform(const glm::vec3& pos, const glm::vec3& scale, const glm::vec3& rot) {
+				position_ = pos;
+				scale_    = scale;
+				rotation_ = rot;
+				transform_changed();
+			}
+
 			glm::vec3 pos() const override {
 				return position_;
 			}
@@ -99,8 +142,12 @@ namespace kanso {
 			glm::vec3 scale_;
 			glm::vec3 rotation_;
 			bool      selected_ = false;
+			bool      occluder_ = false;
 			glm::vec3 aabb_min_;
 			glm::vec3 aabb_max_;
+
+			// recomputes whatever model derives from its transform, world boxes among others
+			virtual void transform_changed() {}
 	};
 
 } // namespace kanso
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "mesh.hpp"
+
+namespace kanso {
+
+	// Cooked binary copy of imported models. One file per source asset, keyed by source path, its mtime and
+	// the import flags it was cooked with. Entries are memory-mapped on load, so warm starts never touch assimp.
+	class model_cache {
+		public:
+			model_cache(std::string cache_dir = DEFAULT_MODEL_CACHE_PATH);
+
+			// returns std::nullopt if entry is missing, stale or corrupt
+			// texture references are restored as path and type only, bytes are left nullptr
+			[[nodiscard]] std::optional<std::vector<mesh_data>> load(std::string_view path, uint import_flags) const;
+
+			void store(std::string_view path, uint import_flags, const std::vector<mesh_data>& meshes) const;
+
+		private:
+			std::string cache_dir_;
+
+			[[nodiscard]] std::string entry_path(std::string_view path) const;
+	};
+
+} // namespace kanso
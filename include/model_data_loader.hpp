@@ -1,12 +1,23 @@
 #pragma once
 
-#include <map>
+#include <atomic>
+#include <coroutine>
+#include <future>
 #include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "mesh.hpp"
 #include "exception.hpp"
+#include "occlusion_culling.hpp"
+#include "task.hpp"
 
 namespace kanso {
+
+	class thread_pool;
+	class upload_queue;
+	class job_graph;
+
 	namespace exception {
 
 		class model_load_exception : public base_kanso_exception {
@@ -40,33 +51,93 @@ namespace kanso {
 
 			std::string name() const { return model_name_; }
 
+			// stand in for every mesh when model hides others, built with model on import worker
+			const occluder_mesh& occluder() const {
+				return occluder_;
+			}
+
+			// true once every mesh is on GPU, must be called from thread owning GL context
+			bool resident() {
+				return std::all_of(meshes_.begin(), meshes_.end(), [](auto& mesh) { return mesh.resident(); });
+			}
+
 		private:
 			std::vector<mesh> meshes_;
 			std::string       model_name_;
 			glm::vec3         aabb_max_{ std::numeric_limits<float>::min() };
 			glm::vec3         aabb_min_{ std::numeric_limits<float>::max() };
+			occluder_mesh     occluder_;
 	};
 
+	// Imports models on worker threads without blocking the caller. Meshes and textures of every imported
+	// model are queued to upload_queue, coroutines awaiting load_model() continue once model is fully on GPU.
+	// Pool has to outlive loader.
 	class model_data_loader {
 		public:
 			model_data_loader(std::vector<std::string>::iterator paths_begin,
-			                  std::vector<std::string>::iterator paths_end);
+			                  std::vector<std::string>::iterator paths_end, thread_pool& pool, upload_queue& uploads);
+			~model_data_loader();
 
-			template <typename OutputIt>
-			void models_data(OutputIt out) const {
-				std::for_each(models_data_.begin(), models_data_.end(), [&out](auto& it) { *out++ = it; });
-			}
+			model_data_loader(const model_data_loader&)            = delete;
+			model_data_loader& operator=(const model_data_loader&) = delete;
+
+			// completes once model at path is resident, import starts here if path was not requested before.
+			// Awaiting coroutine continues on thread calling resume_resident(), or with nullptr if loader is
+			// destroyed first
+			task<std::shared_ptr<model_data>> load_model(std::string path);
+
+			// continues coroutines whose models became resident since last call, must be called from thread owning
+			// GL context
+			void resume_resident();
 
 		private:
 			using raw_model_data = std::vector<mesh_data>;
 
-			std::vector<std::pair<std::string, raw_model_data>> raw_models_data_;
-			std::map<std::string, std::shared_ptr<model_data>>  models_data_;
-			std::mutex                                          mut_;
+			struct import_state;
+
+			struct resident_awaiter {
+				model_data_loader&          loader;
+				std::string                 path;
+				std::shared_ptr<model_data> data;
+				std::coroutine_handle<>     handle;
+
+				[[nodiscard]] bool await_ready() const noexcept {
+					return false;
+				}
+
+				bool await_suspend(std::coroutine_handle<> awaiting) {
+					handle = awaiting;
+					return loader.wait_for(*this);
+				}
+
+				std::shared_ptr<model_data> await_resume() {
+					return std::move(data);
+				}
+			};
+
+			upload_queue&                            uploads_;
+			thread_pool&                             pool_;
+			// read file -> one job per mesh (parse, optimize, simplify) -> build model and queue uploads
+			std::unique_ptr<job_graph>               graph_;
+			std::atomic<size_t>                      remaining_imports_{ 0 };
+			std::vector<std::shared_ptr<model_data>> pending_; // imported, still uploading
+
+			std::unordered_map<std::string, std::shared_ptr<model_data>> resident_;
+			std::unordered_set<std::string>                              requested_;
+			std::vector<resident_awaiter*>                               waiters_;
+			std::mutex                                                   mut_;
 
 			template <typename InputIt>
 			void load(InputIt paths_begin, InputIt paths_end);
 
-			void load_raw_model(std::string_view path);
+			// expects mut_ to be held
+			void import(const std::string& path);
+			// false if model is already resident and awaiter should not suspend
+			bool wait_for(resident_awaiter& awaiter);
+
+			void read_model(const std::shared_ptr<import_state>& state);
+			void build_model(import_state& state);
+			void publish(std::shared_ptr<model_data> data);
+			task<void> upload(std::shared_ptr<model_data> data);
 	};
 } // namespace kanso
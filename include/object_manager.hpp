@@ -1,19 +1,42 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 
+#include "aabb_tree.hpp"
+
 namespace kanso {
 
 	class model;
 	class light;
+	class raycast;
 	struct model_view;
 
+	// Owns models and lights of a scene. World boxes of scene models are kept in a bounding volume hierarchy,
+	// values in it are indices into models.
 	class object_manager {
 		public:
 			object_manager(std::vector<std::shared_ptr<model>> models, std::vector<std::shared_ptr<light>> lights);
 
 			void add_model(std::unique_ptr<model> model);
 
+			// places scene model at index anew and refits its box, other models are left alone
+			void set_transform(size_t index, const glm::vec3& pos, const glm::vec3& scale, const glm::vec3& rot);
+
+			// refits box of model at index after its transform changed, cheap while it stays near where it was
+			void update_bounds(size_t index);
+
+			// nearest scene model ray hits, null if none
+			[[nodiscard]] std::shared_ptr<model> pick(const raycast& ray) const;
+
+			[[nodiscard]] const aabb_tree& bounds() const {
+				return bounds_;
+			}
+
+			[[nodiscard]] const std::shared_ptr<model>& model_at(size_t index) const {
+				return models_[index];
+			}
+
 			std::vector<std::shared_ptr<model>>::const_iterator model_begin() {
 				return models_.begin();
 			}
@@ -30,6 +53,10 @@ namespace kanso {
 				return lights_.end();
 			}
 
+			const std::vector<std::shared_ptr<light>>& lights() const {
+				return lights_;
+			}
+
 			std::vector<model_view>::iterator view_begin() {
 				return model_views_.begin();
 			}
@@ -42,6 +69,13 @@ namespace kanso {
 			std::vector<std::shared_ptr<model>> models_;
 			std::vector<std::shared_ptr<light>> lights_;
 			std::vector<model_view> model_views_;
+
+			aabb_tree            bounds_;
+			std::vector<int32_t> proxies_; // leaf of every model in bounds_, NULL_NODE for models without box
+
+			void track(size_t index);
+
+			static model_view make_view(const model& model);
 	};
 
 }
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace kanso {
+
+	class mesh;
+	class thread_pool;
+
+	// size of occlusion_buffer, coarse enough to clear and fill on CPU every frame
+	constexpr int OCCLUSION_WIDTH  = 320;
+	constexpr int OCCLUSION_HEIGHT = 192;
+
+	// model space triangles standing in for a model when it hides others
+	struct occluder_mesh {
+		std::vector<glm::vec3> vertices;
+		std::vector<uint32_t>  indices;
+	};
+
+	// coarsest level of every mesh. It may stick out of full detail by its simplification error, so models
+	// should only be made occluders where that is small next to what they hide
+	[[nodiscard]] occluder_mesh make_occluder(const std::vector<mesh>& meshes);
+
+	// counted since last begin()
+	struct occlusion_stats {
+		size_t occluders = 0;
+		size_t triangles = 0; // rasterized, triangles crossing near plane are dropped
+	};
+
+	// Low resolution depth buffer on CPU. Triangles of designated occluders are rasterized into it every frame,
+	// then boxes whose every pixel lies behind them are rejected before anything is submitted. Rows are split
+	// into bands rasterized on thread pool, four pixels at a time. Needs no GL context.
+	class occlusion_buffer {
+		public:
+			// width is rounded up to a multiple of four
+			explicit occlusion_buffer(int width = OCCLUSION_WIDTH, int height = OCCLUSION_HEIGHT);
+
+			// clears depth and occluders, everything until next begin() is seen through view_proj
+			void begin(const glm::mat4& view_proj);
+			// mesh has to live until render()
+			void add_occluder(const occluder_mesh& mesh, const glm::mat4& model);
+			// rasterizes occluders added since begin()
+			void render(thread_pool* pool = nullptr);
+
+			// false if box is behind occluders at every pixel it covers. Occluders should not test their own
+			// box, rounding may put their hull a hair in front of it
+			[[nodiscard]] bool visible(const glm::vec3& min, const glm::vec3& max) const;
+
+			// device depth of nearest occluder at pixel, 1 where there is none. Row 0 is at bottom like in GL
+			[[nodiscard]] float depth(int x, int y) const {
+				return depth_[static_cast<size_t>(y) * static_cast<size_t>(width_) + static_cast<size_t>(x)];
+			}
+
+			[[nodiscard]] int width() const {
+				return width_;
+			}
+
+			[[nodiscard]] int height() const {
+				return height_;
+			}
+
+			[[nodiscard]] const occlusion_stats& stats() const {
+				return stats_;
+			}
+
+		private:
+			// triangle in pixels, edges and depth are planes x * a + y * b + c with edges positive inside
+			struct raster_triangle {
+				std::array<glm::vec3, 3> edges;
+				glm::vec3                depth;
+				int                      min_x, max_x, min_y, max_y; // max_x < min_x if triangle is dropped
+			};
+
+			struct queued_occluder {
+				const occluder_mesh* mesh;
+				glm::mat4            matrix; // model to clip space
+				size_t               first_triangle;
+			};
+
+			int                          width_;
+			int                          height_;
+			glm::mat4                    view_proj_{ 1.0f };
+			std::vector<float>           depth_;
+			std::vector<queued_occluder> occluders_;
+			std::vector<raster_triangle> triangles_;
+			occlusion_stats              stats_;
+
+			void setup(const queued_occluder& occluder);
+			void rasterize(const raster_triangle& triangle, int first_row, int last_row);
+	};
+
+} // namespace kanso
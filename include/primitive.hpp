@@ -5,11 +5,14 @@
 
 namespace kanso {
 
-	class line : public model {
+	class line : public model, public immediate_drawable {
 		public:
 			line(const glm::vec3& start, const glm::vec3& end, std::string_view vert_file = "shaders/line.vert", std::string_view frag_file = "shaders/line.frag");
 
 			void draw(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camera_pos) const override;
+			// whole line is one custom packet
+			void enqueue(render_queue& queue, frustum_culler& culler, const glm::mat4& proj,
+			             const glm::vec3& camera_pos) const override;
 			void select_toggle() override {}
 
 			std::string type() const override {
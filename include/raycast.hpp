@@ -12,6 +12,8 @@ namespace kanso {
 			raycast(float mouse_x, float mouse_y, int screen_width, int screen_height, const glm::mat4& view, const glm::mat4& proj);
 
 			[[nodiscard]] bool is_intersects(const glm::vec3& aabb_min, const glm::vec3& aabb_max) const;
+			// distance along direction where ray enters box, 0 if it starts inside, infinity if it misses
+			[[nodiscard]] float entry_distance(const glm::vec3& aabb_min, const glm::vec3& aabb_max) const;
 
 			[[nodiscard]] glm::vec3 get_origin() const {
 				return ray_origin_;
@@ -23,6 +25,7 @@ namespace kanso {
 		private:
 			glm::vec3 ray_origin_{};
 			glm::vec3 ray_direction_{};
+			glm::vec3 inv_direction_{};
 
 			static std::pair<glm::vec3, glm::vec3> world_dir(float mouse_x, float mouse_y, int screen_width,
 			                                                       int screen_height, const glm::mat4& view,
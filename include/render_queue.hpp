@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "core.hpp"
+#include "dynamic_ring.hpp"
+#include "gpu_culling.hpp"
+#include "renderer.hpp"
+#include "shader.hpp"
+
+#include <glm/glm.hpp>
+
+namespace kanso {
+
+	class immediate_drawable;
+	class mesh;
+	class texture;
+
+	// passes run in this order, each with its own stencil and depth state
+	enum class render_pass : uint8_t { opaque, outline, overlay };
+
+	// 64 bit sort key, most significant first: pass 2 | program 10 | material 14 | vertex array 14 | lod 4 |
+	// depth 20. State ids are GL names cut to their field, a collision only costs a state change and never a wrong
+	// draw. Depth is last, so equal state is drawn front to back and instances of one mesh level stay together.
+	[[nodiscard]] uint64_t make_sort_key(render_pass pass, uint program, uint material, uint vertex_array, size_t lod,
+	                                     float depth);
+
+	// everything needed to issue one draw later, custom packets call immediate_drawable::draw() instead
+	struct draw_packet {
+		render_pass               pass;
+		uint                      program;
+		const texture*            maps;
+		renderer*                 geometry;
+		const immediate_drawable* custom;
+		glm::mat4                 model;
+		size_t                    first_index;
+		size_t                    index_count;
+		glm::vec3                 box_min; // world box, tested by gpu_culler
+		glm::vec3                 box_max;
+
+		// true if both draw the same mesh range with the same state, so one instanced draw covers them
+		[[nodiscard]] bool instances_with(const draw_packet& other) const {
+			return custom == nullptr && other.custom == nullptr && pass == other.pass && program == other.program &&
+			       geometry == other.geometry && first_index == other.first_index && index_count == other.index_count;
+		}
+	};
+
+	// sorts keys and their packet indices together, scratch is reused between calls
+	struct sort_item {
+		uint64_t key;
+		uint32_t packet;
+	};
+
+	// LSD radix sort on 8 bit digits, digits equal in every key are skipped
+	void radix_sort(std::vector<sort_item>& items, std::vector<sort_item>& scratch);
+
+	// Collects draw packets of a frame, sorts them by key and submits them, changing program, textures and vertex
+	// array only when they differ from previous packet. Neighbouring packets drawing the same mesh range with the
+	// same program become one instanced draw. Camera block, model matrices and indirect commands of a frame are
+	// written straight into a dynamic_ring region. Where GL offers multi draw indirect with base instance, every
+	// run of draws sharing program, textures and vertex array is one glMultiDrawElementsIndirect call, and where
+	// compute shaders are available too, gpu_culler drops instances outside frustum or hidden behind depth of
+	// previous frame before they are drawn. Debug boxes are written to the ring as world space line vertices.
+	// Storage is kept between frames.
+	class render_queue {
+		public:
+			render_queue();
+			~render_queue();
+
+			render_queue(const render_queue&)            = delete;
+			render_queue& operator=(const render_queue&) = delete;
+			render_queue(render_queue&&)                 = delete;
+			render_queue& operator=(render_queue&&)      = delete;
+
+			void clear();
+
+			// lod as in mesh::first_index(), depth is distance from camera, box min and max bound mesh in world
+			void push(render_pass pass, uint program, mesh& mesh, size_t lod, const glm::mat4& model, float depth,
+			          const glm::vec3& box_min, const glm::vec3& box_max);
+			void push_custom(render_pass pass, uint program, const immediate_drawable& drawable, float depth);
+			// edges of model space box placed by model, every box of a frame is drawn by one line list draw after
+			// all packets
+			void push_box(const glm::mat4& model, const glm::vec3& box_min, const glm::vec3& box_max);
+
+			// sorts packets and draws them, must be called from thread owning GL context
+			void submit(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camera_pos);
+
+			[[nodiscard]] size_t size() const {
+				return packets_.size();
+			}
+
+			// draw calls issued by last submit()
+			[[nodiscard]] size_t draw_calls() const {
+				return draw_calls_;
+			}
+
+			// true if instances are culled on GPU by frustum and depth of previous frame
+			[[nodiscard]] bool gpu_culling() const {
+				return gpu_culler_ != nullptr;
+			}
+
+			// waits for GPU before writing per frame data
+			[[nodiscard]] const ring_stats& upload_stats() const {
+				return ring_.stats();
+			}
+
+		private:
+			// uniforms a program keeps for its whole life, resolved and set when program is first drawn
+			struct program_uniforms {
+				explicit program_uniforms(uint program);
+
+				uniform<float> shininess;
+				bool           set = false;
+			};
+
+			// std140 layout of Camera block
+			struct camera_block {
+				glm::mat4 view;
+				glm::mat4 proj;
+				glm::vec4 view_pos;
+			};
+
+			// run of sorted items drawn as instances of one mesh range, custom packets are always alone
+			struct draw_batch {
+				uint32_t first_item;
+				uint32_t item_count;
+				uint32_t first_instance;
+			};
+
+			// layout of glMultiDrawElementsIndirect commands
+			struct indirect_command {
+				uint32_t count;
+				uint32_t instance_count;
+				uint32_t first_index;
+				int32_t  base_vertex;
+				uint32_t base_instance;
+			};
+
+			std::vector<draw_packet>                   packets_;
+			std::vector<sort_item>                     items_;
+			std::vector<sort_item>                     scratch_;
+			std::vector<draw_batch>                    batches_;
+			std::vector<glm::vec3>                     line_vertices_; // world space, two per edge
+			std::unordered_map<uint, program_uniforms> uniforms_;
+			std::unique_ptr<renderer>                  state_;
+			dynamic_ring                               ring_;
+			std::unique_ptr<gpu_culler>                gpu_culler_; // null without compute shaders
+			size_t                                     uniform_alignment_ = 0;
+			size_t                                     custom_packets_    = 0;
+			size_t                                     camera_offset_     = 0; // offsets of this frame's data in ring_
+			size_t                                     instance_offset_   = 0;
+			size_t                                     command_offset_    = 0;
+			size_t                                     params_offset_     = 0;
+			size_t                                     bounds_offset_     = 0;
+			size_t                                     lines_offset_      = 0;
+			uint                                       line_program_      = 0; // linked once first box is drawn
+			uint                                       line_vao_          = 0;
+			bool                                       multi_draw_        = false;
+			size_t                                     draw_calls_        = 0;
+
+			program_uniforms& uniforms_for(uint program);
+			void              apply_pass(render_pass pass);
+			void              build_batches();
+			void              draw_lines(uint buffer);
+			// false if ring could not be written
+			bool              write_frame_data(const glm::mat4& view, const glm::mat4& proj,
+			                                   const glm::vec3& camera_pos);
+
+			// true if batch b can join multi draw of batch a
+			[[nodiscard]] bool shares_state(const draw_batch& a, const draw_batch& b) const;
+	};
+
+} // namespace kanso
@@ -1,11 +1,17 @@
 #pragma once
 
 #include "core.hpp"
+#include "block_compression.hpp"
+#include "image_ops.hpp"
 
 #include <glm/vec3.hpp>
 #include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+#include <glm/matrix.hpp>
 
+#include <array>
 #include <cstddef>
+#include <cstdint>
 #include <vector>
 
 namespace kanso {
@@ -16,12 +22,65 @@ namespace kanso {
 		glm::vec2 tex_coords{};
 	};
 
+	// 16 bytes: position quantized to mesh bounds, octahedral normal, half float uv
+	struct compact_vertex {
+		std::array<uint16_t, 4> pos{};
+		std::array<int16_t, 2>  normal{};
+		std::array<uint16_t, 2> tex_coords{};
+	};
+
+	// per instance attributes streamed by render_queue, normal is inverse transpose of model. Vertex layout of mesh
+	// rides along, so draws of different meshes need no uniforms in between
+	struct instance_data {
+		glm::mat4 model{ 1.0f };
+		glm::mat3 normal{ 1.0f };
+		glm::vec4 vertex_offset{ 0.0f }; // w is 1 for compact vertices
+		glm::vec3 vertex_scale{ 1.0f };
+	};
+
+	// attribute locations of instance_data columns in mesh shaders
+	constexpr uint INSTANCE_MODEL_LOCATION  = 3;
+	constexpr uint INSTANCE_NORMAL_LOCATION = 7;
+	constexpr uint INSTANCE_OFFSET_LOCATION = 10;
+	constexpr uint INSTANCE_SCALE_LOCATION  = 11;
+
+	enum class vertex_format { full, compact };
+
+	constexpr vertex_format DEFAULT_VERTEX_FORMAT = vertex_format::compact;
+
+	// what vertex shader needs to decode vertex buffer, position = offset + pos * scale
+	struct vertex_layout {
+		vertex_format format = vertex_format::full;
+		glm::vec3     offset{ 0.0f };
+		glm::vec3     scale{ 1.0f };
+	};
+
 	class renderer {
 		public:
-			virtual void draw_triangles() = 0;
-			virtual void draw_line()      = 0;
+			// whole index buffer or range of it
+			virtual void draw_triangles()                                       = 0;
+			virtual void draw_triangles(size_t first_index, size_t index_count) = 0;
+			virtual void draw_line()                                            = 0;
+
+			// bind() once, then draw_bound() any number of ranges and unbind() at the end
+			virtual void bind()                                                 = 0;
+			virtual void draw_bound(size_t first_index, size_t index_count)     = 0;
+			virtual void unbind()                                               = 0;
+			[[nodiscard]] virtual uint vertex_array() const                     = 0;
 
-			virtual uint load_texture(uint8_t* bytes, int nr_channels, int width, int height) = 0;
+			// points instance attributes of bound vertex array at instance_data array starting at offset bytes
+			// into buffer, then draws range once per instance
+			virtual void bind_instances(uint buffer, size_t offset)                                    = 0;
+			virtual void draw_bound_instanced(size_t first_index, size_t index_count, size_t instances) = 0;
+
+			// start of geometry in buffers of vertex_array(), non zero when buffers are shared with other meshes
+			[[nodiscard]] virtual size_t base_index() const  = 0;
+			[[nodiscard]] virtual int    base_vertex() const = 0;
+			[[nodiscard]] virtual uint   index_type() const  = 0;
+
+			virtual uint load_texture(const std::vector<rgba_image>& levels)                  = 0;
+			virtual uint load_compressed_texture(const compressed_texture& texture)            = 0;
+			virtual bool supports_compression(block_format format) const                      = 0;
 			virtual void bind_texture(uint shader, const std::string& type, uint id, uint& diffuse_nr,
 			                          uint& specular_nr, uint& height_nr, uint& normal_nr, uint& number,
 			                          uint index)                                             = 0;
@@ -31,6 +90,7 @@ namespace kanso {
 			virtual void set_viewport(int width, int height)                                  = 0;
 			virtual void enable_depth()                                                       = 0;
 			virtual void enable_stencil(uint fill)                                            = 0;
+			virtual vertex_layout layout() const                                              = 0;
 
 			virtual ~renderer() = default;
 	};
@@ -39,13 +99,26 @@ namespace kanso {
 		public:
 			opengl_renderer() = default;
 			opengl_renderer(const glm::vec3& start, const glm::vec3& end);
-			opengl_renderer(const std::vector<mesh_vertex>& vertices, const std::vector<int>& indices);
+			opengl_renderer(const std::vector<mesh_vertex>& vertices, const std::vector<int>& indices,
+			                vertex_format format = DEFAULT_VERTEX_FORMAT);
 			~opengl_renderer() override;
 
 			void draw_triangles() override;
+			void draw_triangles(size_t first_index, size_t index_count) override;
 			void draw_line() override;
+			void bind() override;
+			void draw_bound(size_t first_index, size_t index_count) override;
+			void unbind() override;
+			uint vertex_array() const override;
+			void bind_instances(uint buffer, size_t offset) override;
+			void draw_bound_instanced(size_t first_index, size_t index_count, size_t instances) override;
+			size_t base_index() const override;
+			int    base_vertex() const override;
+			uint   index_type() const override;
 
-			uint load_texture(uint8_t* bytes, int nr_channels, int width, int height) override;
+			uint load_texture(const std::vector<rgba_image>& levels) override;
+			uint load_compressed_texture(const compressed_texture& texture) override;
+			bool supports_compression(block_format format) const override;
 			void bind_texture(uint shader, const std::string& type, uint id, uint& diffuse_nr, uint& specular_nr,
 			                  uint& height_nr, uint& normal_nr, uint& number, uint index) override;
 			void reset_stencil_test() override;
@@ -54,14 +127,20 @@ namespace kanso {
 			void set_viewport(int width, int height) override;
 			void enable_depth() override;
 			void enable_stencil(uint fill) override;
+			vertex_layout layout() const override;
 
 		private:
-			uint vao_{};
-			uint vbo_{};
-			uint ebo_{};
-			int  indices_count_{};
+			uint          vao_{};
+			uint          vbo_{};
+			uint          ebo_{};
+			int           indices_count_{};
+			uint          index_type_{};
+			vertex_layout layout_;
 	};
 
+	// points attributes 0 to 2 of bound vertex array at bound array buffer holding vertices of format
+	void set_vertex_attributes(vertex_format format);
+
 	struct renderer_factory {
 		template <typename Renderer = opengl_renderer, typename... Args>
 		static std::unique_ptr<renderer> make_renderer(Args&&... args) {
@@ -1,13 +1,31 @@
 #pragma once
 
 #include "camera.hpp"
+#include "frustum_culling.hpp"
+#include "light_buffer.hpp"
 #include "object_manager.hpp"
+#include "occlusion_culling.hpp"
+#include "render_queue.hpp"
 
 namespace kanso {
 
+	class raycast;
+	class scene_model;
+	class thread_pool;
+
+	// what last frame drew, shown in gui
+	struct render_stats {
+		cull_stats      culling; // on CPU, GPU culling drops further instances without reading counts back
+		occlusion_stats occlusion;
+		size_t          draw_calls = 0;
+		ring_stats      uploads;
+		bool            gpu_culling = false;
+	};
+
 	class scene {
 		public:
-			scene(std::shared_ptr<object_manager> manager);
+			// light clustering and culling run on pool, render thread joins in. Pool has to outlive scene
+			scene(std::shared_ptr<object_manager> manager, thread_pool& pool);
 
 			void draw(const camera& camera, const window& window);
 
@@ -19,8 +37,35 @@ namespace kanso {
 			std::vector<model_view>::iterator view_begin() const;
 			std::vector<model_view>::iterator view_end() const;
 
+			// places model at index of its view, picking and culling see it at new place right away
+			void set_transform(size_t index, const glm::vec3& pos, const glm::vec3& scale, const glm::vec3& rot);
+
+			// nearest model under ray, null if it hits none
+			[[nodiscard]] std::shared_ptr<model> pick(const raycast& ray) const;
+
+			[[nodiscard]] const render_stats& stats() const {
+				return stats_;
+			}
+
+			// models and meshes covering less of viewport height are not drawn, 0 draws everything in view
+			void set_min_screen_size(float fraction) {
+				min_screen_size_ = fraction;
+			}
+
 		private:
 			std::shared_ptr<object_manager> obj_manager_;
+			thread_pool&                    pool_;
+			light_buffer                    lights_;
+			render_queue                    queue_;
+			box_list                        model_boxes_;
+			std::vector<const scene_model*> boxed_models_; // owner of each box in model_boxes_
+			std::vector<uint8_t>            model_visible_;
+			occlusion_buffer                occlusion_;
+			float                           min_screen_size_ = DEFAULT_CULL_SCREEN_SIZE;
+			render_stats                    stats_;
+
+			// drops models in model_visible_ hidden behind designated occluders
+			void occlude(cull_stats& stats, const glm::mat4& view, const glm::mat4& proj);
 	};
 
 } // namespace kanso
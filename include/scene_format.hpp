@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "core.hpp"
+#include "exception.hpp"
+#include "light.hpp"
+
+#include <glm/vec3.hpp>
+#include <nlohmann/json.hpp>
+
+namespace kanso {
+
+	namespace exception {
+
+		class bad_scene_file_exception : public base_kanso_exception {
+			public:
+				bad_scene_file_exception(std::string&& msg) : base_kanso_exception(std::move(msg)) {}
+		};
+
+	} // namespace exception
+
+	constexpr char const* BINARY_SCENE_EXTENSION   = ".kscn";
+	constexpr float       INHERIT_LOD_SCREEN_ERROR = -1.0f; // model uses scene wide threshold
+
+	struct scene_camera {
+		glm::vec3 position{};
+		float     fov{};
+		float     near{};
+		float     far{};
+	};
+
+	// strings are indices into scene_description::strings
+	struct scene_model_entry {
+		uint32_t  path{};
+		uint32_t  render_shader{};
+		uint32_t  outline_shader{};
+		float     lod_screen_error = INHERIT_LOD_SCREEN_ERROR;
+		uint32_t  occluder{}; // 1 if model is drawn into occlusion_buffer to hide others
+		glm::vec3 position{ 0.0f };
+		glm::vec3 scale{ 1.0f };
+		glm::vec3 rotation{ 0.0f };
+	};
+
+	enum class scene_light_type : uint32_t { directional, point, spot };
+
+	// directional lights keep direction in spot.direction, point lights use spot.point_light_part only
+	struct scene_light_entry {
+		scene_light_type type{};
+		light_data       common;
+		spot_light_data  spot;
+	};
+
+	// entries are stored in binary scene files as they are in memory
+	static_assert(std::is_trivially_copyable_v<scene_camera>);
+	static_assert(std::is_trivially_copyable_v<scene_model_entry>);
+	static_assert(std::is_trivially_copyable_v<scene_light_entry>);
+
+	// Flat scene, both JSON and binary files are decoded into this in one pass.
+	struct scene_description {
+		std::optional<scene_camera>    camera;
+		float                          lod_screen_error = DEFAULT_LOD_SCREEN_ERROR;
+		std::vector<std::string>       strings; // model paths and shader names, each stored once
+		std::vector<scene_model_entry> models;
+		std::vector<scene_light_entry> lights;
+	};
+
+	namespace scene_format {
+
+		// picks format by file contents, throws bad_scene_file_exception if file is neither
+		scene_description load(const std::string& path);
+
+		// output format is picked by extension, binary unless path ends with .json
+		void save(const std::string& path, const scene_description& scene);
+
+		scene_description from_json(const nlohmann::json& json);
+		nlohmann::json    to_json(const scene_description& scene);
+
+		scene_description read_binary(const std::string& path);
+		void              write_binary(const std::string& path, const scene_description& scene);
+
+	} // namespace scene_format
+
+} // namespace kanso
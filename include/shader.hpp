@@ -1,9 +1,11 @@
 #pragma once
 
 #include <string>
+#include <utility>
 
 #include "core.hpp"
 #include "exception.hpp"
+#include "shader_reflection.hpp"
 
 #include <glm/vec3.hpp>
 #include <glm/matrix.hpp>
@@ -29,21 +31,70 @@ namespace kanso {
 
 	} // namespace exception
 
+	// reads both stages from disk, throws shader_load_exception
+	std::pair<std::string, std::string> read_shader_sources(std::string_view vert_file, std::string_view frag_file);
+
+	// compiles, links and reflects program from sources, name is only used in errors. Throws
+	// shader_compile_exception or shader_linkage_exception. retrievable asks driver to keep program binary for
+	// glGetProgramBinary
+	uint link_program(const std::string& vert_code, const std::string& frag_code, std::string_view name,
+	                  bool retrievable = false);
+
+	// reads, compiles, links and reflects compute program of one file, needs GL 4.3 or ARB_compute_shader.
+	// Throws like the two above
+	uint link_compute_program(std::string_view comp_file);
+
+	// sets uniform at location of program in use, location -1 is ignored
+	void set_uniform_value(int location, const glm::vec3& vector);
+	void set_uniform_value(int location, const glm::mat4& matrix);
+	void set_uniform_value(int location, bool val);
+	void set_uniform_value(int location, int val);
+	void set_uniform_value(int location, float val);
+
+	// Location of uniform resolved once through reflection, set() applies to program in use
+	template <typename T>
+	class uniform {
+		public:
+			uniform() = default;
+			explicit uniform(int location) : location_(location) {}
+
+			void set(const T& value) const {
+				set_uniform_value(location_, value);
+			}
+
+			[[nodiscard]] bool active() const {
+				return location_ >= 0;
+			}
+
+		private:
+			int location_ = -1;
+	};
+
+	// GL program handle, copies share the same program. Programs of files are linked once through shader_cache,
+	// every shader of the same pair shares it
 	class shader {
 		public:
 			shader(std::string_view vert_file, std::string_view frag_file);
+			explicit shader(uint id) : id_(id) {}
 
 			uint id() const {
 				return id_;
 			}
 
-			static void set_uniform(uint shader, std::string_view name, const glm::vec3& vector);
-			static void set_uniform(uint shader, std::string_view name, const glm::mat4& matrix);
-			static void set_uniform(uint shader, std::string_view name, bool val);
-			static void set_uniform(uint shader, std::string_view name, int val);
-			static void set_uniform(uint shader, std::string_view name, float val);
+			// names are hashed at compile time and resolved through program reflection, not glGetUniformLocation
+			static void set_uniform(uint shader, uniform_name name, const glm::vec3& vector);
+			static void set_uniform(uint shader, uniform_name name, const glm::mat4& matrix);
+			static void set_uniform(uint shader, uniform_name name, bool val);
+			static void set_uniform(uint shader, uniform_name name, int val);
+			static void set_uniform(uint shader, uniform_name name, float val);
 			static void use(uint shader);
 
+			// handle for uniforms set every draw, resolve once and keep it next to program
+			template <typename T>
+			static uniform<T> find_uniform(uint shader, uniform_name name) {
+				return uniform<T>{ reflect(shader).location(name.hash()) };
+			}
+
 		private:
 			uint id_;
 	};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core.hpp"
+#include "shader.hpp"
+
+namespace kanso {
+
+	// Process-wide cache of linked programs keyed by shader name and defines, every model asking for the same
+	// pair shares one program. Linked programs are also stored as driver binaries under cache_dir, keyed by
+	// driver and source hash, so warm starts skip GLSL compilation whenever driver accepts its binary back.
+	class shader_cache {
+		public:
+			static shader_cache& instance();
+
+			shader_cache(const shader_cache&)            = delete;
+			shader_cache& operator=(const shader_cache&) = delete;
+
+			// program of shaders/{name}.vert and shaders/{name}.frag, defines are added after #version line
+			// must be called from thread owning GL context
+			shader program(std::string_view name, const std::vector<std::string>& defines = {});
+			// program of any two files, what shader(vert_file, frag_file) links through
+			shader program_of_files(std::string_view vert_file, std::string_view frag_file);
+
+		private:
+			shader_cache() = default;
+
+			std::unordered_map<std::string, shader> programs_;
+			std::string                             cache_dir_ = DEFAULT_SHADER_CACHE_PATH;
+			std::string                             driver_; // vendor, renderer and version, part of binary key
+			bool                                    binaries_supported_ = false;
+			bool                                    driver_queried_     = false;
+
+			[[nodiscard]] std::string entry_path(uint64_t key) const;
+
+			// loads program binary or links sources and keeps program under key
+			shader link(std::string key, std::string_view name, const std::string& vert_code,
+			            const std::string& frag_code);
+
+			uint load_binary(uint64_t key, std::string_view name) const;
+			void store_binary(uint64_t key, uint program, std::string_view name) const;
+	};
+
+} // namespace kanso
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "binary_io.hpp"
+#include "core.hpp"
+
+namespace kanso {
+
+	// fnv1a of name, pass previous result as hash to continue, e.g. with array index digits
+	constexpr uint64_t uniform_hash(std::string_view name, uint64_t hash = FNV1A_OFFSET_BASIS) {
+		for (const char c : name) {
+			hash ^= static_cast<uint8_t>(c);
+			hash *= FNV1A_PRIME;
+		}
+		return hash;
+	}
+
+	// Uniform name hashed at compile time, string literals convert implicitly. Names built at run time go
+	// through from_hash() instead.
+	class uniform_name {
+		public:
+			// NOLINTNEXTLINE(*explicit-conversions)
+			consteval uniform_name(const char* str) : hash_(uniform_hash(str)), name_(str) {}
+
+			static constexpr uniform_name from_hash(uint64_t hash, std::string_view name = {}) {
+				return { hash, name };
+			}
+
+			[[nodiscard]] constexpr uint64_t hash() const {
+				return hash_;
+			}
+
+			// for diagnostics only, empty for some names built at run time
+			[[nodiscard]] constexpr std::string_view name() const {
+				return name_;
+			}
+
+		private:
+			constexpr uniform_name(uint64_t hash, std::string_view name) : hash_(hash), name_(name) {}
+
+			uint64_t         hash_;
+			std::string_view name_;
+	};
+
+	// Active uniforms and uniform blocks of linked program, enumerated once. Struct members and array
+	// elements are listed under their full GLSL names, e.g. "pointLight.pos" or "bones[3]".
+	class program_reflection {
+		public:
+			struct uniform_info {
+				std::string name;
+				uint64_t    hash{};
+				int         location = -1;
+				uint        type{}; // GLenum
+				int         size{};
+			};
+
+			struct block_info {
+				std::string name;
+				uint64_t    hash{};
+				uint        index{};
+				int         data_size{};
+			};
+
+			explicit program_reflection(uint program);
+
+			// -1 if program has no such active uniform, which GL ignores like an unknown name
+			[[nodiscard]] int location(uint64_t hash) const;
+
+			// GL_INVALID_INDEX if program has no such active block
+			[[nodiscard]] uint block_index(uint64_t hash) const;
+
+			[[nodiscard]] const std::vector<uniform_info>& uniforms() const {
+				return uniforms_;
+			}
+
+			[[nodiscard]] const std::vector<block_info>& blocks() const {
+				return blocks_;
+			}
+
+		private:
+			std::vector<uniform_info> uniforms_; // sorted by hash
+			std::vector<block_info>   blocks_;   // sorted by hash
+	};
+
+	// reflection of program, enumerated on first call for each program
+	// must be called from thread owning GL context
+	const program_reflection& reflect(uint program);
+
+} // namespace kanso
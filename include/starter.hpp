@@ -10,6 +10,11 @@ namespace kanso {
 
 			std::unique_ptr<app> make_app();
 
+			// "kanso --convert <in> <out>" converts between JSON and binary scene instead of running app,
+			// output is JSON if its path ends with .json
+			[[nodiscard]] bool converting() const;
+			void               convert() const;
+
 		private:
 			int    argc_;
 			char** argv_;
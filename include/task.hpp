@@ -0,0 +1,167 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+namespace kanso {
+
+	template <typename T = void>
+	class task;
+
+	namespace detail {
+
+		struct task_promise_base {
+			std::coroutine_handle<> continuation;
+			std::exception_ptr      error;
+			bool                    detached = false;
+
+			// resumes whoever awaits task, detached tasks free their own frame instead
+			struct final_awaiter {
+				[[nodiscard]] bool await_ready() const noexcept {
+					return false;
+				}
+
+				template <typename Promise>
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+					auto& promise = handle.promise();
+					if (!promise.detached) {
+						return promise.continuation ? promise.continuation : std::noop_coroutine();
+					}
+
+					if (promise.error) {
+						try {
+							std::rethrow_exception(promise.error);
+						} catch (const std::exception& e) {
+							spdlog::error("Detached task failed: {}", e.what());
+						} catch (...) {
+							spdlog::error("Detached task failed");
+						}
+					}
+					handle.destroy();
+					return std::noop_coroutine();
+				}
+
+				void await_resume() const noexcept {}
+			};
+
+			[[nodiscard]] std::suspend_always initial_suspend() const noexcept {
+				return {};
+			}
+
+			[[nodiscard]] final_awaiter final_suspend() const noexcept {
+				return {};
+			}
+
+			void unhandled_exception() noexcept {
+				error = std::current_exception();
+			}
+
+			void rethrow_if_failed() const {
+				if (error) {
+					std::rethrow_exception(error);
+				}
+			}
+		};
+
+		template <typename T>
+		struct task_promise : task_promise_base {
+			std::optional<T> value;
+
+			task<T> get_return_object() noexcept;
+
+			template <typename U>
+			void return_value(U&& result) {
+				value.emplace(std::forward<U>(result));
+			}
+
+			T result() {
+				rethrow_if_failed();
+				return std::move(*value);
+			}
+		};
+
+		template <>
+		struct task_promise<void> : task_promise_base {
+			task<void> get_return_object() noexcept;
+
+			void return_void() const noexcept {}
+
+			void result() const {
+				rethrow_if_failed();
+			}
+		};
+
+	} // namespace detail
+
+	// Lazy coroutine, its body starts once task is awaited or detached. Awaiting coroutine continues on whichever
+	// thread finished the task, use thread_pool::schedule() or upload_queue::schedule() to move between threads.
+	template <typename T>
+	class [[nodiscard]] task {
+		public:
+			using promise_type = detail::task_promise<T>;
+
+			explicit task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+			task(task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+
+			task& operator=(task&& other) noexcept {
+				if (this != &other) {
+					if (handle_) {
+						handle_.destroy();
+					}
+					handle_ = std::exchange(other.handle_, {});
+				}
+				return *this;
+			}
+
+			task(const task&)            = delete;
+			task& operator=(const task&) = delete;
+
+			~task() {
+				if (handle_) {
+					handle_.destroy();
+				}
+			}
+
+			[[nodiscard]] bool await_ready() const noexcept {
+				return false;
+			}
+
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+				handle_.promise().continuation = awaiting;
+				return handle_;
+			}
+
+			T await_resume() {
+				return handle_.promise().result();
+			}
+
+			// starts task with nobody awaiting it, frame is freed once body finishes and exceptions are logged
+			void detach() && {
+				auto handle               = std::exchange(handle_, {});
+				handle.promise().detached = true;
+				handle.resume();
+			}
+
+		private:
+			std::coroutine_handle<promise_type> handle_;
+	};
+
+	namespace detail {
+
+		template <typename T>
+		task<T> task_promise<T>::get_return_object() noexcept {
+			return task<T>{ std::coroutine_handle<task_promise<T>>::from_promise(*this) };
+		}
+
+		inline task<void> task_promise<void>::get_return_object() noexcept {
+			return task<void>{ std::coroutine_handle<task_promise<void>>::from_promise(*this) };
+		}
+
+	} // namespace detail
+
+} // namespace kanso
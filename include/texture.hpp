@@ -8,17 +8,15 @@
 
 namespace kanso {
 
+	// reference to image in texture_cache, path is the resolved cache key
 	struct raw_tex {
-		uint8_t*    bytes = nullptr;
-		int32_t     width{};
-		int32_t     height{};
-		int32_t     nr_channels{};
 		std::string path;
 		std::string type;
 	};
 
 	class tex_map {
 		public:
+			// data must be resident in texture_cache
 			tex_map(const raw_tex& data);
 
 			const std::string& type() const {
@@ -37,12 +35,23 @@ namespace kanso {
 
 	class texture {
 		public:
-			texture(const std::vector<raw_tex>& raw_tex);
+			texture(std::vector<raw_tex> raw_maps);
+
+			// true once every referenced image is uploaded, maps are resolved on first success
+			bool resident();
 
 			void bind(uint shader) const;
 
+			// id of first image, 0 without images, groups draws sharing textures in render_queue
+			[[nodiscard]] uint sort_id() const;
+
+			// true if both bind the same images in the same order
+			[[nodiscard]] bool same_maps(const texture& other) const;
+
 		private:
+			std::vector<raw_tex>      raw_maps_;
 			std::vector<tex_map>      maps_;
+			bool                      resident_ = false;
 			std::unique_ptr<renderer> renderer_;
 	};
 
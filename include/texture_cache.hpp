@@ -0,0 +1,48 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "core.hpp"
+
+namespace kanso {
+
+	class thread_pool;
+	class upload_queue;
+
+	// Process-wide cache of texture images keyed by resolved path.
+	// Every unique image is decoded once as its own job and uploaded once, all tex_maps share its GL name.
+	// Images are uploaded block compressed from their cooked copy when GL supports it, see texture_cooker.
+	class texture_cache {
+		public:
+			static texture_cache& instance();
+
+			texture_cache(const texture_cache&)            = delete;
+			texture_cache& operator=(const texture_cache&) = delete;
+
+			// schedules decoding on pool unless path was already requested, decoded image is queued to uploads
+			// returns key for resident() and id()
+			std::string request(std::string_view path, thread_pool& pool, upload_queue& uploads);
+
+			// true once image is uploaded or has failed to decode
+			[[nodiscard]] bool resident(const std::string& key) const;
+
+			// GL name of resident image, 0 if image failed to decode
+			[[nodiscard]] uint id(const std::string& key) const;
+
+		private:
+			texture_cache() = default;
+
+			void finish(const std::string& key, uint id);
+
+			struct entry {
+				uint id       = 0;
+				bool resident = false;
+			};
+
+			mutable std::mutex                     mut_;
+			std::unordered_map<std::string, entry> entries_;
+	};
+
+} // namespace kanso
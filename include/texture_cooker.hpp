@@ -0,0 +1,32 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+#include "block_compression.hpp"
+#include "core.hpp"
+
+namespace kanso {
+
+	// Block compressed copies of source images with their full mip chain.
+	// Stored one file per image in a KTX2-like container: header, level index, then level data,
+	// keyed by source path and its mtime, so editing the image invalidates the cooked copy.
+	class texture_cooker {
+		public:
+			texture_cooker(std::string cache_dir = DEFAULT_TEXTURE_CACHE_PATH);
+
+			// returns std::nullopt if cooked copy is missing, stale or corrupt
+			[[nodiscard]] std::optional<compressed_texture> load(std::string_view path) const;
+
+			// decodes source image, encodes every mip level and stores the result for next runs
+			// returns std::nullopt if source image can't be decoded
+			[[nodiscard]] std::optional<compressed_texture> cook(std::string_view path, bool allow_bc7) const;
+
+		private:
+			std::string cache_dir_;
+
+			void                      store(std::string_view path, const compressed_texture& texture) const;
+			[[nodiscard]] std::string entry_path(std::string_view path) const;
+	};
+
+} // namespace kanso
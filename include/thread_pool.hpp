@@ -1,14 +1,112 @@
 #pragma once
 
-#include <queue>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
 #include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 namespace kanso {
 
-	// https://github.com/progschj/thread_pool
+	// Type erased callable run once by thread_pool. Closures up to INLINE_SIZE bytes live inside job,
+	// larger ones are moved to heap.
+	class job {
+		public:
+			static constexpr size_t INLINE_SIZE = 48;
+
+			template <typename F>
+			explicit job(F&& f) {
+				using fn = std::decay_t<F>;
+				if constexpr (sizeof(fn) <= INLINE_SIZE && alignof(fn) <= alignof(std::max_align_t) &&
+				              std::is_nothrow_move_constructible_v<fn>)
+				{
+					target_  = new (storage_.data()) fn(std::forward<F>(f));
+					destroy_ = [](void* target) { static_cast<fn*>(target)->~fn(); };
+				} else {
+					target_  = new fn(std::forward<F>(f));
+					destroy_ = [](void* target) { delete static_cast<fn*>(target); };
+				}
+				invoke_ = [](void* target) { (*static_cast<fn*>(target))(); };
+			}
+
+			~job() {
+				destroy_(target_);
+			}
+
+			job(const job&)            = delete;
+			job& operator=(const job&) = delete;
+			job(job&&)                 = delete;
+			job& operator=(job&&)      = delete;
+
+			void operator()() {
+				invoke_(target_);
+			}
+
+			// job nodes are recycled through a lock-free list shared by all threads instead of going back to heap
+			static void* allocate();
+			static void  deallocate(void* block);
+
+		private:
+			alignas(std::max_align_t) std::array<std::byte, INLINE_SIZE> storage_{};
+			void* target_{};
+			void (*invoke_)(void*){};
+			void (*destroy_)(void*){};
+	};
+
+	// Chase-Lev deque, owner pushes and pops at bottom, other threads steal from top.
+	// https://fzn.fr/readings/ppopp13.pdf
+	class work_stealing_deque {
+		public:
+			work_stealing_deque();
+			~work_stealing_deque();
+
+			work_stealing_deque(const work_stealing_deque&)            = delete;
+			work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+			work_stealing_deque(work_stealing_deque&&)                 = delete;
+			work_stealing_deque& operator=(work_stealing_deque&&)      = delete;
+
+			// owner only
+			void push(job* task);
+			job* pop();
+
+			// any thread
+			job* steal();
+
+		private:
+			struct ring {
+				explicit ring(int64_t size) : capacity(size), slots(new std::atomic<job*>[static_cast<size_t>(size)]) {}
+
+				std::atomic<job*>& at(int64_t i) {
+					return slots[static_cast<size_t>(i & (capacity - 1))];
+				}
+
+				int64_t                              capacity;
+				std::unique_ptr<std::atomic<job*>[]> slots;
+			};
+
+			std::atomic<int64_t> top_{ 0 };
+			std::atomic<int64_t> bottom_{ 0 };
+			std::atomic<ring*>   ring_;
+			// thieves may still read from replaced rings, they are freed with deque
+			std::vector<std::unique_ptr<ring>> rings_;
+	};
+
+	// Work stealing pool. Jobs pushed from worker go to its own deque, jobs from other threads to shared
+	// injection queue. Idle workers steal from random victims before going to sleep.
 	class thread_pool {
 		public:
-			thread_pool(size_t threads);
+			// pin_threads binds worker i to core i, where platform allows it
+			thread_pool(size_t threads, bool pin_threads = false);
 			~thread_pool();
 
 			thread_pool(const thread_pool&)              = delete;
@@ -16,66 +114,172 @@ namespace kanso {
 			thread_pool(const thread_pool&&)             = delete;
 			thread_pool&& operator=(const thread_pool&&) = delete;
 
+			// allocates shared state of returned future on every call, submit() and parallel_for() reuse job nodes and
+			// stop allocating once as many jobs were in flight before
 			template <class F, class... Args>
 			auto enqueue(F&& f, Args&&... args) -> std::future<typename std::invoke_result<F, Args...>::type>;
 
+			// fire and forget, f must not throw
+			template <class F>
+			void submit(F&& f);
+
+			// calls f(first, last) for chunks of [0, count) of at most grain items and returns once all are done,
+			// calling thread runs chunks too, first exception thrown by f is rethrown here
+			template <class F>
+			void parallel_for(size_t count, size_t grain, F&& f);
+
+			// runs one queued job on calling thread, false if there was none
+			bool run_one();
+
+			// co_await pool.schedule() continues coroutine on one of workers
+			struct schedule_awaiter {
+				thread_pool& pool;
+
+				[[nodiscard]] bool await_ready() const noexcept {
+					return false;
+				}
+
+				void await_suspend(std::coroutine_handle<> handle) {
+					pool.submit([handle]() { handle.resume(); });
+				}
+
+				void await_resume() const noexcept {}
+			};
+
+			[[nodiscard]] schedule_awaiter schedule() {
+				return { *this };
+			}
+
+			[[nodiscard]] size_t size() const {
+				return workers_.size();
+			}
+
 		private:
-			std::vector<std::thread>          workers_;
-			std::queue<std::function<void()>> tasks_;
-			std::mutex                        queue_mutex_;
-			std::condition_variable           condition_;
-			bool                              stop_ = false;
-	};
+			struct worker_state {
+				work_stealing_deque deque;
+			};
+
+			// chunk jobs parallel_for queues at once
+			static constexpr size_t PARALLEL_BATCH = 16;
+
+			std::vector<std::unique_ptr<worker_state>> states_;
+			std::vector<std::thread>                   workers_;
+
+			std::deque<job*> injected_;
+			std::mutex       injected_mutex_;
 
-	inline thread_pool::thread_pool(size_t threads) {
-		for (size_t i = 0; i < threads; ++i) {
-			workers_.emplace_back([this] {
-				for (;;) {
-					std::function<void()> task;
-					{
-						std::unique_lock<std::mutex> lock(this->queue_mutex_);
-						this->condition_.wait(lock, [this] { return this->stop_ || !this->tasks_.empty(); });
-						if (this->stop_ && this->tasks_.empty()) {
-							return;
-						}
-						task = std::move(this->tasks_.front());
-						this->tasks_.pop();
-					}
-
-					task();
+			std::atomic<int64_t>    pending_{ 0 }; // queued jobs not taken by any thread yet
+			std::atomic<int>        sleeping_{ 0 };
+			std::mutex              sleep_mutex_;
+			std::condition_variable wake_;
+			std::atomic<bool>       stop_{ false };
+
+			void worker_loop(size_t index);
+			job* find_job(size_t index, uint32_t& seed);
+			void push(job* task);
+			void push_batch(job* const* tasks, size_t count);
+			void wake(int64_t count);
+			void run(job* task);
+
+			// index of calling worker in this pool, -1 for other threads
+			[[nodiscard]] int worker_index() const;
+
+			template <class F>
+			static job* make_job(F&& f) {
+				void* block = job::allocate();
+				try {
+					return new (block) job(std::forward<F>(f));
+				} catch (...) {
+					job::deallocate(block);
+					throw;
 				}
-			});
-		}
-	}
+			}
+	};
 
 	template <class F, class... Args>
 	auto thread_pool::enqueue(F&& f, Args&&... args) -> std::future<typename std::invoke_result<F, Args...>::type> {
 		using return_type = typename std::invoke_result<F, Args...>::type;
 
-		auto task = std::make_shared<std::packaged_task<return_type()>>(
-		    std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-		std::future<return_type> res = task->get_future();
-		{
-			const std::unique_lock<std::mutex> lock(queue_mutex_);
+		std::packaged_task<return_type()> task(
+		    [f = std::forward<F>(f), ... args = std::forward<Args>(args)]() mutable { return std::invoke(f, args...); });
+		std::future<return_type> res = task.get_future();
+		submit(std::move(task));
+		return res;
+	}
+
+	template <class F>
+	void thread_pool::submit(F&& f) {
+		if (stop_.load(std::memory_order_relaxed)) {
+			throw std::runtime_error("enqueue on stopped thread_pool");
+		}
+		push(make_job(std::forward<F>(f)));
+	}
+
+	template <class F>
+	void thread_pool::parallel_for(size_t count, size_t grain, F&& f) {
+		if (count == 0) {
+			return;
+		}
+		grain             = std::max<size_t>(grain, 1);
+		const auto chunks = (count + grain - 1) / grain;
+		if (chunks == 1 || workers_.empty()) {
+			f(size_t{ 0 }, count);
+			return;
+		}
+
+		struct control {
+			std::atomic<size_t> remaining;
+			std::atomic<bool>   failed{ false };
+			std::exception_ptr  error;
+			size_t              count;
+			size_t              grain;
+		};
+		control ctrl{ chunks - 1, false, nullptr, count, grain };
 
-			if (stop_) {
-				throw std::runtime_error("enqueue on stopped thread_pool");
+		const auto run_chunk = [&f, &ctrl](size_t chunk) {
+			try {
+				f(chunk * ctrl.grain, std::min(ctrl.count, (chunk + 1) * ctrl.grain));
+			} catch (...) {
+				if (!ctrl.failed.exchange(true)) {
+					ctrl.error = std::current_exception();
+				}
 			}
+		};
 
-			tasks_.emplace([task]() { (*task)(); });
+		// every chunk but first is queued in batches from a stack array, first one runs here while workers pick up
+		// the rest
+		std::array<job*, PARALLEL_BATCH> batch{};
+		size_t                           batched = 0;
+		size_t                           chunk   = 1;
+		try {
+			for (; chunk < chunks; chunk++) {
+				batch[batched++] = make_job([&run_chunk, &ctrl, chunk]() {
+					run_chunk(chunk);
+					ctrl.remaining.fetch_sub(1, std::memory_order_acq_rel);
+				});
+				if (batched == batch.size()) {
+					push_batch(batch.data(), batched);
+					batched = 0;
+				}
+			}
+		} catch (...) {
+			// chunks without a job never count down, queued ones still use ctrl and are waited for below
+			ctrl.remaining.fetch_sub(chunks - chunk, std::memory_order_acq_rel);
+			if (!ctrl.failed.exchange(true)) {
+				ctrl.error = std::current_exception();
+			}
 		}
-		condition_.notify_one();
-		return res;
-	}
+		push_batch(batch.data(), batched);
 
-	inline thread_pool::~thread_pool() {
-		{
-			const std::unique_lock<std::mutex> lock(queue_mutex_);
-			stop_ = true;
+		run_chunk(0);
+		while (ctrl.remaining.load(std::memory_order_acquire) != 0) {
+			if (!run_one()) {
+				std::this_thread::yield();
+			}
 		}
-		condition_.notify_all();
-		for (std::thread& worker : workers_) {
-			worker.join();
+
+		if (ctrl.error) {
+			std::rethrow_exception(ctrl.error);
 		}
 	}
 
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "renderer.hpp"
+
+namespace kanso {
+
+	constexpr size_t BVH_BINS          = 12; // split candidates per axis
+	constexpr size_t BVH_MAX_LEAF_SIZE = 8;  // leaves never split further are still kept this small
+
+	// Bounding volume hierarchy over triangles of one mesh for exact ray queries. Built with binned surface area
+	// heuristic on import worker and cached with mesh. Nodes are 32 bytes and siblings are stored side by side,
+	// so inner nodes only keep index of their first child. Mesh indices are left alone, leaves refer to ranges of
+	// a separate triangle order.
+	class triangle_bvh {
+		public:
+			struct node {
+				glm::vec3 min;
+				uint32_t  offset; // first triangle in triangles() for leaves, first of two children otherwise
+				glm::vec3 max;
+				uint32_t  count; // triangles of leaf, 0 for inner nodes
+			};
+
+			struct hit {
+				uint32_t  triangle;     // first index of triangle is 3 * triangle
+				float     distance;     // in multiples of ray direction
+				glm::vec2 barycentrics; // weights of second and third corner, first gets the rest
+			};
+
+			triangle_bvh() = default;
+			// restores cached hierarchy
+			triangle_bvh(std::vector<node> nodes, std::vector<uint32_t> triangles);
+
+			static triangle_bvh build(const std::vector<mesh_vertex>& vertices, const std::vector<int>& indices);
+
+			// nearest triangle ray hits from either side, in space of vertices. Direction need not be normalized
+			[[nodiscard]] std::optional<hit> intersect(const std::vector<mesh_vertex>& vertices,
+			                                           const std::vector<int>& indices, const glm::vec3& origin,
+			                                           const glm::vec3& direction,
+			                                           float max_distance = std::numeric_limits<float>::max()) const;
+
+			[[nodiscard]] bool empty() const {
+				return nodes_.empty();
+			}
+
+			[[nodiscard]] const std::vector<node>& nodes() const {
+				return nodes_;
+			}
+
+			[[nodiscard]] const std::vector<uint32_t>& triangles() const {
+				return triangles_;
+			}
+
+		private:
+			std::vector<node>     nodes_; // root first
+			std::vector<uint32_t> triangles_;
+	};
+
+	static_assert(sizeof(triangle_bvh::node) == 32, "Nodes are cached and traversed as 32 byte records");
+
+} // namespace kanso
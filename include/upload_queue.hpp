@@ -0,0 +1,79 @@
+#pragma once
+
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace kanso {
+
+	// GPU uploads produced by import workers. Jobs are executed on render thread by drain()
+	// so creating buffers and textures never stalls a frame for longer than its byte budget.
+	class upload_queue {
+		public:
+			upload_queue() = default;
+
+			upload_queue(const upload_queue&)            = delete;
+			upload_queue& operator=(const upload_queue&) = delete;
+
+			// thread safe, may be called from any worker
+			void push(size_t bytes, std::function<void()> upload);
+
+			// runs queued jobs in order until budget is spent, at least one job runs so big uploads can't starve
+			// returns number of uploaded bytes, must be called from thread owning GL context
+			size_t drain(size_t byte_budget);
+
+			[[nodiscard]] bool empty() const;
+
+			// co_await uploads.schedule(bytes) continues coroutine on render thread as upload job of given size,
+			// frame is destroyed instead if queue goes away before job runs
+			struct schedule_awaiter {
+				upload_queue& queue;
+				size_t        bytes;
+
+				[[nodiscard]] bool await_ready() const noexcept {
+					return false;
+				}
+
+				void await_suspend(std::coroutine_handle<> handle) {
+					queue.push(bytes, [pending = std::make_shared<pending_resume>(handle)]() {
+						std::exchange(pending->handle, {}).resume();
+					});
+				}
+
+				void await_resume() const noexcept {}
+			};
+
+			[[nodiscard]] schedule_awaiter schedule(size_t bytes) {
+				return { *this, bytes };
+			}
+
+		private:
+			struct pending_resume {
+				explicit pending_resume(std::coroutine_handle<> h) : handle(h) {}
+				~pending_resume() {
+					if (handle) {
+						handle.destroy();
+					}
+				}
+
+				pending_resume(const pending_resume&)            = delete;
+				pending_resume& operator=(const pending_resume&) = delete;
+				pending_resume(pending_resume&&)                 = delete;
+				pending_resume& operator=(pending_resume&&)      = delete;
+
+				std::coroutine_handle<> handle;
+			};
+
+			struct upload_job {
+				size_t                bytes{};
+				std::function<void()> upload;
+			};
+
+			mutable std::mutex     mut_;
+			std::deque<upload_job> jobs_;
+	};
+
+} // namespace kanso
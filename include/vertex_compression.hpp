@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+
+#include "renderer.hpp"
+
+namespace kanso {
+
+	// position scale and offset covering every vertex
+	vertex_layout make_compact_layout(const std::vector<mesh_vertex>& vertices);
+
+	std::vector<compact_vertex> pack_vertices(const std::vector<mesh_vertex>& vertices, const vertex_layout& layout);
+
+	// maps unit vector to [-1, 1] square, decoded by octDecode() in vertex shaders
+	glm::vec2 encode_octahedral(const glm::vec3& normal);
+
+	// meshes with less than 65536 vertices are drawn with 16 bit indices
+	bool fits_short_indices(size_t vertex_count);
+
+	size_t vertex_stride(vertex_format format);
+	size_t index_stride(size_t vertex_count);
+
+} // namespace kanso
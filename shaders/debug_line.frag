@@ -0,0 +1,5 @@
+#version 410 core
+out vec4 FragColor;
+void main() {
+	FragColor = vec4(1.0, 0.0, 0.0, 1.0);
+}
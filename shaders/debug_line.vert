@@ -0,0 +1,14 @@
+#version 410 core
+
+// world space, written by render_queue once per frame
+layout (location = 0) in vec3 aPos;
+
+layout (std140) uniform Camera {
+	mat4 view;
+	mat4 proj;
+	vec4 viewPos;
+};
+
+void main() {
+	gl_Position = proj * view * vec4(aPos, 1.0);
+}
@@ -12,132 +12,116 @@ struct Material {
 	float shininess;
 };
 
-struct PointLight {
-	vec3 pos;
-	vec3 ambient;
-	vec3 diffuse;
-	vec3 specular;
-	float constant;
-	float linear;
-	float quadratic;
+// must match light_buffer.hpp
+#define MAX_DIRECTIONAL_LIGHTS 4
+#define LIGHT_TEXELS 5
+
+// scalars are packed into w components, see gpu_light in light_buffer.hpp
+struct Light {
+	vec4 pos;       // w: constant
+	vec4 ambient;   // w: linear
+	vec4 diffuse;   // w: quadratic
+	vec4 specular;  // w: cos(outerCutOff), below -1 for point lights
+	vec4 direction; // w: cos(innerCutOff)
 };
 
-struct DirLight {
-	vec3 direction;
-	vec3 ambient;
-	vec3 diffuse;
-	vec3 specular;
+layout (std140) uniform Lights {
+	ivec4 lightCounts;   // directional, point and spot
+	ivec4 clusterDims;   // x, y, z
+	vec4 clusterDepth;   // slice scale, slice bias, zNear, zFar
+	vec4 clusterScreen;  // clusters per pixel in x and y
+	Light dirLights[MAX_DIRECTIONAL_LIGHTS];
 };
 
-struct SpotLight {
-	vec3 pos;
-	vec3 direction;
-	vec3 ambient;
-	vec3 diffuse;
-	vec3 specular;
-	float innerCutOff;
-	float outerCutOff;
-	float constant;
-	float linear;
-	float quadratic;
+// written by render_queue once per frame
+layout (std140) uniform Camera {
+	mat4 view;
+	mat4 proj;
+	vec4 viewPos;
 };
 
+// point and spot lights, LIGHT_TEXELS texels each
+uniform samplerBuffer lightData;
+// offset and count into lightIndices per cluster
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer lightIndices;
+
 uniform Material material;
-uniform PointLight pointLight;
-uniform DirLight dirLight;
-uniform SpotLight spotLight;
-uniform vec3 viewPos;
 uniform bool useTexture;
 
-vec3 calcPointLight(PointLight pointLight, vec3 normal, vec3 fragPos, vec3 viewDir);
-vec3 calcDirLight(DirLight dirLight, vec3 normal, vec3 viewDir);
-vec3 calcSpotLight(SpotLight spotLight, vec3 normal, vec3 fragPos, vec3 viewDir);
-
-void main() {
-	vec3 normal = normalize(Normal);
-	vec3 viewDir = normalize(viewPos - FragPos);
+vec3 calcLocalLight(Light light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 tex);
+vec3 calcDirLight(Light dirLight, vec3 normal, vec3 viewDir, vec3 tex);
 
-	vec3 result = vec3(0.0f);
-	result += calcDirLight(dirLight, normal, viewDir);
-	result += calcPointLight(pointLight, normal, FragPos, viewDir);
-	result += calcSpotLight(spotLight, normal, FragPos, viewDir);
-	FragColor = vec4(result, 1.0);
+Light fetchLight(int index) {
+	int base = index * LIGHT_TEXELS;
+	return Light(texelFetch(lightData, base), texelFetch(lightData, base + 1), texelFetch(lightData, base + 2),
+	             texelFetch(lightData, base + 3), texelFetch(lightData, base + 4));
 }
 
-vec3 calcPointLight(PointLight pointLight, vec3 normal, vec3 fragPos, vec3 viewDir) {
-	vec3 lightDir = normalize(pointLight.pos - fragPos);
-	float diff_contrib = max(dot(normal, lightDir), 0.0);
-	vec3 reflectDir = reflect(-lightDir, normal);
-	float spec_degree = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+// cluster of this fragment, slices split view depth exponentially
+int clusterIndex() {
+	float zNear = clusterDepth.z;
+	float zFar = clusterDepth.w;
+	float ndc = gl_FragCoord.z * 2.0 - 1.0;
+	float depth = 2.0 * zNear * zFar / (zFar + zNear - ndc * (zFar - zNear));
 
-	float distance = length(pointLight.pos - fragPos);
-	float attenuation = 1.0 / (pointLight.constant + pointLight.linear * distance + pointLight.quadratic * (distance * distance));
-
-	vec3 tex;
-	if (useTexture) {
-		tex = texture(material.texture_diffuse1, TexCoords).rgb;
-	} else {
-		tex = vec3(1, 1, 1);
-	}
+	int slice = clamp(int(log(depth) * clusterDepth.x + clusterDepth.y), 0, clusterDims.z - 1);
+	ivec2 tile = clamp(ivec2(gl_FragCoord.xy * clusterScreen.xy), ivec2(0), clusterDims.xy - 1);
+	return tile.x + tile.y * clusterDims.x + slice * clusterDims.x * clusterDims.y;
+}
 
-	vec3 ambient = pointLight.ambient * tex;
-	vec3 diffuse = pointLight.diffuse * diff_contrib * tex;
-	vec3 specular = pointLight.specular * spec_degree * tex;
+void main() {
+	vec3 normal = normalize(Normal);
+	vec3 viewDir = normalize(viewPos.xyz - FragPos);
+	vec3 tex = useTexture ? texture(material.texture_diffuse1, TexCoords).rgb : vec3(1.0);
 
-	ambient *= attenuation;
-	diffuse *= attenuation;
-	specular *= attenuation;
+	vec3 result = vec3(0.0f);
+	for (int i = 0; i < lightCounts.x; i++) {
+		result += calcDirLight(dirLights[i], normal, viewDir, tex);
+	}
 
-	return (ambient + diffuse + specular);
+	uvec2 range = texelFetch(clusterGrid, clusterIndex()).xy;
+	for (uint i = 0u; i < range.y; i++) {
+		int index = int(texelFetch(lightIndices, int(range.x + i)).x);
+		result += calcLocalLight(fetchLight(index), normal, FragPos, viewDir, tex);
+	}
+	FragColor = vec4(result, 1.0);
 }
 
-vec3 calcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
-	vec3 lightDir = normalize(light.pos - fragPos);
-    float diff = max(dot(normal, lightDir), 0.0);
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-
-    float distance = length(light.pos - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+// point lights carry a cone that covers every direction, so one formula serves both kinds
+vec3 calcLocalLight(Light light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 tex) {
+	vec3 lightDir = normalize(light.pos.xyz - fragPos);
+	float diff = max(dot(normal, lightDir), 0.0);
+	vec3 reflectDir = reflect(-lightDir, normal);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
 
-    float theta = dot(lightDir, normalize(-light.direction));
-    float epsilon = light.innerCutOff - light.outerCutOff;
-    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+	float distance = length(light.pos.xyz - fragPos);
+	float attenuation = 1.0 / (light.pos.w + light.ambient.w * distance + light.diffuse.w * (distance * distance));
 
-	vec3 tex;
-	if (useTexture) {
-		tex = texture(material.texture_diffuse1, TexCoords).rgb;
-	} else {
-		tex = vec3(1, 1, 1);
-	}
+	float theta = dot(lightDir, normalize(-light.direction.xyz));
+	float epsilon = max(light.direction.w - light.specular.w, 1e-4);
+	float intensity = clamp((theta - light.specular.w) / epsilon, 0.0, 1.0);
 
-	vec3 ambient = light.ambient * tex;
-	vec3 diffuse = light.diffuse * diff * tex;
-	vec3 specular = light.specular * spec * tex;
+	vec3 ambient = light.ambient.rgb * tex;
+	vec3 diffuse = light.diffuse.rgb * diff * tex;
+	vec3 specular = light.specular.rgb * spec * tex;
 
-    ambient *= attenuation * intensity;
-    diffuse *= attenuation * intensity;
-    specular *= attenuation * intensity;
+	ambient *= attenuation * intensity;
+	diffuse *= attenuation * intensity;
+	specular *= attenuation * intensity;
 
 	return (ambient + diffuse + specular);
 }
 
-vec3 calcDirLight(DirLight dirLight, vec3 normal, vec3 viewDir) {
-	vec3 lightDir = normalize(-dirLight.direction);
+vec3 calcDirLight(Light dirLight, vec3 normal, vec3 viewDir, vec3 tex) {
+	vec3 lightDir = normalize(-dirLight.direction.xyz);
 	float diff_contrib = max(dot(normal, lightDir), 0.0);
 	vec3 reflectDir = reflect(-lightDir, normal);
 	float spec_degree = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
 
-	vec3 tex;
-	if (useTexture) {
-		tex = texture(material.texture_diffuse1, TexCoords).rgb;
-	} else {
-		tex = vec3(1, 1, 1);
-	}
-
-	vec3 ambient = dirLight.ambient * tex;
-	vec3 diffuse = dirLight.diffuse * diff_contrib * tex;
-	vec3 specular = dirLight.specular * spec_degree * tex;
+	vec3 ambient = dirLight.ambient.rgb * tex;
+	vec3 diffuse = dirLight.diffuse.rgb * diff_contrib * tex;
+	vec3 specular = dirLight.specular.rgb * spec_degree * tex;
 
 	return (ambient + diffuse + specular);
 }
@@ -3,19 +3,39 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+// per instance, see instance_data in renderer.hpp
+layout (location = 3) in mat4 instanceModel;
+layout (location = 7) in mat3 instanceNormal;
+layout (location = 10) in vec4 instanceVertexOffset; // w is 1 for compact vertices
+layout (location = 11) in vec3 instanceVertexScale;
 
 out vec2 TexCoords;
 out vec3 Normal;
 out vec3 FragPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 proj;
+// written by render_queue once per frame
+layout (std140) uniform Camera {
+	mat4 view;
+	mat4 proj;
+	vec4 viewPos;
+};
+
+vec3 octDecode(vec2 e) {
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
 
 void main() {
+	// compact vertices carry position relative to mesh bounds and octahedral normal in aNormal.xy
+	bool compactVertex = instanceVertexOffset.w > 0.5;
+	vec3 pos = compactVertex ? instanceVertexOffset.xyz + aPos * instanceVertexScale : aPos;
+	vec3 normal = compactVertex ? octDecode(aNormal.xy) : aNormal;
+
 	TexCoords = aTexCoords;
-	Normal = mat3(transpose(inverse(model))) * aNormal;
-	FragPos = vec3(model * vec4(aPos, 1.0));
+	Normal = instanceNormal * normal;
+	FragPos = vec3(instanceModel * vec4(pos, 1.0));
 
-	gl_Position = proj * view * model * vec4(aPos, 1.0);
+	gl_Position = proj * view * vec4(FragPos, 1.0);
 }
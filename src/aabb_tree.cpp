@@ -0,0 +1,371 @@
+#include "aabb_tree.hpp"
+#include "raycast.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <utility>
+
+namespace kanso {
+
+	namespace {
+
+		// leaves are enlarged by this fraction of their size plus a fixed margin in world units
+		constexpr float FAT_FRACTION = 0.1f;
+		constexpr float FAT_MARGIN   = 0.01f;
+
+		constexpr float NO_HIT = std::numeric_limits<float>::infinity();
+
+		// half of surface area, the chance a random ray through parent also crosses the box
+		float area(const glm::vec3& min, const glm::vec3& max) {
+			const glm::vec3 size = max - min;
+			return size.x * size.y + size.y * size.z + size.z * size.x;
+		}
+
+		bool contains(const glm::vec3& outer_min, const glm::vec3& outer_max, const glm::vec3& min,
+		              const glm::vec3& max) {
+			return outer_min.x <= min.x && outer_min.y <= min.y && outer_min.z <= min.z && max.x <= outer_max.x &&
+			       max.y <= outer_max.y && max.z <= outer_max.z;
+		}
+
+		bool overlaps(const glm::vec3& a_min, const glm::vec3& a_max, const glm::vec3& b_min, const glm::vec3& b_max) {
+			return a_min.x <= b_max.x && b_min.x <= a_max.x && a_min.y <= b_max.y && b_min.y <= a_max.y &&
+			       a_min.z <= b_max.z && b_min.z <= a_max.z;
+		}
+
+		float distance_sq(const glm::vec3& point, const glm::vec3& min, const glm::vec3& max) {
+			const glm::vec3 offset = glm::max(glm::max(min - point, point - max), glm::vec3(0.0f));
+			return glm::dot(offset, offset);
+		}
+
+		bool in_frustum(const std::array<glm::vec4, 6>& planes, const glm::vec3& min, const glm::vec3& max) {
+			const glm::vec3 center = (min + max) * 0.5f;
+			const glm::vec3 extent = (max - min) * 0.5f;
+			return std::all_of(planes.begin(), planes.end(), [&](const glm::vec4& plane) {
+				const glm::vec3 normal(plane);
+				return glm::dot(normal, center) + plane.w + glm::dot(glm::abs(normal), extent) >= 0.0f;
+			});
+		}
+
+	} // namespace
+
+	int32_t aabb_tree::insert(const glm::vec3& min, const glm::vec3& max, uint32_t value) {
+		const int32_t   proxy  = allocate_node();
+		const glm::vec3 margin = (max - min) * FAT_FRACTION + glm::vec3(FAT_MARGIN);
+
+		auto& leaf   = at(proxy);
+		leaf.min     = min - margin;
+		leaf.max     = max + margin;
+		leaf.box_min = min;
+		leaf.box_max = max;
+		leaf.value   = value;
+		insert_leaf(proxy);
+		leaves_++;
+		return proxy;
+	}
+
+	void aabb_tree::remove(int32_t proxy) {
+		remove_leaf(proxy);
+		release_node(proxy);
+		leaves_--;
+	}
+
+	bool aabb_tree::move(int32_t proxy, const glm::vec3& min, const glm::vec3& max) {
+		auto& leaf   = at(proxy);
+		leaf.box_min = min;
+		leaf.box_max = max;
+		if (contains(leaf.min, leaf.max, min, max)) {
+			return false;
+		}
+
+		remove_leaf(proxy);
+		const glm::vec3 margin = (max - min) * FAT_FRACTION + glm::vec3(FAT_MARGIN);
+		at(proxy).min          = min - margin;
+		at(proxy).max          = max + margin;
+		insert_leaf(proxy);
+		return true;
+	}
+
+	void aabb_tree::clear() {
+		nodes_.clear();
+		root_   = NULL_NODE;
+		free_   = NULL_NODE;
+		leaves_ = 0;
+	}
+
+	std::optional<aabb_tree::ray_hit> aabb_tree::nearest_hit(const raycast& ray, const hit_test& test) const {
+		std::optional<ray_hit> best;
+		float                  best_distance = NO_HIT;
+		if (root_ == NULL_NODE) {
+			return best;
+		}
+
+		// nearer child is visited first, subtrees entered beyond best hit so far are skipped
+		auto enter = [this, &ray](int32_t index) {
+			return std::pair{ index, ray.entry_distance(at(index).min, at(index).max) };
+		};
+		std::vector<std::pair<int32_t, float>> stack{ enter(root_) };
+		while (!stack.empty()) {
+			const auto [index, entry] = stack.back();
+			stack.pop_back();
+			if (entry >= best_distance) {
+				continue;
+			}
+
+			const auto& current = at(index);
+			if (current.leaf()) {
+				float distance = ray.entry_distance(current.box_min, current.box_max);
+				if (distance < best_distance && test) {
+					distance = test(current.value, distance);
+				}
+				if (distance < best_distance) {
+					best_distance = distance;
+					best          = ray_hit{ current.value, distance };
+				}
+				continue;
+			}
+
+			auto nearer  = enter(current.left);
+			auto farther = enter(current.right);
+			if (farther.second < nearer.second) {
+				std::swap(nearer, farther);
+			}
+			if (farther.second < best_distance) {
+				stack.push_back(farther);
+			}
+			if (nearer.second < best_distance) {
+				stack.push_back(nearer);
+			}
+		}
+		return best;
+	}
+
+	void aabb_tree::all_hits(const raycast& ray, std::vector<uint32_t>& values) const {
+		collect([&ray](const glm::vec3& min, const glm::vec3& max) { return ray.is_intersects(min, max); }, values);
+	}
+
+	void aabb_tree::overlap_box(const glm::vec3& min, const glm::vec3& max, std::vector<uint32_t>& values) const {
+		collect([&min, &max](const glm::vec3& node_min, const glm::vec3& node_max) {
+			return overlaps(node_min, node_max, min, max);
+		}, values);
+	}
+
+	void aabb_tree::overlap_sphere(const glm::vec3& center, float radius, std::vector<uint32_t>& values) const {
+		collect([&center, radius_sq = radius * radius](const glm::vec3& min, const glm::vec3& max) {
+			return distance_sq(center, min, max) <= radius_sq;
+		}, values);
+	}
+
+	void aabb_tree::overlap_frustum(const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& values) const {
+		collect([&planes](const glm::vec3& min, const glm::vec3& max) { return in_frustum(planes, min, max); }, values);
+	}
+
+	void aabb_tree::nearest(const glm::vec3& point, size_t k, std::vector<uint32_t>& values) const {
+		if (root_ == NULL_NODE || k == 0) {
+			return;
+		}
+
+		// best first, inner boxes hold everything below them so nothing under one is nearer than it. Leaves are
+		// queued by their exact box and come out in order
+		using entry = std::pair<float, int32_t>;
+		std::priority_queue<entry, std::vector<entry>, std::greater<>> queue;
+
+		auto push = [this, &point, &queue](int32_t index) {
+			const auto& current = at(index);
+			queue.emplace(current.leaf() ? distance_sq(point, current.box_min, current.box_max)
+			                             : distance_sq(point, current.min, current.max),
+			              index);
+		};
+		push(root_);
+
+		const size_t first = values.size();
+		while (!queue.empty() && values.size() - first < k) {
+			const auto& current = at(queue.top().second);
+			queue.pop();
+			if (current.leaf()) {
+				values.push_back(current.value);
+			} else {
+				push(current.left);
+				push(current.right);
+			}
+		}
+	}
+
+	void aabb_tree::collect(const box_test& test, std::vector<uint32_t>& values) const {
+		if (root_ == NULL_NODE) {
+			return;
+		}
+		// enlarged boxes only lead the way, leaves answer with their exact box
+		std::vector<int32_t> stack{ root_ };
+		while (!stack.empty()) {
+			const auto& current = at(stack.back());
+			stack.pop_back();
+			if (current.leaf()) {
+				if (test(current.box_min, current.box_max)) {
+					values.push_back(current.value);
+				}
+			} else if (test(current.min, current.max)) {
+				stack.push_back(current.left);
+				stack.push_back(current.right);
+			}
+		}
+	}
+
+	int32_t aabb_tree::allocate_node() {
+		if (free_ == NULL_NODE) {
+			nodes_.emplace_back();
+			return static_cast<int32_t>(nodes_.size() - 1);
+		}
+		const int32_t index = free_;
+		free_               = at(index).parent;
+		at(index)           = node{};
+		return index;
+	}
+
+	void aabb_tree::release_node(int32_t index) {
+		at(index).parent = free_;
+		at(index).height = -1;
+		free_            = index;
+	}
+
+	void aabb_tree::insert_leaf(int32_t leaf) {
+		if (root_ == NULL_NODE) {
+			root_           = leaf;
+			at(leaf).parent = NULL_NODE;
+			return;
+		}
+
+		// descends while pairing leaf deeper costs less than pairing it here. Every ancestor grows to hold leaf,
+		// so cost is added area of ancestors plus area of new parent
+		const glm::vec3 leaf_min = at(leaf).min;
+		const glm::vec3 leaf_max = at(leaf).max;
+		auto            grown    = [&leaf_min, &leaf_max](const node& other) {
+			return area(glm::min(other.min, leaf_min), glm::max(other.max, leaf_max));
+		};
+		// leaf pairs with a leaf child as new parent, while an inner child only grows by leaf
+		auto descend_cost = [this, &grown](int32_t child) {
+			const auto& candidate = at(child);
+			return candidate.leaf() ? grown(candidate) : grown(candidate) - area(candidate.min, candidate.max);
+		};
+
+		int32_t sibling = root_;
+		while (!at(sibling).leaf()) {
+			const auto& current    = at(sibling);
+			const float combined   = grown(current);
+			const float inherited  = 2.0f * (combined - area(current.min, current.max));
+			const float left_cost  = descend_cost(current.left) + inherited;
+			const float right_cost = descend_cost(current.right) + inherited;
+			if (2.0f * combined < left_cost && 2.0f * combined < right_cost) {
+				break;
+			}
+			sibling = left_cost < right_cost ? current.left : current.right;
+		}
+
+		const int32_t old_parent = at(sibling).parent;
+		const int32_t new_parent = allocate_node();
+		auto&         parent     = at(new_parent);
+		parent.parent            = old_parent;
+		parent.left              = sibling;
+		parent.right             = leaf;
+		parent.min               = glm::min(at(sibling).min, leaf_min);
+		parent.max               = glm::max(at(sibling).max, leaf_max);
+		parent.height            = at(sibling).height + 1;
+		at(sibling).parent       = new_parent;
+		at(leaf).parent          = new_parent;
+
+		if (old_parent == NULL_NODE) {
+			root_ = new_parent;
+		} else if (at(old_parent).left == sibling) {
+			at(old_parent).left = new_parent;
+		} else {
+			at(old_parent).right = new_parent;
+		}
+		refit(old_parent);
+	}
+
+	void aabb_tree::remove_leaf(int32_t leaf) {
+		if (leaf == root_) {
+			root_ = NULL_NODE;
+			return;
+		}
+
+		// sibling takes place of their parent
+		const int32_t parent      = at(leaf).parent;
+		const int32_t grandparent = at(parent).parent;
+		const int32_t sibling     = at(parent).left == leaf ? at(parent).right : at(parent).left;
+		at(sibling).parent        = grandparent;
+		release_node(parent);
+
+		if (grandparent == NULL_NODE) {
+			root_ = sibling;
+			return;
+		}
+		if (at(grandparent).left == parent) {
+			at(grandparent).left = sibling;
+		} else {
+			at(grandparent).right = sibling;
+		}
+		refit(grandparent);
+	}
+
+	void aabb_tree::refit(int32_t index) {
+		while (index != NULL_NODE) {
+			index = rotate(index);
+
+			auto&       current = at(index);
+			const auto& left    = at(current.left);
+			const auto& right   = at(current.right);
+			current.min         = glm::min(left.min, right.min);
+			current.max         = glm::max(left.max, right.max);
+			current.height      = std::max(left.height, right.height) + 1;
+			index               = current.parent;
+		}
+	}
+
+	int32_t aabb_tree::rotate(int32_t index) {
+		auto& a = at(index);
+		if (a.leaf() || a.height < 2) {
+			return index;
+		}
+
+		// taller child b takes place of a, a takes place of taller grandchild and keeps the shorter one
+		const int32_t balance = at(a.right).height - at(a.left).height;
+		if (balance >= -1 && balance <= 1) {
+			return index;
+		}
+		const bool    right_taller = balance > 1;
+		const int32_t b_index      = right_taller ? a.right : a.left;
+		auto&         b            = at(b_index);
+		const int32_t taller       = at(b.left).height > at(b.right).height ? b.left : b.right;
+		const int32_t shorter      = taller == b.left ? b.right : b.left;
+
+		b.parent = a.parent;
+		a.parent = b_index;
+		if (b.parent == NULL_NODE) {
+			root_ = b_index;
+		} else if (at(b.parent).left == index) {
+			at(b.parent).left = b_index;
+		} else {
+			at(b.parent).right = b_index;
+		}
+
+		b.left  = index;
+		b.right = taller;
+		if (right_taller) {
+			a.right = shorter;
+		} else {
+			a.left = shorter;
+		}
+		at(shorter).parent = index;
+
+		a.min    = glm::min(at(a.left).min, at(a.right).min);
+		a.max    = glm::max(at(a.left).max, at(a.right).max);
+		a.height = std::max(at(a.left).height, at(a.right).height) + 1;
+		b.min    = glm::min(a.min, at(taller).min);
+		b.max    = glm::max(a.max, at(taller).max);
+		b.height = std::max(a.height, at(taller).height) + 1;
+		return b_index;
+	}
+
+} // namespace kanso
@@ -3,10 +3,10 @@
 #include <spdlog/spdlog.h>
 
 namespace kanso {
-	app::app(nlohmann::json json)
+	app::app(scene_description scene)
 	    : close_(false),
 	      window_(std::make_shared<glfw_window>()),
-	      loader_(std::make_unique<loader>(std::move(json))),
+	      loader_(std::make_unique<loader>(std::move(scene))),
 		  scene_(loader_->make_scene()),
 		  camera_(loader_->make_camera()),
 		  renderer_(renderer_factory::make_renderer()),
@@ -16,6 +16,8 @@ namespace kanso {
 	void app::update() {
 		renderer_->clear(0.5f, 0.5f, 0.5f);
 
+		loader_->update(*scene_);
+
 		scene_->draw(*camera_, *window_);
 
 		gui_->draw();
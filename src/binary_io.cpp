@@ -0,0 +1,103 @@
+#include "binary_io.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace kanso {
+
+	uint64_t fnv1a(const uint8_t* bytes, size_t size, uint64_t hash) {
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i]; // NOLINT(*pointer-arithmetic)
+			hash *= FNV1A_PRIME;
+		}
+		return hash;
+	}
+
+	bool source_stamp(std::string_view path, int64_t& mtime, uint64_t& size) {
+		std::error_code ec;
+		const auto      time = std::filesystem::last_write_time(path, ec);
+		if (ec) {
+			return false;
+		}
+		const auto file_size = std::filesystem::file_size(path, ec);
+		if (ec) {
+			return false;
+		}
+		mtime = static_cast<int64_t>(time.time_since_epoch().count());
+		size  = static_cast<uint64_t>(file_size);
+		return true;
+	}
+
+	bool write_file_atomically(const std::string& path, const std::function<void(std::ostream&)>& writer) {
+		std::error_code ec;
+		std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+		const auto tmp_path = fmt::format("{}.{}.tmp", path, std::hash<std::thread::id>{}(std::this_thread::get_id()));
+		{
+			std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+			if (!out) {
+				return false;
+			}
+			writer(out);
+			if (!out) {
+				out.close();
+				std::filesystem::remove(tmp_path, ec);
+				return false;
+			}
+		}
+
+		std::filesystem::rename(tmp_path, path, ec);
+		if (ec) {
+			spdlog::warn("Failed to move {} into place: {}", path, ec.message());
+			std::filesystem::remove(tmp_path, ec);
+			return false;
+		}
+		return true;
+	}
+
+	mapped_file::mapped_file(const std::string& path) {
+#ifdef _WIN32
+		std::ifstream stream(path, std::ios::binary);
+		if (stream) {
+			buffer_.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+			data_ = reinterpret_cast<const uint8_t*>(buffer_.data()); // NOLINT(*reinterpret-cast)
+			size_ = buffer_.size();
+		}
+#else
+		const int fd = open(path.c_str(), O_RDONLY); // NOLINT(*vararg)
+		if (fd < 0) {
+			return;
+		}
+		struct stat st {};
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+			if (addr != MAP_FAILED) { // NOLINT(*cstyle-cast)
+				data_ = static_cast<const uint8_t*>(addr);
+				size_ = static_cast<size_t>(st.st_size);
+			}
+		}
+		close(fd);
+#endif
+	}
+
+	mapped_file::~mapped_file() {
+#ifndef _WIN32
+		if (data_ != nullptr) {
+			munmap(const_cast<uint8_t*>(data_), size_); // NOLINT(*const-cast)
+		}
+#endif
+	}
+
+} // namespace kanso
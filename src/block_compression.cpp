@@ -0,0 +1,376 @@
+#include "block_compression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace kanso {
+
+	namespace {
+
+		constexpr size_t BLOCK_TEXELS = 16;
+
+		using texel_block = std::array<std::array<float, 4>, BLOCK_TEXELS>;
+
+		texel_block load_block(const uint8_t* texels) {
+			texel_block block{};
+			for (size_t i = 0; i < BLOCK_TEXELS; i++) {
+				for (size_t c = 0; c < 4; c++) {
+					block[i][c] = texels[i * 4 + c]; // NOLINT(*pointer-arithmetic)
+				}
+			}
+			return block;
+		}
+
+		// endpoints spanning texels along principal axis of first N channels
+		template <size_t N>
+		std::pair<std::array<float, 4>, std::array<float, 4>> fit_endpoints(const texel_block& block) {
+			std::array<float, 4> mean{};
+			for (const auto& texel : block) {
+				for (size_t c = 0; c < N; c++) {
+					mean[c] += texel[c] / static_cast<float>(BLOCK_TEXELS);
+				}
+			}
+
+			std::array<std::array<float, N>, N> covariance{};
+			for (const auto& texel : block) {
+				for (size_t i = 0; i < N; i++) {
+					for (size_t j = 0; j < N; j++) {
+						covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+					}
+				}
+			}
+
+			// power iteration, a few steps are enough to separate dominant axis in 4x4 block
+			std::array<float, N> axis{};
+			axis.fill(1.0f);
+			for (int step = 0; step < 8; step++) {
+				std::array<float, N> next{};
+				for (size_t i = 0; i < N; i++) {
+					for (size_t j = 0; j < N; j++) {
+						next[i] += covariance[i][j] * axis[j];
+					}
+				}
+				float length = 0.0f;
+				for (const auto v : next) {
+					length = std::max(length, std::abs(v));
+				}
+				if (length == 0.0f) {
+					break;
+				}
+				for (size_t i = 0; i < N; i++) {
+					axis[i] = next[i] / length;
+				}
+			}
+
+			float axis_length2 = 0.0f;
+			for (const auto v : axis) {
+				axis_length2 += v * v;
+			}
+
+			float t_min = 0.0f;
+			float t_max = 0.0f;
+			if (axis_length2 > 0.0f) {
+				t_min = std::numeric_limits<float>::max();
+				t_max = std::numeric_limits<float>::lowest();
+				for (const auto& texel : block) {
+					float t = 0.0f;
+					for (size_t c = 0; c < N; c++) {
+						t += (texel[c] - mean[c]) * axis[c];
+					}
+					t /= axis_length2;
+					t_min = std::min(t_min, t);
+					t_max = std::max(t_max, t);
+				}
+			}
+
+			std::array<float, 4> lo = mean;
+			std::array<float, 4> hi = mean;
+			for (size_t c = 0; c < N; c++) {
+				lo[c] = std::clamp(mean[c] + axis[c] * t_min, 0.0f, 255.0f);
+				hi[c] = std::clamp(mean[c] + axis[c] * t_max, 0.0f, 255.0f);
+			}
+			return { lo, hi };
+		}
+
+		template <size_t N, size_t P>
+		std::array<uint32_t, BLOCK_TEXELS> select_indices(const texel_block&                          block,
+		                                                  const std::array<std::array<float, 4>, P>& palette) {
+			std::array<uint32_t, BLOCK_TEXELS> indices{};
+			for (size_t i = 0; i < BLOCK_TEXELS; i++) {
+				float best = std::numeric_limits<float>::max();
+				for (size_t p = 0; p < P; p++) {
+					float error = 0.0f;
+					for (size_t c = 0; c < N; c++) {
+						const float d = block[i][c] - palette[p][c];
+						error += d * d;
+					}
+					if (error < best) {
+						best       = error;
+						indices[i] = static_cast<uint32_t>(p);
+					}
+				}
+			}
+			return indices;
+		}
+
+		uint16_t to_565(const std::array<float, 4>& color) {
+			const auto r = static_cast<uint16_t>(std::lround(color[0] * 31.0f / 255.0f));
+			const auto g = static_cast<uint16_t>(std::lround(color[1] * 63.0f / 255.0f));
+			const auto b = static_cast<uint16_t>(std::lround(color[2] * 31.0f / 255.0f));
+			return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+		}
+
+		std::array<float, 4> from_565(uint16_t color) {
+			const auto r = static_cast<float>((color >> 11) & 0x1f);
+			const auto g = static_cast<float>((color >> 5) & 0x3f);
+			const auto b = static_cast<float>(color & 0x1f);
+			return { std::round(r * 255.0f / 31.0f), std::round(g * 255.0f / 63.0f), std::round(b * 255.0f / 31.0f),
+				     255.0f };
+		}
+
+		void store_le(uint8_t* out, uint64_t value, size_t bytes) {
+			for (size_t i = 0; i < bytes; i++) {
+				out[i] = static_cast<uint8_t>(value >> (8 * i)); // NOLINT(*pointer-arithmetic)
+			}
+		}
+
+		// little-endian bit stream used by BC7
+		class bit_writer {
+			public:
+				void put(uint32_t value, size_t bits) {
+					for (size_t i = 0; i < bits; i++, offset_++) {
+						if (((value >> i) & 1U) != 0) {
+							bytes_[offset_ / 8] |= static_cast<uint8_t>(1U << (offset_ % 8));
+						}
+					}
+				}
+
+				[[nodiscard]] const std::array<uint8_t, 16>& bytes() const {
+					return bytes_;
+				}
+
+			private:
+				std::array<uint8_t, 16> bytes_{};
+				size_t                  offset_ = 0;
+		};
+
+		// mode 6 uses 7 bit endpoints plus one shared low bit per endpoint
+		constexpr std::array<uint32_t, 16> BC7_WEIGHTS = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		std::pair<std::array<uint32_t, 4>, uint32_t> quantize_bc7_endpoint(const std::array<float, 4>& color) {
+			std::array<uint32_t, 4> best_values{};
+			uint32_t                best_p     = 0;
+			float                   best_error = std::numeric_limits<float>::max();
+			for (uint32_t p = 0; p < 2; p++) {
+				std::array<uint32_t, 4> values{};
+				float                   error = 0.0f;
+				for (size_t c = 0; c < 4; c++) {
+					const float q = std::clamp(std::round((color[c] - static_cast<float>(p)) / 2.0f), 0.0f, 127.0f);
+					values[c]     = static_cast<uint32_t>(q);
+					const float d = static_cast<float>((values[c] << 1) | p) - color[c];
+					error += d * d;
+				}
+				if (error < best_error) {
+					best_error  = error;
+					best_values = values;
+					best_p      = p;
+				}
+			}
+			return { best_values, best_p };
+		}
+
+	} // namespace
+
+	size_t compressed_texture::size() const {
+		size_t total = 0;
+		for (const auto& level : levels) {
+			total += level.size();
+		}
+		return total;
+	}
+
+	block_format pick_block_format(int nr_channels, bool allow_bc7) {
+		switch (nr_channels) {
+			case 1:
+				return block_format::bc4;
+			case 2:
+				return block_format::bc5;
+			case 3:
+				return block_format::bc1;
+			default:
+				return allow_bc7 ? block_format::bc7 : block_format::bc3;
+		}
+	}
+
+	size_t block_bytes(block_format format) {
+		return format == block_format::bc1 || format == block_format::bc4 ? 8 : 16;
+	}
+
+	std::vector<uint8_t> compress_blocks(const uint8_t* rgba, int width, int height, block_format format) {
+		const int            blocks_x = (width + 3) / 4;
+		const int            blocks_y = (height + 3) / 4;
+		const size_t         stride   = block_bytes(format);
+		std::vector<uint8_t> out(static_cast<size_t>(blocks_x) * static_cast<size_t>(blocks_y) * stride);
+
+		std::array<uint8_t, BLOCK_TEXELS * 4> texels{};
+		uint8_t*                              dst = out.data();
+		for (int by = 0; by < blocks_y; by++) {
+			for (int bx = 0; bx < blocks_x; bx++) {
+				// partial blocks on right and bottom edges repeat last texel
+				for (int y = 0; y < 4; y++) {
+					const int sy = std::min(by * 4 + y, height - 1);
+					for (int x = 0; x < 4; x++) {
+						const int  sx  = std::min(bx * 4 + x, width - 1);
+						const auto src = (static_cast<size_t>(sy) * static_cast<size_t>(width) + static_cast<size_t>(sx)) * 4;
+						std::memcpy(&texels[static_cast<size_t>(y * 4 + x) * 4], rgba + src, 4); // NOLINT(*pointer-arithmetic)
+					}
+				}
+
+				switch (format) {
+					case block_format::bc1:
+						bc::encode_bc1(texels.data(), dst);
+						break;
+					case block_format::bc3:
+						bc::encode_bc3(texels.data(), dst);
+						break;
+					case block_format::bc4:
+						bc::encode_bc4(texels.data(), dst);
+						break;
+					case block_format::bc5:
+						bc::encode_bc5(texels.data(), dst);
+						break;
+					case block_format::bc7:
+						bc::encode_bc7(texels.data(), dst);
+						break;
+				}
+				dst += stride; // NOLINT(*pointer-arithmetic)
+			}
+		}
+		return out;
+	}
+
+	namespace bc {
+
+		void encode_bc1(const uint8_t* texels, uint8_t* out) {
+			const auto block  = load_block(texels);
+			auto [lo, hi]     = fit_endpoints<3>(block);
+			uint16_t color0   = to_565(hi);
+			uint16_t color1   = to_565(lo);
+			uint32_t selector = 0;
+
+			if (color0 < color1) {
+				std::swap(color0, color1);
+			}
+			if (color0 != color1) {
+				// color0 > color1 selects four color mode without transparency
+				const auto                             e0 = from_565(color0);
+				const auto                             e1 = from_565(color1);
+				std::array<std::array<float, 4>, 4> palette{ e0, e1, e0, e0 };
+				for (size_t c = 0; c < 3; c++) {
+					palette[2][c] = (2.0f * e0[c] + e1[c]) / 3.0f;
+					palette[3][c] = (e0[c] + 2.0f * e1[c]) / 3.0f;
+				}
+				const auto indices = select_indices<3>(block, palette);
+				for (size_t i = 0; i < BLOCK_TEXELS; i++) {
+					selector |= indices[i] << (2 * i);
+				}
+			}
+
+			store_le(out, color0, 2);
+			store_le(out + 2, color1, 2);   // NOLINT(*pointer-arithmetic)
+			store_le(out + 4, selector, 4); // NOLINT(*pointer-arithmetic)
+		}
+
+		void encode_bc3(const uint8_t* texels, uint8_t* out) {
+			encode_bc4(texels, out, 3);
+			encode_bc1(texels, out + 8); // NOLINT(*pointer-arithmetic)
+		}
+
+		void encode_bc4(const uint8_t* texels, uint8_t* out, int channel) {
+			const auto block = load_block(texels);
+			const auto c     = static_cast<size_t>(channel);
+
+			float lo = 255.0f;
+			float hi = 0.0f;
+			for (const auto& texel : block) {
+				lo = std::min(lo, texel[c]);
+				hi = std::max(hi, texel[c]);
+			}
+
+			uint64_t selector = 0;
+			if (hi > lo) {
+				// red0 > red1 selects eight value mode
+				std::array<std::array<float, 4>, 8> palette{};
+				palette[0][0] = hi;
+				palette[1][0] = lo;
+				for (size_t i = 2; i < 8; i++) {
+					palette[i][0] = std::floor((static_cast<float>(8 - i) * hi + static_cast<float>(i - 1) * lo) / 7.0f);
+				}
+
+				texel_block values{};
+				for (size_t i = 0; i < BLOCK_TEXELS; i++) {
+					values[i][0] = block[i][c];
+				}
+				const auto indices = select_indices<1>(values, palette);
+				for (size_t i = 0; i < BLOCK_TEXELS; i++) {
+					selector |= static_cast<uint64_t>(indices[i]) << (3 * i);
+				}
+			}
+
+			out[0] = static_cast<uint8_t>(hi);
+			out[1] = static_cast<uint8_t>(lo);  // NOLINT(*pointer-arithmetic)
+			store_le(out + 2, selector, 6); // NOLINT(*pointer-arithmetic)
+		}
+
+		void encode_bc5(const uint8_t* texels, uint8_t* out) {
+			encode_bc4(texels, out, 0);
+			encode_bc4(texels, out + 8, 1); // NOLINT(*pointer-arithmetic)
+		}
+
+		void encode_bc7(const uint8_t* texels, uint8_t* out) {
+			const auto block = load_block(texels);
+			auto [lo, hi]    = fit_endpoints<4>(block);
+
+			auto [q0, p0] = quantize_bc7_endpoint(lo);
+			auto [q1, p1] = quantize_bc7_endpoint(hi);
+
+			std::array<std::array<float, 4>, 16> palette{};
+			for (size_t i = 0; i < 16; i++) {
+				for (size_t c = 0; c < 4; c++) {
+					const uint32_t e0 = (q0[c] << 1) | p0;
+					const uint32_t e1 = (q1[c] << 1) | p1;
+					palette[i][c]     = static_cast<float>(((64 - BC7_WEIGHTS[i]) * e0 + BC7_WEIGHTS[i] * e1 + 32) >> 6);
+				}
+			}
+			auto indices = select_indices<4>(block, palette);
+
+			// anchor texel is stored with implicit zero high bit, flip endpoints to keep it below 8
+			if (indices[0] >= 8) {
+				std::swap(q0, q1);
+				std::swap(p0, p1);
+				for (auto& index : indices) {
+					index = 15 - index;
+				}
+			}
+
+			bit_writer bits;
+			bits.put(1U << 6, 7);
+			for (size_t c = 0; c < 4; c++) {
+				bits.put(q0[c], 7);
+				bits.put(q1[c], 7);
+			}
+			bits.put(p0, 1);
+			bits.put(p1, 1);
+			bits.put(indices[0], 3);
+			for (size_t i = 1; i < BLOCK_TEXELS; i++) {
+				bits.put(indices[i], 4);
+			}
+			std::memcpy(out, bits.bytes().data(), bits.bytes().size());
+		}
+
+	} // namespace bc
+
+} // namespace kanso
@@ -0,0 +1,152 @@
+#include "dynamic_ring.hpp"
+#include "glad/glad.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+
+namespace kanso {
+
+	namespace {
+
+		// keeps every region start aligned for uniform buffer ranges on any driver
+		constexpr size_t REGION_ALIGNMENT = 256;
+
+		// polls with flush so a fence never waits on commands still sitting in driver queue
+		constexpr GLuint64 WAIT_TIMEOUT_NS = 1'000'000;
+
+		constexpr GLbitfield PERSISTENT_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+		// previous contents of region are dead and its fence already waited, so driver must neither copy nor sync
+		constexpr GLbitfield FRAME_MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+		                                       GL_MAP_UNSYNCHRONIZED_BIT;
+
+		size_t align_up(size_t value, size_t alignment) {
+			return (value + alignment - 1) & ~(alignment - 1);
+		}
+
+	} // namespace
+
+	dynamic_ring::dynamic_ring(size_t region_size) : persistent_(GLAD_GL_ARB_buffer_storage != 0) {
+		create(region_size);
+	}
+
+	dynamic_ring::~dynamic_ring() {
+		destroy();
+	}
+
+	void dynamic_ring::create(size_t region_size) {
+		region_size_    = align_up(std::max(region_size, REGION_ALIGNMENT), REGION_ALIGNMENT);
+		const auto size = static_cast<GLsizeiptr>(region_size_ * DEFAULT_RING_FRAMES);
+
+		glGenBuffers(1, &buffer_);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+		if (persistent_) {
+			glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, PERSISTENT_FLAGS);
+			mapped_ = static_cast<std::byte*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, PERSISTENT_FLAGS));
+		} else {
+			glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	void dynamic_ring::destroy() {
+		for (size_t region = 0; region < fences_.size(); region++) {
+			wait(region);
+		}
+		if (persistent_ && mapped_ != nullptr) {
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		}
+		mapped_ = nullptr;
+		glDeleteBuffers(1, &buffer_);
+		buffer_ = 0;
+	}
+
+	void dynamic_ring::wait(size_t region) {
+		auto* fence = static_cast<GLsync>(fences_[region]);
+		if (fence == nullptr) {
+			return;
+		}
+		fences_[region] = nullptr;
+
+		auto status = glClientWaitSync(fence, 0, 0);
+		if (status == GL_TIMEOUT_EXPIRED) {
+			const auto start = std::chrono::steady_clock::now();
+			while (status == GL_TIMEOUT_EXPIRED) {
+				status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, WAIT_TIMEOUT_NS);
+			}
+			stats_.stalls++;
+			stats_.stall_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+			                       .count();
+		}
+		if (status == GL_WAIT_FAILED) {
+			spdlog::error("Waiting on fence of dynamic buffer region {} failed", region);
+		}
+		glDeleteSync(fence);
+	}
+
+	void dynamic_ring::begin_frame(size_t min_size) {
+		if (in_frame_) {
+			end_frame();
+		}
+
+		// growing replaces buffer, so every region still in flight has to finish first
+		if (align_up(min_size, REGION_ALIGNMENT) > region_size_) {
+			const auto region_size = std::bit_ceil(min_size);
+			spdlog::debug("Growing dynamic buffer regions from {} to {} bytes", region_size_, region_size);
+			destroy();
+			create(region_size);
+		}
+
+		region_   = (region_ + 1) % DEFAULT_RING_FRAMES;
+		used_     = 0;
+		in_frame_ = true;
+		wait(region_);
+		stats_.frames++;
+
+		if (!persistent_) {
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+			mapped_ = static_cast<std::byte*>(glMapBufferRange(GL_COPY_WRITE_BUFFER,
+			                                                   static_cast<GLintptr>(region_ * region_size_),
+			                                                   static_cast<GLsizeiptr>(region_size_), FRAME_MAP_FLAGS));
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		}
+	}
+
+	dynamic_ring::allocation dynamic_ring::allocate(size_t size, size_t alignment) {
+		const auto begin = align_up(used_, alignment);
+		if (!in_frame_ || mapped_ == nullptr || begin + size > region_size_) {
+			return {};
+		}
+		used_             = begin + size;
+		stats_.peak_bytes = std::max(stats_.peak_bytes, used_);
+
+		// persistent mapping covers whole buffer, per frame mapping only current region
+		const auto region_start = region_ * region_size_;
+		return { mapped_ + (persistent_ ? region_start : 0) + begin, region_start + begin }; // NOLINT(*pointer-arithmetic)
+	}
+
+	void dynamic_ring::flush() {
+		if (persistent_ || mapped_ == nullptr) {
+			return;
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		mapped_ = nullptr;
+	}
+
+	void dynamic_ring::end_frame() {
+		if (!in_frame_) {
+			return;
+		}
+		flush();
+		fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		in_frame_        = false;
+	}
+
+} // namespace kanso
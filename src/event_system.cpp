@@ -181,16 +181,9 @@ namespace kanso {
 				/* scene_->add_model(std::make_unique<line>(ray.get_origin() + glm::vec3{ 0, 0, -0.5 }, */
 				/*                                          ray.get_origin() + displacement)); */
 
-				auto it = std::find_if(scene_->model_begin(), scene_->model_end(), [ray](const auto& model) {
-					if (!model->is_scene_model()) {
-						return false;
-					}
-
-					const std::shared_ptr<const scene_model> sm = std::static_pointer_cast<const scene_model>(model);
-					return ray.is_intersects(sm->aabb_min(), sm->aabb_max());
-				});
-				if (it != scene_->model_end()) {
-					(*it)->select_toggle();
+				// nearest hit, boxes behind it are never tested
+				if (const auto picked = scene_->pick(ray)) {
+					picked->select_toggle();
 				}
 			}
 		};
@@ -0,0 +1,217 @@
+#include "frustum_culling.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#define KANSO_CULLING_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KANSO_CULLING_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace kanso {
+
+	namespace {
+
+		// below this many boxes splitting over workers costs more than it saves
+		constexpr size_t PARALLEL_BOXES = 4096;
+		constexpr size_t BATCH_GRAIN    = 64;
+
+#if defined(KANSO_CULLING_AVX)
+		__m256 dot3(__m256 x, __m256 y, __m256 z, const glm::vec3& v) {
+			const __m256 xy = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(v.x)),
+			                                _mm256_mul_ps(y, _mm256_set1_ps(v.y)));
+			return _mm256_add_ps(xy, _mm256_mul_ps(z, _mm256_set1_ps(v.z)));
+		}
+
+		__m256 length_sq(__m256 x, __m256 y, __m256 z) {
+			return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+		}
+#elif defined(KANSO_CULLING_SSE2)
+		__m128 dot3(__m128 x, __m128 y, __m128 z, const glm::vec3& v) {
+			return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(v.x)), _mm_mul_ps(y, _mm_set1_ps(v.y))),
+			                  _mm_mul_ps(z, _mm_set1_ps(v.z)));
+		}
+
+		__m128 length_sq(__m128 x, __m128 y, __m128 z) {
+			return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+		}
+
+		// four boxes from first, same tests as AVX path
+		uint32_t sse2_mask(const box_list& boxes, size_t first, const std::array<glm::vec4, 6>& planes,
+		                   const glm::vec3& camera_pos, float screen_scale_sq) {
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 cx   = _mm_loadu_ps(&boxes.center_x[first]);
+			const __m128 cy   = _mm_loadu_ps(&boxes.center_y[first]);
+			const __m128 cz   = _mm_loadu_ps(&boxes.center_z[first]);
+			const __m128 ex   = _mm_loadu_ps(&boxes.extent_x[first]);
+			const __m128 ey   = _mm_loadu_ps(&boxes.extent_y[first]);
+			const __m128 ez   = _mm_loadu_ps(&boxes.extent_z[first]);
+
+			__m128 inside = _mm_cmpeq_ps(zero, zero);
+			for (const auto& plane : planes) {
+				const __m128 distance = _mm_add_ps(dot3(cx, cy, cz, glm::vec3(plane)), _mm_set1_ps(plane.w));
+				const __m128 reach    = dot3(ex, ey, ez, glm::abs(glm::vec3(plane)));
+				inside                = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), zero));
+			}
+
+			if (screen_scale_sq > 0.0f) {
+				const __m128 dx        = _mm_sub_ps(cx, _mm_set1_ps(camera_pos.x));
+				const __m128 dy        = _mm_sub_ps(cy, _mm_set1_ps(camera_pos.y));
+				const __m128 dz        = _mm_sub_ps(cz, _mm_set1_ps(camera_pos.z));
+				const __m128 dist_sq   = length_sq(dx, dy, dz);
+				const __m128 radius_sq = length_sq(ex, ey, ez);
+				const __m128 scaled    = _mm_mul_ps(radius_sq, _mm_set1_ps(screen_scale_sq));
+				const __m128 large     = _mm_or_ps(_mm_cmple_ps(dist_sq, radius_sq), _mm_cmpge_ps(scaled, dist_sq));
+				inside                 = _mm_and_ps(inside, large);
+			}
+			return static_cast<uint32_t>(_mm_movemask_ps(inside));
+		}
+#endif
+
+	} // namespace
+
+	void box_list::clear() {
+		for (auto* component : { &center_x, &center_y, &center_z, &extent_x, &extent_y, &extent_z }) {
+			component->clear();
+		}
+		count = 0;
+	}
+
+	void box_list::push(const glm::vec3& min, const glm::vec3& max) {
+		// padding boxes are empty and at origin, their results are never read
+		if (count == center_x.size()) {
+			for (auto* component : { &center_x, &center_y, &center_z, &extent_x, &extent_y, &extent_z }) {
+				component->resize(count + CULL_BATCH, 0.0f);
+			}
+		}
+		const glm::vec3 center = (min + max) * 0.5f;
+		const glm::vec3 extent = (max - min) * 0.5f;
+		center_x[count]        = center.x;
+		center_y[count]        = center.y;
+		center_z[count]        = center.z;
+		extent_x[count]        = extent.x;
+		extent_y[count]        = extent.y;
+		extent_z[count]        = extent.z;
+		count++;
+	}
+
+	std::pair<glm::vec3, glm::vec3> box_list::box(size_t index) const {
+		const glm::vec3 center{ center_x[index], center_y[index], center_z[index] };
+		const glm::vec3 extent{ extent_x[index], extent_y[index], extent_z[index] };
+		return { center - extent, center + extent };
+	}
+
+	// https://www.realtimerendering.com/resources/GraphicsGems/gems/TransBox.c
+	std::pair<glm::vec3, glm::vec3> transform_box(const glm::mat4& matrix, const glm::vec3& min, const glm::vec3& max) {
+		const glm::vec3 center = matrix * glm::vec4((min + max) * 0.5f, 1.0f);
+		const glm::vec3 half   = (max - min) * 0.5f;
+		glm::vec3       extent{ 0.0f };
+		for (int column = 0; column < 3; column++) {
+			extent += glm::abs(glm::vec3(matrix[column])) * half[column];
+		}
+		return { center - extent, center + extent };
+	}
+
+	frustum_culler::frustum_culler(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camera_pos,
+	                               float min_screen_size)
+	    : camera_pos_(camera_pos) {
+		// planes are sums and differences of rows of view projection, Gribb and Hartmann
+		const glm::mat4 rows = glm::transpose(proj * view);
+		planes_              = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1],
+		                         rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2] };
+		for (auto& plane : planes_) {
+			plane /= glm::length(glm::vec3(plane));
+		}
+
+		// box of radius r at distance d covers r * proj[1][1] / d of viewport height
+		if (min_screen_size > 0.0f) {
+			const float scale = proj[1][1] / min_screen_size;
+			screen_scale_sq_  = scale * scale;
+		}
+	}
+
+	uint32_t frustum_culler::batch_mask(const box_list& boxes, size_t first) const {
+#if defined(KANSO_CULLING_AVX)
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 cx   = _mm256_loadu_ps(&boxes.center_x[first]);
+		const __m256 cy   = _mm256_loadu_ps(&boxes.center_y[first]);
+		const __m256 cz   = _mm256_loadu_ps(&boxes.center_z[first]);
+		const __m256 ex   = _mm256_loadu_ps(&boxes.extent_x[first]);
+		const __m256 ey   = _mm256_loadu_ps(&boxes.extent_y[first]);
+		const __m256 ez   = _mm256_loadu_ps(&boxes.extent_z[first]);
+
+		// box is outside once its corner furthest along a plane normal is behind the plane
+		__m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+		for (const auto& plane : planes_) {
+			const __m256 distance = _mm256_add_ps(dot3(cx, cy, cz, glm::vec3(plane)), _mm256_set1_ps(plane.w));
+			const __m256 reach    = dot3(ex, ey, ez, glm::abs(glm::vec3(plane)));
+			const __m256 kept     = _mm256_cmp_ps(_mm256_add_ps(distance, reach), zero, _CMP_GE_OQ);
+			inside                = _mm256_and_ps(inside, kept);
+		}
+
+		// boxes around camera are always kept, further ones only if large enough on screen
+		if (screen_scale_sq_ > 0.0f) {
+			const __m256 dx        = _mm256_sub_ps(cx, _mm256_set1_ps(camera_pos_.x));
+			const __m256 dy        = _mm256_sub_ps(cy, _mm256_set1_ps(camera_pos_.y));
+			const __m256 dz        = _mm256_sub_ps(cz, _mm256_set1_ps(camera_pos_.z));
+			const __m256 dist_sq   = length_sq(dx, dy, dz);
+			const __m256 radius_sq = length_sq(ex, ey, ez);
+			const __m256 scaled    = _mm256_mul_ps(radius_sq, _mm256_set1_ps(screen_scale_sq_));
+			const __m256 large     = _mm256_or_ps(_mm256_cmp_ps(dist_sq, radius_sq, _CMP_LE_OQ),
+			                                      _mm256_cmp_ps(scaled, dist_sq, _CMP_GE_OQ));
+			inside                 = _mm256_and_ps(inside, large);
+		}
+		return static_cast<uint32_t>(_mm256_movemask_ps(inside));
+#elif defined(KANSO_CULLING_SSE2)
+		return sse2_mask(boxes, first, planes_, camera_pos_, screen_scale_sq_) |
+		       (sse2_mask(boxes, first + 4, planes_, camera_pos_, screen_scale_sq_) << 4);
+#else
+		uint32_t mask = 0;
+		for (size_t i = 0; i < CULL_BATCH; i++) {
+			const glm::vec3 center{ boxes.center_x[first + i], boxes.center_y[first + i], boxes.center_z[first + i] };
+			const glm::vec3 extent{ boxes.extent_x[first + i], boxes.extent_y[first + i], boxes.extent_z[first + i] };
+
+			bool inside = true;
+			for (const auto& plane : planes_) {
+				const glm::vec3 normal(plane);
+				inside = inside && glm::dot(normal, center) + plane.w + glm::dot(glm::abs(normal), extent) >= 0.0f;
+			}
+			if (screen_scale_sq_ > 0.0f) {
+				const float dist_sq   = glm::dot(center - camera_pos_, center - camera_pos_);
+				const float radius_sq = glm::dot(extent, extent);
+				inside                = inside && (dist_sq <= radius_sq || radius_sq * screen_scale_sq_ >= dist_sq);
+			}
+			if (inside) {
+				mask |= 1U << i;
+			}
+		}
+		return mask;
+#endif
+	}
+
+	size_t frustum_culler::cull(const box_list& boxes, std::vector<uint8_t>& visible, thread_pool* pool) const {
+		visible.resize(boxes.count);
+		const auto batches = (boxes.count + CULL_BATCH - 1) / CULL_BATCH;
+
+		auto cull_batches = [this, &boxes, &visible](size_t first_batch, size_t last_batch) {
+			for (size_t batch = first_batch; batch < last_batch; batch++) {
+				const auto first = batch * CULL_BATCH;
+				const auto mask  = batch_mask(boxes, first);
+				for (size_t i = first; i < std::min(first + CULL_BATCH, boxes.count); i++) {
+					visible[i] = static_cast<uint8_t>((mask >> (i - first)) & 1U);
+				}
+			}
+		};
+		if (pool != nullptr && boxes.count >= PARALLEL_BOXES) {
+			pool->parallel_for(batches, BATCH_GRAIN, cull_batches);
+		} else {
+			cull_batches(0, batches);
+		}
+		return static_cast<size_t>(std::count(visible.begin(), visible.end(), uint8_t{ 1 }));
+	}
+
+} // namespace kanso
@@ -0,0 +1,259 @@
+#include "geometry_arena.hpp"
+#include "glad/glad.h"
+#include "vertex_compression.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <memory>
+
+namespace kanso {
+
+	namespace {
+
+		// arenas start small enough for simple scenes and double whenever an allocation does not fit
+		constexpr size_t INITIAL_VERTICES = size_t{ 1 } << 18;
+		constexpr size_t INITIAL_INDICES  = size_t{ 1 } << 20;
+
+		// owner of arenas while GL context lives
+		geometry_arenas* current_arenas = nullptr;
+
+		uint gen_buffer(GLenum target, size_t size) {
+			uint buffer{};
+			glGenBuffers(1, &buffer);
+			glBindBuffer(target, buffer);
+			glBufferData(target, static_cast<GLsizeiptr>(size), nullptr, GL_STATIC_DRAW);
+			glBindBuffer(target, 0);
+			return buffer;
+		}
+
+	} // namespace
+
+	range_allocator::range_allocator(size_t capacity) : capacity_(capacity) {
+		if (capacity > 0) {
+			free_.emplace(0, capacity);
+		}
+	}
+
+	std::optional<size_t> range_allocator::allocate(size_t size) {
+		if (size == 0) {
+			return 0;
+		}
+		for (auto it = free_.begin(); it != free_.end(); ++it) {
+			if (it->second < size) {
+				continue;
+			}
+			const auto offset = it->first;
+			const auto rest   = it->second - size;
+			free_.erase(it);
+			if (rest > 0) {
+				free_.emplace(offset + size, rest);
+			}
+			return offset;
+		}
+		return std::nullopt;
+	}
+
+	void range_allocator::release(size_t offset, size_t size) {
+		if (size == 0) {
+			return;
+		}
+		auto next = free_.lower_bound(offset);
+		// merge with free range ending where this one starts
+		if (next != free_.begin()) {
+			auto prev = std::prev(next);
+			if (prev->first + prev->second == offset) {
+				offset = prev->first;
+				size += prev->second;
+				free_.erase(prev);
+			}
+		}
+		// and with the one starting where it ends
+		if (next != free_.end() && offset + size == next->first) {
+			size += next->second;
+			free_.erase(next);
+		}
+		free_.emplace(offset, size);
+	}
+
+	void range_allocator::grow(size_t capacity) {
+		if (capacity <= capacity_) {
+			return;
+		}
+		const auto old_capacity = capacity_;
+		capacity_               = capacity;
+		release(old_capacity, capacity - old_capacity);
+	}
+
+	geometry_arenas::geometry_arenas() {
+		assert(current_arenas == nullptr); // NOLINT
+		current_arenas = this;
+	}
+
+	geometry_arenas::~geometry_arenas() {
+		current_arenas = nullptr;
+	}
+
+	geometry_arena& geometry_arena::get(vertex_format format, uint index_type) {
+		assert(current_arenas != nullptr); // NOLINT
+		auto& arenas = current_arenas->arenas_;
+		auto& arena  = arenas[(format == vertex_format::compact ? 2 : 0) + (index_type == GL_UNSIGNED_SHORT ? 1 : 0)];
+		if (arena == nullptr) {
+			arena.reset(new geometry_arena(format, index_type));
+		}
+		return *arena;
+	}
+
+	geometry_arena::geometry_arena(vertex_format format, uint index_type)
+	    : format_(format),
+	      index_type_(index_type),
+	      vertex_stride_(vertex_stride(format)),
+	      index_stride_(index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t)),
+	      vertices_(INITIAL_VERTICES),
+	      indices_(INITIAL_INDICES) {
+		glGenVertexArrays(1, &vao_);
+		vbo_ = gen_buffer(GL_ARRAY_BUFFER, INITIAL_VERTICES * vertex_stride_);
+		ebo_ = gen_buffer(GL_ELEMENT_ARRAY_BUFFER, INITIAL_INDICES * index_stride_);
+		bind_buffers();
+	}
+
+	geometry_arena::~geometry_arena() {
+		glDeleteVertexArrays(1, &vao_);
+		glDeleteBuffers(1, &vbo_);
+		glDeleteBuffers(1, &ebo_);
+	}
+
+	geometry_arena::allocation geometry_arena::allocate(const void* vertices, size_t vertex_count, const void* indices,
+	                                                    size_t index_count) {
+		allocation result{ reserve(vertices_, vbo_, vertex_stride_, vertex_count), vertex_count,
+		                   reserve(indices_, ebo_, index_stride_, index_count), index_count };
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, vbo_);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(result.first_vertex * vertex_stride_),
+		                static_cast<GLsizeiptr>(vertex_count * vertex_stride_), vertices);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ebo_);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(result.first_index * index_stride_),
+		                static_cast<GLsizeiptr>(index_count * index_stride_), indices);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		return result;
+	}
+
+	void geometry_arena::release(const allocation& range) {
+		vertices_.release(range.first_vertex, range.vertex_count);
+		indices_.release(range.first_index, range.index_count);
+	}
+
+	size_t geometry_arena::reserve(range_allocator& ranges, uint& buffer, size_t stride, size_t count) {
+		if (auto offset = ranges.allocate(count)) {
+			return *offset;
+		}
+
+		const auto old_capacity = ranges.capacity();
+		auto       capacity     = old_capacity;
+		while (capacity < old_capacity + count) {
+			capacity *= 2;
+		}
+		spdlog::debug("Growing geometry arena buffer {} from {} to {} elements", buffer, old_capacity, capacity);
+		buffer = grow_buffer(buffer, old_capacity, capacity, stride);
+		ranges.grow(capacity);
+		bind_buffers();
+		return *ranges.allocate(count);
+	}
+
+	uint geometry_arena::grow_buffer(uint buffer, size_t old_capacity, size_t new_capacity, size_t stride) {
+		// copy stays on GPU, contents never come back to this thread
+		const uint grown = gen_buffer(GL_COPY_WRITE_BUFFER, new_capacity * stride);
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+		                    static_cast<GLsizeiptr>(old_capacity * stride));
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glDeleteBuffers(1, &buffer);
+		return grown;
+	}
+
+	void geometry_arena::bind_buffers() {
+		glBindVertexArray(vao_);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+		set_vertex_attributes(format_);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	arena_renderer::arena_renderer(const std::vector<mesh_vertex>& vertices, const std::vector<int>& indices,
+	                               vertex_format format)
+	    : arena_(&geometry_arena::get(format, fits_short_indices(vertices.size()) ? GL_UNSIGNED_SHORT
+	                                                                                 : GL_UNSIGNED_INT)) {
+		std::vector<compact_vertex> packed;
+		const void*                 vertex_data = vertices.data();
+		if (format == vertex_format::compact) {
+			layout_     = make_compact_layout(vertices);
+			packed      = pack_vertices(vertices, layout_);
+			vertex_data = packed.data();
+		}
+
+		// indices stay relative to mesh, draws add base_vertex()
+		if (arena_->index_type() == GL_UNSIGNED_SHORT) {
+			std::vector<uint16_t> short_indices(indices.size());
+			std::transform(indices.begin(), indices.end(), short_indices.begin(),
+			               [](int index) { return static_cast<uint16_t>(index); });
+			allocation_ = arena_->allocate(vertex_data, vertices.size(), short_indices.data(), short_indices.size());
+		} else {
+			allocation_ = arena_->allocate(vertex_data, vertices.size(), indices.data(), indices.size());
+		}
+	}
+
+	arena_renderer::~arena_renderer() {
+		arena_->release(allocation_);
+	}
+
+	void arena_renderer::draw_triangles() {
+		draw_triangles(0, allocation_.index_count);
+	}
+
+	void arena_renderer::draw_triangles(size_t first_index, size_t index_count) {
+		bind();
+		draw_bound(first_index, index_count);
+		unbind();
+	}
+
+	void arena_renderer::bind() {
+		glBindVertexArray(arena_->vertex_array());
+	}
+
+	void arena_renderer::draw_bound(size_t first_index, size_t index_count) {
+		draw_bound_instanced(first_index, index_count, 1);
+	}
+
+	void arena_renderer::draw_bound_instanced(size_t first_index, size_t index_count, size_t instances) {
+		const size_t index_size = arena_->index_type() == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<int>(index_count), arena_->index_type(),
+		                                  reinterpret_cast<const void*>((base_index() + first_index) * index_size), // NOLINT(*reinterpret-cast,*int-to-ptr)
+		                                  static_cast<int>(instances), base_vertex());
+	}
+
+	uint arena_renderer::vertex_array() const {
+		return arena_->vertex_array();
+	}
+
+	vertex_layout arena_renderer::layout() const {
+		return layout_;
+	}
+
+	size_t arena_renderer::base_index() const {
+		return allocation_.first_index;
+	}
+
+	int arena_renderer::base_vertex() const {
+		return static_cast<int>(allocation_.first_vertex);
+	}
+
+	uint arena_renderer::index_type() const {
+		return arena_->index_type();
+	}
+
+} // namespace kanso
@@ -0,0 +1,183 @@
+#include "gpu_culling.hpp"
+#include "frustum_culling.hpp"
+#include "renderer.hpp"
+#include "glad/glad.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace kanso {
+
+	namespace {
+
+		// local sizes of shaders/cull.comp and shaders/hiz.comp
+		constexpr GLuint CULL_GROUP    = 64;
+		constexpr GLuint PYRAMID_GROUP = 8;
+
+		// storage buffer bindings of shaders/cull.comp and image unit of shaders/hiz.comp
+		constexpr GLuint BOUNDS_BINDING  = 0;
+		constexpr GLuint SOURCE_BINDING  = 1;
+		constexpr GLuint COMMAND_BINDING = 2;
+		constexpr GLuint VISIBLE_BINDING = 3;
+		constexpr GLuint PYRAMID_IMAGE   = 0;
+
+		constexpr size_t COMMAND_SIZE = 5 * sizeof(uint32_t); // DrawElementsIndirectCommand
+
+		static_assert(sizeof(instance_data) == 32 * sizeof(uint32_t), "shaders/cull.comp copies 32 words per instance");
+		static_assert(sizeof(gpu_culler::instance_bounds) == 32, "Bounds of shaders/cull.comp are 32 bytes in std430");
+
+		GLuint groups(size_t count, GLuint group) {
+			return static_cast<GLuint>((count + group - 1) / group);
+		}
+
+	} // namespace
+
+	bool gpu_culler::supported() {
+		// core 4.3 drivers still list the extensions it absorbed, glad only knows them from there
+		return GLAD_GL_ARB_compute_shader != 0 && GLAD_GL_ARB_shader_storage_buffer_object != 0 &&
+		       GLAD_GL_ARB_shader_image_load_store != 0 && GLAD_GL_ARB_texture_storage != 0 &&
+		       GLAD_GL_ARB_multi_draw_indirect != 0 && GLAD_GL_ARB_base_instance != 0;
+	}
+
+	gpu_culler::gpu_culler()
+	    : cull_program_(link_compute_program("shaders/cull.comp")),
+	      pyramid_program_(link_compute_program("shaders/hiz.comp")),
+	      source_level_(shader::find_uniform<int>(pyramid_program_, "sourceLevel")),
+	      copy_depth_(shader::find_uniform<int>(pyramid_program_, "copyDepth")) {
+		glGenBuffers(1, &instance_buffer_);
+		glGenFramebuffers(1, &depth_fbo_);
+
+		GLint alignment = 0;
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		storage_alignment_ = std::bit_ceil(static_cast<size_t>(std::max(alignment, 1)));
+	}
+
+	gpu_culler::~gpu_culler() {
+		release_textures();
+		glDeleteFramebuffers(1, &depth_fbo_);
+		glDeleteBuffers(1, &instance_buffer_);
+		glDeleteProgram(cull_program_);
+		glDeleteProgram(pyramid_program_);
+	}
+
+	gpu_culler::cull_params gpu_culler::params(const glm::mat4& view, const glm::mat4& proj,
+	                                           size_t instance_count) const {
+		const frustum_culler frustum(view, proj, glm::vec3(0.0f));
+		const glm::vec4      pyramid(static_cast<float>(width_), static_cast<float>(height_),
+		                             static_cast<float>(levels_), pyramid_valid_ ? 1.0f : 0.0f);
+		return { pyramid_view_proj_, frustum.planes(), pyramid,
+		         glm::uvec4(static_cast<uint32_t>(instance_count), 0, 0, 0) };
+	}
+
+	void gpu_culler::cull(const cull_input& input) {
+		if (input.instance_count == 0) {
+			return;
+		}
+		if (input.instance_count > instance_capacity_) {
+			instance_capacity_ = std::bit_ceil(input.instance_count);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, instance_buffer_);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(instance_capacity_ * sizeof(instance_data)),
+			             nullptr, GL_DYNAMIC_COPY);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		}
+
+		glBindBufferRange(GL_UNIFORM_BUFFER, CULL_BLOCK_BINDING, input.buffer,
+		                  static_cast<GLintptr>(input.params_offset), sizeof(cull_params));
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, BOUNDS_BINDING, input.buffer,
+		                  static_cast<GLintptr>(input.bounds_offset),
+		                  static_cast<GLsizeiptr>(input.instance_count * sizeof(instance_bounds)));
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, SOURCE_BINDING, input.buffer,
+		                  static_cast<GLintptr>(input.instances_offset),
+		                  static_cast<GLsizeiptr>(input.instance_count * sizeof(instance_data)));
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, input.buffer,
+		                  static_cast<GLintptr>(input.commands_offset),
+		                  static_cast<GLsizeiptr>(input.command_count * COMMAND_SIZE));
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBLE_BINDING, instance_buffer_);
+
+		// without a pyramid yet shader only tests frustum and never samples it
+		glActiveTexture(GL_TEXTURE0 + DEPTH_PYRAMID_UNIT);
+		glBindTexture(GL_TEXTURE_2D, pyramid_);
+		glActiveTexture(GL_TEXTURE0);
+
+		glUseProgram(cull_program_);
+		glDispatchCompute(groups(input.instance_count, CULL_GROUP), 1, 1);
+		// draws read commands through indirect buffer and instances through attributes
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+		glUseProgram(0);
+	}
+
+	void gpu_culler::build_pyramid(const glm::mat4& view, const glm::mat4& proj) {
+		std::array<GLint, 4> viewport{};
+		glGetIntegerv(GL_VIEWPORT, viewport.data());
+		if (viewport[2] <= 0 || viewport[3] <= 0) {
+			return;
+		}
+		if (viewport[2] != width_ || viewport[3] != height_) {
+			resize(viewport[2], viewport[3]);
+		}
+
+		// depth of default framebuffer cannot be sampled, blit keeps the copy on GPU
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depth_fbo_);
+		glBlitFramebuffer(viewport[0], viewport[1], viewport[0] + width_, viewport[1] + height_, 0, 0, width_,
+		                  height_, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		// level 0 is copied from depth, every further one keeps farthest depth of the texels below it
+		glUseProgram(pyramid_program_);
+		glActiveTexture(GL_TEXTURE0);
+		for (int level = 0; level < levels_; level++) {
+			glBindTexture(GL_TEXTURE_2D, level == 0 ? depth_texture_ : pyramid_);
+			copy_depth_.set(level == 0 ? 1 : 0);
+			source_level_.set(std::max(level - 1, 0));
+			glBindImageTexture(PYRAMID_IMAGE, pyramid_, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+			glDispatchCompute(groups(static_cast<size_t>(std::max(width_ >> level, 1)), PYRAMID_GROUP),
+			                  groups(static_cast<size_t>(std::max(height_ >> level, 1)), PYRAMID_GROUP), 1);
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glUseProgram(0);
+
+		pyramid_view_proj_ = proj * view;
+		pyramid_valid_     = true;
+	}
+
+	void gpu_culler::resize(int width, int height) {
+		release_textures();
+		width_  = width;
+		height_ = height;
+		levels_ = std::bit_width(static_cast<unsigned>(std::max(width, height)));
+
+		// blit needs the format of default framebuffer, which GLFW creates with 24 bit depth and 8 bit stencil
+		glGenTextures(1, &depth_texture_);
+		glBindTexture(GL_TEXTURE_2D, depth_texture_);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH24_STENCIL8, width, height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glBindFramebuffer(GL_FRAMEBUFFER, depth_fbo_);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depth_texture_, 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			spdlog::error("Depth copy framebuffer of {}x{} is incomplete", width, height);
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		glGenTextures(1, &pyramid_);
+		glBindTexture(GL_TEXTURE_2D, pyramid_);
+		glTexStorage2D(GL_TEXTURE_2D, levels_, GL_R32F, width, height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	void gpu_culler::release_textures() {
+		glDeleteTextures(1, &depth_texture_);
+		glDeleteTextures(1, &pyramid_);
+		depth_texture_ = 0;
+		pyramid_       = 0;
+		pyramid_valid_ = false;
+	}
+
+} // namespace kanso
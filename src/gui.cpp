@@ -18,7 +18,7 @@
 
 namespace kanso {
 
-	gui::gui(const std::shared_ptr<const window>&, const std::shared_ptr<const scene>& scene) : scene_(scene) {
+	gui::gui(const std::shared_ptr<const window>&, const std::shared_ptr<scene>& scene) : scene_(scene) {
 		IMGUI_CHECKVERSION();
 		ImGui::CreateContext();
 	}
@@ -29,7 +29,7 @@ namespace kanso {
 		ImGui::Render();
 	}
 
-	opengl_gui::opengl_gui(const std::shared_ptr<const window>& w, const std::shared_ptr<const scene>& scene)
+	opengl_gui::opengl_gui(const std::shared_ptr<const window>& w, const std::shared_ptr<scene>& scene)
 	    : gui(w, scene),
 	      mouse_buttons_map_(mapped_mouse_buttons()),
 	      key_buttons_map_(mapped_keys()),
@@ -90,6 +90,12 @@ namespace kanso {
 				spdlog::info("Object {} changed scale to: ({}, {}, {})", it->id, it->scale[0], it->scale[1], it->scale[2]);
 			}
 
+			if (isPosChange || isRotChange || isScaleChange) {
+				const auto index = static_cast<size_t>(it - scene_->view_begin());
+				scene_->set_transform(index, { it->pos[0], it->pos[1], it->pos[2] },
+				                      { it->scale[0], it->scale[1], it->scale[2] }, { it->rot[0], it->rot[1], it->rot[2] });
+			}
+
             ImGui::InputText("Type", it->type.data(), it->type.capacity(), ImGuiInputTextFlags_ReadOnly);
 
             ImGui::Separator();
@@ -97,6 +103,18 @@ namespace kanso {
         }
 
         ImGui::End();
+
+		const auto& stats = scene_->stats();
+		ImGui::Begin("Renderer");
+		ImGui::Text("Models: %zu visible, %zu culled, %zu occluded", stats.culling.models_visible,
+		            stats.culling.models_culled, stats.culling.models_occluded);
+		ImGui::Text("Occluders: %zu, %zu triangles", stats.occlusion.occluders, stats.occlusion.triangles);
+		ImGui::Text("Meshes: %zu visible, %zu culled", stats.culling.meshes_visible, stats.culling.meshes_culled);
+		ImGui::Text("Draw calls: %zu", stats.draw_calls);
+		ImGui::Text("Upload stalls: %llu (%.2f ms)", static_cast<unsigned long long>(stats.uploads.stalls), // NOLINT(*runtime-int)
+		            stats.uploads.stall_ms);
+		ImGui::Text("GPU occlusion culling: %s", stats.gpu_culling ? "on" : "off");
+		ImGui::End();
 	}
 
 	bool opengl_gui::handle_click(void* ctx, enum mouse_button b, enum button_status action) {
@@ -110,7 +128,7 @@ namespace kanso {
 		return ImGui::IsAnyItemHovered();
 	}
 
-	std::unique_ptr<gui> gui_factory::make_gui(const std::shared_ptr<window>& window, const std::shared_ptr<const scene>& scene) {
+	std::unique_ptr<gui> gui_factory::make_gui(const std::shared_ptr<window>& window, const std::shared_ptr<scene>& scene) {
 #ifdef OPENGL_AVAILABLE
 		return std::make_unique<opengl_gui>(window, scene);
 #else
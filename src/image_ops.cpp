@@ -0,0 +1,218 @@
+#include "image_ops.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KANSO_IMAGE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#define KANSO_IMAGE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace kanso {
+
+	namespace {
+
+		// NOLINTBEGIN(*pointer-arithmetic)
+
+		void expand_scalar(const uint8_t* src, uint8_t* dst, size_t count, int nr_channels) {
+			for (size_t i = 0; i < count; i++, dst += 4) {
+				switch (nr_channels) {
+					case 1:
+						dst[0] = dst[1] = dst[2] = src[i];
+						dst[3]                   = 255;
+						break;
+					case 2:
+						dst[0] = dst[1] = dst[2] = src[i * 2];
+						dst[3]                   = src[i * 2 + 1];
+						break;
+					case 3:
+						dst[0] = src[i * 3];
+						dst[1] = src[i * 3 + 1];
+						dst[2] = src[i * 3 + 2];
+						dst[3] = 255;
+						break;
+					default:
+						std::memcpy(dst, src + i * 4, 4);
+						break;
+				}
+			}
+		}
+
+		// returns number of pixels expanded, rest is left to scalar path
+		size_t expand_simd(const uint8_t* src, uint8_t* dst, size_t count, int nr_channels) {
+			size_t i = 0;
+#if defined(KANSO_IMAGE_SSE2)
+			const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xff000000U));
+			switch (nr_channels) {
+				case 1:
+					for (; i + 16 <= count; i += 16) {
+						const __m128i grey  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)); // NOLINT
+						const __m128i ff    = _mm_set1_epi8(static_cast<char>(0xff));
+						const __m128i gg_lo = _mm_unpacklo_epi8(grey, grey);
+						const __m128i gg_hi = _mm_unpackhi_epi8(grey, grey);
+						const __m128i ga_lo = _mm_unpacklo_epi8(grey, ff);
+						const __m128i ga_hi = _mm_unpackhi_epi8(grey, ff);
+						auto*         out   = reinterpret_cast<__m128i*>(dst + i * 4); // NOLINT
+						_mm_storeu_si128(out, _mm_unpacklo_epi16(gg_lo, ga_lo));
+						_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(gg_lo, ga_lo));
+						_mm_storeu_si128(out + 2, _mm_unpacklo_epi16(gg_hi, ga_hi));
+						_mm_storeu_si128(out + 3, _mm_unpackhi_epi16(gg_hi, ga_hi));
+					}
+					break;
+				case 2:
+					for (; i + 8 <= count; i += 8) {
+						const __m128i ga = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2)); // NOLINT
+						// every 16 bit lane is grey | alpha << 8, grey is copied into both bytes for (g, g)
+						const __m128i gg  = _mm_mullo_epi16(_mm_and_si128(ga, _mm_set1_epi16(0x00ff)), _mm_set1_epi16(0x0101));
+						auto*         out = reinterpret_cast<__m128i*>(dst + i * 4); // NOLINT
+						_mm_storeu_si128(out, _mm_unpacklo_epi16(gg, ga));
+						_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(gg, ga));
+					}
+					break;
+				case 3:
+					// each load takes one byte of next pixel, so keep one pixel in reserve for scalar tail
+					for (; i + 5 <= count; i += 4) {
+						std::array<int, 4> words{};
+						std::memcpy(&words[0], src + i * 3, 4);
+						std::memcpy(&words[1], src + i * 3 + 3, 4);
+						std::memcpy(&words[2], src + i * 3 + 6, 4);
+						std::memcpy(&words[3], src + i * 3 + 9, 4);
+						const __m128i rgbx = _mm_setr_epi32(words[0], words[1], words[2], words[3]);
+						const __m128i rgba = _mm_or_si128(_mm_and_si128(rgbx, _mm_set1_epi32(0x00ffffff)), opaque);
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), rgba); // NOLINT
+					}
+					break;
+				default:
+					break;
+			}
+#elif defined(KANSO_IMAGE_NEON)
+			switch (nr_channels) {
+				case 1:
+					for (; i + 8 <= count; i += 8) {
+						const uint8x8_t grey = vld1_u8(src + i);
+						vst4_u8(dst + i * 4, uint8x8x4_t{ { grey, grey, grey, vdup_n_u8(255) } });
+					}
+					break;
+				case 2:
+					for (; i + 8 <= count; i += 8) {
+						const uint8x8x2_t ga = vld2_u8(src + i * 2);
+						vst4_u8(dst + i * 4, uint8x8x4_t{ { ga.val[0], ga.val[0], ga.val[0], ga.val[1] } });
+					}
+					break;
+				case 3:
+					for (; i + 8 <= count; i += 8) {
+						const uint8x8x3_t rgb = vld3_u8(src + i * 3);
+						vst4_u8(dst + i * 4, uint8x8x4_t{ { rgb.val[0], rgb.val[1], rgb.val[2], vdup_n_u8(255) } });
+					}
+					break;
+				default:
+					break;
+			}
+#else
+			(void)src;
+			(void)dst;
+			(void)count;
+			(void)nr_channels;
+#endif
+			return i;
+		}
+
+		// averages 2x2 blocks of row0 and row1 into out, both rows are fully inside image
+		// returns number of output pixels written, rest is left to scalar path
+		int downsample_row_simd(const uint8_t* row0, const uint8_t* row1, uint8_t* out, int out_width) {
+			int x = 0;
+#if defined(KANSO_IMAGE_SSE2)
+			const __m128i zero     = _mm_setzero_si128();
+			const __m128i rounding = _mm_set1_epi16(2);
+			// sum of 2 pixels side by side in 16 bit lanes, for 2 output pixels
+			const auto pair_sums = [&zero](__m128i top, __m128i bottom) {
+				const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+				const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+				return _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+			};
+			for (; x + 4 <= out_width; x += 4) {
+				const auto*   top    = reinterpret_cast<const __m128i*>(row0 + x * 8);    // NOLINT
+				const auto*   bottom = reinterpret_cast<const __m128i*>(row1 + x * 8);    // NOLINT
+				const __m128i sum0   = pair_sums(_mm_loadu_si128(top), _mm_loadu_si128(bottom));
+				const __m128i sum1   = pair_sums(_mm_loadu_si128(top + 1), _mm_loadu_si128(bottom + 1));
+				const __m128i avg0   = _mm_srli_epi16(_mm_add_epi16(sum0, rounding), 2);
+				const __m128i avg1   = _mm_srli_epi16(_mm_add_epi16(sum1, rounding), 2);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4), _mm_packus_epi16(avg0, avg1)); // NOLINT
+			}
+#elif defined(KANSO_IMAGE_NEON)
+			for (; x + 2 <= out_width; x += 2) {
+				const uint8x16_t top    = vld1q_u8(row0 + x * 8);
+				const uint8x16_t bottom = vld1q_u8(row1 + x * 8);
+				const uint16x8_t lo     = vaddl_u8(vget_low_u8(top), vget_low_u8(bottom));
+				const uint16x8_t hi     = vaddl_u8(vget_high_u8(top), vget_high_u8(bottom));
+				const uint16x8_t sum    = vcombine_u16(vadd_u16(vget_low_u16(lo), vget_high_u16(lo)),
+				                                       vadd_u16(vget_low_u16(hi), vget_high_u16(hi)));
+				vst1_u8(out + x * 4, vrshrn_n_u16(sum, 2));
+			}
+#else
+			(void)row0;
+			(void)row1;
+			(void)out;
+			(void)out_width;
+#endif
+			return x;
+		}
+
+		// NOLINTEND(*pointer-arithmetic)
+
+	} // namespace
+
+	rgba_image expand_to_rgba(const uint8_t* pixels, int width, int height, int nr_channels) {
+		rgba_image image{ width, height, {} };
+		const auto count = static_cast<size_t>(width) * static_cast<size_t>(height);
+		image.pixels.resize(count * 4);
+
+		const size_t done = expand_simd(pixels, image.pixels.data(), count, nr_channels);
+		expand_scalar(pixels + done * static_cast<size_t>(nr_channels), // NOLINT(*pointer-arithmetic)
+		              image.pixels.data() + done * 4, count - done, nr_channels); // NOLINT(*pointer-arithmetic)
+		return image;
+	}
+
+	rgba_image downsample(const rgba_image& image) {
+		rgba_image next{ std::max(image.width / 2, 1), std::max(image.height / 2, 1), {} };
+		next.pixels.resize(static_cast<size_t>(next.width) * static_cast<size_t>(next.height) * 4);
+
+		const auto row = [&image](int y) {
+			return &image.pixels[static_cast<size_t>(std::min(y, image.height - 1)) * static_cast<size_t>(image.width) * 4];
+		};
+
+		// pixels with both source columns in range go through SIMD, odd last column is clamped
+		const int paired = image.width / 2;
+		for (int y = 0; y < next.height; y++) {
+			const uint8_t* row0 = row(2 * y);
+			const uint8_t* row1 = row(2 * y + 1);
+			uint8_t*       out  = &next.pixels[static_cast<size_t>(y) * static_cast<size_t>(next.width) * 4];
+
+			int x = downsample_row_simd(row0, row1, out, paired);
+			for (; x < next.width; x++) {
+				const auto x0 = static_cast<size_t>(std::min(2 * x, image.width - 1)) * 4;
+				const auto x1 = static_cast<size_t>(std::min(2 * x + 1, image.width - 1)) * 4;
+				for (size_t ch = 0; ch < 4; ch++) {
+					// NOLINTNEXTLINE(*pointer-arithmetic)
+					const int sum = row0[x0 + ch] + row0[x1 + ch] + row1[x0 + ch] + row1[x1 + ch];
+					out[static_cast<size_t>(x) * 4 + ch] = static_cast<uint8_t>((sum + 2) / 4); // NOLINT(*pointer-arithmetic)
+				}
+			}
+		}
+		return next;
+	}
+
+	std::vector<rgba_image> build_mip_chain(rgba_image image) {
+		std::vector<rgba_image> levels;
+		levels.push_back(std::move(image));
+		while (levels.back().width > 1 || levels.back().height > 1) {
+			levels.push_back(downsample(levels.back()));
+		}
+		return levels;
+	}
+
+} // namespace kanso
@@ -0,0 +1,154 @@
+#include "job_graph.hpp"
+#include "thread_pool.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+namespace kanso {
+
+	job_graph::job_graph(thread_pool& pool) : pool_(pool) {}
+
+	job_graph::~job_graph() {
+		wait();
+	}
+
+	job_graph::node_id job_graph::add(std::string name, std::function<void()> work,
+	                                  std::initializer_list<node_id> dependencies) {
+		return add(std::move(name), std::move(work), std::vector<node_id>(dependencies));
+	}
+
+	job_graph::node_id job_graph::add(std::string name, std::function<void()> work,
+	                                  const std::vector<node_id>& dependencies) {
+		std::vector<node_id> ready;
+		node_id              id{};
+		{
+			const std::lock_guard<std::mutex> lock(mut_);
+			id = nodes_.size();
+			auto& n     = nodes_.emplace_back();
+			n.name      = std::move(name);
+			n.work      = std::move(work);
+			n.remaining = 1; // keeps node from starting until all dependencies are recorded
+			unfinished_++;
+
+			for (const auto dependency : dependencies) {
+				add_dependency(id, dependency);
+			}
+			if (--nodes_[id].remaining == 0) {
+				ready.push_back(id);
+			}
+		}
+		schedule(ready);
+		return id;
+	}
+
+	void job_graph::depend(node_id id, node_id dependency) {
+		const std::lock_guard<std::mutex> lock(mut_);
+		if (nodes_[id].remaining == 0) {
+			spdlog::error("Job {} already started, can't wait for {}", nodes_[id].name, nodes_[dependency].name);
+			return;
+		}
+		add_dependency(id, dependency);
+	}
+
+	void job_graph::add_dependency(node_id id, node_id dependency) {
+		auto& dep = nodes_[dependency];
+		if (!dep.done) {
+			dep.successors.push_back(id);
+			nodes_[id].remaining++;
+			return;
+		}
+
+		auto& n = nodes_[id];
+		if (!n.has_critical || dep.end > nodes_[n.critical].end) {
+			n.critical     = dependency;
+			n.has_critical = true;
+		}
+	}
+
+	void job_graph::finish_dependency(node_id id, node_id dependency, std::vector<node_id>& ready) {
+		auto& n = nodes_[id];
+		// dependencies finish in order, so last one to finish is the one node waited for
+		n.critical     = dependency;
+		n.has_critical = true;
+		if (--n.remaining == 0) {
+			ready.push_back(id);
+		}
+	}
+
+	void job_graph::schedule(const std::vector<node_id>& ready) {
+		for (const auto id : ready) {
+			pool_.submit([this, id]() { run(id); });
+		}
+	}
+
+	void job_graph::run(node_id id) {
+		std::function<void()> work;
+		std::string           name;
+		{
+			const std::lock_guard<std::mutex> lock(mut_);
+			auto&                             n = nodes_[id];
+			n.start = std::chrono::steady_clock::now();
+			work    = std::move(n.work);
+			name    = n.name;
+		}
+
+		try {
+			work();
+		} catch (const std::exception& e) {
+			spdlog::error("Job {} failed: {}", name, e.what());
+		}
+
+		std::vector<node_id> ready;
+		{
+			const std::lock_guard<std::mutex> lock(mut_);
+			auto&                             n = nodes_[id];
+			n.end  = std::chrono::steady_clock::now();
+			n.done = true;
+			for (const auto successor : n.successors) {
+				finish_dependency(successor, id, ready);
+			}
+			n.successors.clear();
+			// notified under lock, waiter may destroy graph as soon as it sees last node done
+			if (--unfinished_ == 0) {
+				finished_.notify_all();
+			}
+		}
+
+		schedule(ready);
+	}
+
+	void job_graph::wait() {
+		for (;;) {
+			{
+				const std::lock_guard<std::mutex> lock(mut_);
+				if (unfinished_ == 0) {
+					return;
+				}
+			}
+			if (!pool_.run_one()) {
+				std::unique_lock<std::mutex> lock(mut_);
+				finished_.wait_for(lock, std::chrono::milliseconds(1), [this] { return unfinished_ == 0; });
+			}
+		}
+	}
+
+	std::vector<job_graph::timing> job_graph::critical_path() const {
+		const std::lock_guard<std::mutex> lock(mut_);
+
+		const node* last = nullptr;
+		for (const auto& n : nodes_) {
+			if (n.done && (last == nullptr || n.end > last->end)) {
+				last = &n;
+			}
+		}
+
+		std::vector<timing> path;
+		for (const node* n = last; n != nullptr; n = n->has_critical ? &nodes_[n->critical] : nullptr) {
+			path.push_back({ n->name, n->start - created_, n->end - n->start });
+		}
+		std::reverse(path.begin(), path.end());
+		return path;
+	}
+
+} // namespace kanso
@@ -1,11 +1,56 @@
 #include "light.hpp"
-#include "shader.hpp"
+#include "light_buffer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+#include <glm/trigonometric.hpp>
 
 namespace kanso {
 
-	light::light(const light_data& common_part) : common_part_(common_part) {}
+	namespace {
+		// contribution below which light is treated as gone, half of one 8 bit step
+		constexpr float LIGHT_CUTOFF = 0.5f / 255.0f;
+
+		// revisions are unique across all lights, so a new light at address of a destroyed one never looks uploaded
+		uint64_t next_revision() {
+			static std::atomic<uint64_t> counter{ 0 };
+			return ++counter;
+		}
+
+		// solves brightness / (constant + linear * d + quadratic * d^2) = LIGHT_CUTOFF for d
+		float attenuation_range(const light_data& common, const point_light_data& point) {
+			const glm::vec3 peak       = common.ambient + common.diffuse + common.specular;
+			const float     brightness = std::max({ peak.x, peak.y, peak.z });
+			const float     target     = brightness / LIGHT_CUTOFF - point.constant;
+			if (target <= 0.0f) {
+				return 0.0f;
+			}
+			if (point.quadratic > 0.0f) {
+				const float discriminant = point.linear * point.linear + 4.0f * point.quadratic * target;
+				return (-point.linear + std::sqrt(discriminant)) / (2.0f * point.quadratic);
+			}
+			if (point.linear > 0.0f) {
+				return target / point.linear;
+			}
+			return std::numeric_limits<float>::infinity();
+		}
+	} // namespace
+
+	light::light(const light_data& common_part) : common_part_(common_part), revision_(next_revision()) {}
+
+	light::light(light_data&& common_part) : common_part_(common_part), revision_(next_revision()) {}
+
+	void light::set_common_data(const light_data& common_part) {
+		common_part_ = common_part;
+		touch();
+	}
 
-	light::light(light_data&& common_part) : common_part_(common_part) {}
+	void light::touch() {
+		revision_ = next_revision();
+	}
 
 	point_light::point_light(const light_data& common_part, const point_light_data& point_light)
 	    : light(common_part),
@@ -15,17 +60,21 @@ namespace kanso {
 	    : light(common_part),
 	      point_light_part_(point_light) {}
 
-	void point_light::bind_to(uint shader) const {
-		shader::use(shader);
+	void point_light::pack(gpu_light& out) const {
+		const auto& point = point_light_part_;
+		// cone wider than any direction, so shader treats point lights as spots that never cut off
+		out = { glm::vec4(point.pos, point.constant), glm::vec4(common_data().ambient, point.linear),
+		        glm::vec4(common_data().diffuse, point.quadratic), glm::vec4(common_data().specular, -2.0f),
+		        glm::vec4(0.0f, 0.0f, -1.0f, -1.0f) };
+	}
 
-		shader::set_uniform(shader, "pointLight.ambient", common_data().ambient);
-		shader::set_uniform(shader, "pointLight.diffuse", common_data().diffuse);
-		shader::set_uniform(shader, "pointLight.specular", common_data().specular);
+	float point_light::range() const {
+		return attenuation_range(common_data(), point_light_part_);
+	}
 
-		shader::set_uniform(shader, "pointLight.pos", point_light_part_.pos);
-		shader::set_uniform(shader, "pointLight.constant", point_light_part_.constant);
-		shader::set_uniform(shader, "pointLight.linear", point_light_part_.linear);
-		shader::set_uniform(shader, "pointLight.quadratic", point_light_part_.quadratic);
+	void point_light::set_point_data(const point_light_data& point_light_part) {
+		point_light_part_ = point_light_part;
+		touch();
 	}
 
 	directional_light::directional_light(const light_data& common_part, const glm::vec3& direction)
@@ -36,14 +85,19 @@ namespace kanso {
 	    : light(common_part),
 	      direction_(direction) {}
 
-	void directional_light::bind_to(uint shader) const {
-		shader::use(shader);
+	void directional_light::pack(gpu_light& out) const {
+		out = { glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), glm::vec4(common_data().ambient, 0.0f),
+		        glm::vec4(common_data().diffuse, 0.0f), glm::vec4(common_data().specular, -2.0f),
+		        glm::vec4(direction_, -1.0f) };
+	}
 
-		shader::set_uniform(shader, "dirLight.ambient", common_data().ambient);
-		shader::set_uniform(shader, "dirLight.diffuse", common_data().diffuse);
-		shader::set_uniform(shader, "dirLight.specular", common_data().specular);
+	float directional_light::range() const {
+		return std::numeric_limits<float>::infinity();
+	}
 
-		shader::set_uniform(shader, "dirLight.direction", direction_);
+	void directional_light::set_direction(const glm::vec3& direction) {
+		direction_ = direction;
+		touch();
 	}
 
 	spot_light::spot_light(const light_data& common_part, const spot_light_data& spot_light_part)
@@ -54,17 +108,22 @@ namespace kanso {
 	    : light(common_part),
 	      spot_light_part_(spot_light_part) {}
 
-	void spot_light::bind_to(uint shader) const {
-		shader::use(shader);
-		shader::set_uniform(shader, "spotLight.ambient", common_data().ambient);
-		shader::set_uniform(shader, "spotLight.diffuse", common_data().diffuse);
-		shader::set_uniform(shader, "spotLight.specular", common_data().specular);
+	void spot_light::pack(gpu_light& out) const {
+		const auto& spot  = spot_light_part_;
+		const auto& point = spot.point_light_part;
+		// shader compares cosines, so cut off angles are converted here once instead of per fragment
+		out = { glm::vec4(point.pos, point.constant), glm::vec4(common_data().ambient, point.linear),
+		        glm::vec4(common_data().diffuse, point.quadratic),
+		        glm::vec4(common_data().specular, std::cos(glm::radians(spot.outer_cut_off))),
+		        glm::vec4(spot.direction, std::cos(glm::radians(spot.inner_cut_off))) };
+	}
 
-		shader::set_uniform(shader, "spotLight.direction", spot_light_part_.direction);
+	float spot_light::range() const {
+		return attenuation_range(common_data(), spot_light_part_.point_light_part);
+	}
 
-		shader::set_uniform(shader, "spotLight.pos", spot_light_part_.point_light_part.pos);
-		shader::set_uniform(shader, "spotLight.constant", spot_light_part_.point_light_part.constant);
-		shader::set_uniform(shader, "spotLight.linear", spot_light_part_.point_light_part.linear);
-		shader::set_uniform(shader, "spotLight.quadratic", spot_light_part_.point_light_part.quadratic);
+	void spot_light::set_spot_data(const spot_light_data& spot_light_part) {
+		spot_light_part_ = spot_light_part;
+		touch();
 	}
 } // namespace kanso
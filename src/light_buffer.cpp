@@ -0,0 +1,194 @@
+#include "light_buffer.hpp"
+#include "light.hpp"
+#include "glad/glad.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace kanso {
+
+	namespace {
+
+		// upper bound of index buffer, drivers may allow far more than a scene needs
+		constexpr size_t MAX_CLUSTER_INDICES = 1 << 20;
+
+		static_assert(sizeof(gpu_light) == 5 * sizeof(glm::vec4), "shader fetches five texels per light");
+		static_assert(sizeof(cluster_range) == 2 * sizeof(uint32_t), "grid is read as RG32UI");
+
+		void create_texture_buffer(uint& buffer, uint& texture, size_t size, GLenum format) {
+			glGenBuffers(1, &buffer);
+			glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+			glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_DYNAMIC_DRAW);
+			glGenTextures(1, &texture);
+			glBindTexture(GL_TEXTURE_BUFFER, texture);
+			glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+			glBindTexture(GL_TEXTURE_BUFFER, 0);
+			glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		}
+
+		// data rewritten every frame goes to fresh storage, so driver does not wait for draws still reading old one
+		void orphan_and_upload(uint buffer, size_t capacity, const void* data, size_t size) {
+			glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+			glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(capacity), nullptr, GL_DYNAMIC_DRAW);
+			if (size > 0) {
+				glBufferSubData(GL_TEXTURE_BUFFER, 0, static_cast<GLsizeiptr>(size), data);
+			}
+			glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		}
+
+	} // namespace
+
+	bool light_buffer::slot_state::holds(const light& light) const {
+		return source == &light && revision == light.revision();
+	}
+
+	light_buffer::light_buffer(thread_pool& pool)
+	    : ring_(sizeof(light_block)),
+	      locals_(MAX_LOCAL_LIGHTS),
+	      uploaded_directional_(MAX_DIRECTIONAL_LIGHTS),
+	      uploaded_local_(MAX_LOCAL_LIGHTS),
+	      ranges_(MAX_LOCAL_LIGHTS),
+	      clusters_(pool) {
+		GLint max_texels = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+		max_indices_ = std::min(static_cast<size_t>(std::max(max_texels, 0)), MAX_CLUSTER_INDICES);
+
+		block_.cluster_dims = { static_cast<int>(CLUSTER_X), static_cast<int>(CLUSTER_Y), static_cast<int>(CLUSTER_Z),
+		                        0 };
+
+		create_texture_buffer(local_lights_.buffer, local_lights_.texture, MAX_LOCAL_LIGHTS * sizeof(gpu_light),
+		                      GL_RGBA32F);
+		create_texture_buffer(grid_.buffer, grid_.texture, CLUSTER_COUNT * sizeof(cluster_range), GL_RG32UI);
+		create_texture_buffer(indices_.buffer, indices_.texture, max_indices_ * sizeof(uint16_t), GL_R16UI);
+	}
+
+	light_buffer::~light_buffer() {
+		for (const auto* buffer : { &local_lights_, &grid_, &indices_ }) {
+			glDeleteTextures(1, &buffer->texture);
+			glDeleteBuffers(1, &buffer->buffer);
+		}
+	}
+
+	void light_buffer::update(const std::vector<std::shared_ptr<light>>& lights, const glm::mat4& view,
+	                          const glm::mat4& proj, int width, int height) {
+		size_t directional_count = 0;
+		size_t local_count       = 0;
+		size_t local_begin       = MAX_LOCAL_LIGHTS;
+		size_t local_end         = 0;
+		bool   overflow          = false;
+
+		for (const auto& light : lights) {
+			if (light->type() == light_type::directional) {
+				if (directional_count == MAX_DIRECTIONAL_LIGHTS) {
+					overflow = true;
+					continue;
+				}
+				const auto slot  = directional_count++;
+				auto&      state = uploaded_directional_[slot];
+				if (state.holds(*light)) {
+					continue;
+				}
+				light->pack(block_.directional[slot]);
+				state = { light.get(), light->revision() };
+				continue;
+			}
+
+			if (local_count == MAX_LOCAL_LIGHTS) {
+				overflow = true;
+				continue;
+			}
+			// unchanged light in the same slot is already on GPU
+			const auto slot  = local_count++;
+			auto&      state = uploaded_local_[slot];
+			if (state.holds(*light)) {
+				continue;
+			}
+			light->pack(locals_[slot]);
+			ranges_[slot] = light->range();
+			state         = { light.get(), light->revision() };
+			local_begin   = std::min(local_begin, slot);
+			local_end     = std::max(local_end, slot + 1);
+		}
+
+		if (overflow && !overflow_reported_) {
+			overflow_reported_ = true;
+			spdlog::warn("Scene has more lights than light buffer holds ({} directional, {} point and spot), "
+			             "extra lights are ignored",
+			             MAX_DIRECTIONAL_LIGHTS, MAX_LOCAL_LIGHTS);
+		}
+
+		// clusters live in view space, so local lights are moved there every frame
+		view_lights_.clear();
+		const glm::mat3 rotation(view);
+		for (size_t slot = 0; slot < local_count; slot++) {
+			const auto&     packed    = locals_[slot];
+			const glm::vec3 pos       = view * glm::vec4(glm::vec3(packed.pos), 1.0f);
+			const glm::vec3 direction = glm::normalize(rotation * glm::vec3(packed.direction));
+			view_lights_.push_back({ pos, ranges_[slot], direction, packed.specular.w });
+		}
+		clusters_.build(proj, view_lights_, max_indices_);
+		if (clusters_.overflowed() && !cluster_overflow_reported_) {
+			cluster_overflow_reported_ = true;
+			spdlog::warn("Light clusters need more than {} light references, some lights are dropped", max_indices_);
+		}
+
+		block_.counts         = { static_cast<int>(directional_count), static_cast<int>(local_count), 0, 0 };
+		block_.cluster_depth  = { clusters_.depth_scale(), clusters_.depth_bias(), clusters_.near(), clusters_.far() };
+		block_.cluster_screen = { static_cast<float>(CLUSTER_X) / static_cast<float>(std::max(width, 1)),
+		                          static_cast<float>(CLUSTER_Y) / static_cast<float>(std::max(height, 1)), 0.0f, 0.0f };
+
+		// block is the only allocation of its region, and regions start aligned for uniform ranges
+		if (in_frame_) {
+			ring_.end_frame();
+		}
+		ring_.begin_frame();
+		in_frame_       = true;
+		const auto slot = ring_.allocate(sizeof(light_block), alignof(light_block));
+		if (slot.data != nullptr) {
+			std::memcpy(slot.data, &block_, sizeof(block_));
+			ring_.flush();
+			glBindBufferRange(GL_UNIFORM_BUFFER, LIGHTS_BLOCK_BINDING, ring_.buffer(),
+			                  static_cast<GLintptr>(slot.offset), sizeof(light_block));
+		} else {
+			spdlog::error("Could not map Lights block for writing, previous lights stay bound");
+		}
+
+		if (local_begin < local_end) {
+			glBindBuffer(GL_TEXTURE_BUFFER, local_lights_.buffer);
+			glBufferSubData(GL_TEXTURE_BUFFER, static_cast<GLintptr>(local_begin * sizeof(gpu_light)),
+			                static_cast<GLsizeiptr>((local_end - local_begin) * sizeof(gpu_light)),
+			                &locals_[local_begin]);
+			glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		}
+
+		const auto& grid    = clusters_.grid();
+		const auto& indices = clusters_.indices();
+		orphan_and_upload(grid_.buffer, CLUSTER_COUNT * sizeof(cluster_range), grid.data(),
+		                  grid.size() * sizeof(cluster_range));
+		orphan_and_upload(indices_.buffer, max_indices_ * sizeof(uint16_t), indices.data(),
+		                  indices.size() * sizeof(uint16_t));
+
+		bind_textures();
+	}
+
+	void light_buffer::end_frame() {
+		if (in_frame_) {
+			in_frame_ = false;
+			ring_.end_frame();
+		}
+	}
+
+	void light_buffer::bind_textures() const {
+		glActiveTexture(GL_TEXTURE0 + LIGHT_DATA_UNIT);
+		glBindTexture(GL_TEXTURE_BUFFER, local_lights_.texture);
+		glActiveTexture(GL_TEXTURE0 + CLUSTER_GRID_UNIT);
+		glBindTexture(GL_TEXTURE_BUFFER, grid_.texture);
+		glActiveTexture(GL_TEXTURE0 + LIGHT_INDEX_UNIT);
+		glBindTexture(GL_TEXTURE_BUFFER, indices_.texture);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+} // namespace kanso
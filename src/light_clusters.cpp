@@ -0,0 +1,191 @@
+#include "light_clusters.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KANSO_CLUSTERS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace kanso {
+
+	namespace {
+
+		constexpr size_t SIMD_WIDTH = 4;
+
+		float slice_depth(float near, float far, uint32_t slice) {
+			return near * std::pow(far / near, static_cast<float>(slice) / static_cast<float>(CLUSTER_Z));
+		}
+
+		// bit i is set if sphere of light first + i overlaps box, padding lights have negative radius_sq
+		template <typename Lights, typename Bounds>
+		uint32_t overlap_mask(const Lights& lights, size_t first, const Bounds& box) {
+#if defined(KANSO_CLUSTERS_SSE2)
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 x    = _mm_loadu_ps(&lights.x[first]);
+			const __m128 y    = _mm_loadu_ps(&lights.y[first]);
+			const __m128 z    = _mm_loadu_ps(&lights.z[first]);
+
+			// distance from center to box along each axis, 0 inside
+			const __m128 dx = _mm_max_ps(
+			    _mm_max_ps(_mm_sub_ps(_mm_set1_ps(box.min.x), x), _mm_sub_ps(x, _mm_set1_ps(box.max.x))), zero);
+			const __m128 dy = _mm_max_ps(
+			    _mm_max_ps(_mm_sub_ps(_mm_set1_ps(box.min.y), y), _mm_sub_ps(y, _mm_set1_ps(box.max.y))), zero);
+			const __m128 dz = _mm_max_ps(
+			    _mm_max_ps(_mm_sub_ps(_mm_set1_ps(box.min.z), z), _mm_sub_ps(z, _mm_set1_ps(box.max.z))), zero);
+
+			const __m128 dist_sq =
+			    _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+			return static_cast<uint32_t>(
+			    _mm_movemask_ps(_mm_cmple_ps(dist_sq, _mm_loadu_ps(&lights.radius_sq[first]))));
+#else
+			uint32_t mask = 0;
+			for (size_t i = 0; i < SIMD_WIDTH; i++) {
+				const float dx = std::max({ box.min.x - lights.x[first + i], lights.x[first + i] - box.max.x, 0.0f });
+				const float dy = std::max({ box.min.y - lights.y[first + i], lights.y[first + i] - box.max.y, 0.0f });
+				const float dz = std::max({ box.min.z - lights.z[first + i], lights.z[first + i] - box.max.z, 0.0f });
+				if (dx * dx + dy * dy + dz * dz <= lights.radius_sq[first + i]) {
+					mask |= 1U << i;
+				}
+			}
+			return mask;
+#endif
+		}
+
+		// false if cone of spot light misses sphere, https://bartwronski.com/2017/04/13/cull-that-cone/
+		bool cone_overlaps(const cluster_light& light, const glm::vec3& center, float radius) {
+			const glm::vec3 v        = center - light.pos;
+			const float     len_sq   = glm::dot(v, v);
+			const float     along    = glm::dot(v, light.direction);
+			const float     cos_cone = light.cos_outer;
+			const float     sin_cone = std::sqrt(std::max(1.0f - cos_cone * cos_cone, 0.0f));
+			const float     closest  = cos_cone * std::sqrt(std::max(len_sq - along * along, 0.0f)) - along * sin_cone;
+			return closest <= radius && along >= -radius;
+		}
+
+	} // namespace
+
+	light_clusters::light_clusters(thread_pool& pool)
+	    : pool_(pool),
+	      bounds_(CLUSTER_COUNT),
+	      slices_(CLUSTER_Z),
+	      slice_indices_(CLUSTER_Z),
+	      grid_(CLUSTER_COUNT) {}
+
+	void light_clusters::rebuild_bounds(const glm::mat4& proj) {
+		proj_ = proj;
+		// glm::perspective keeps near and far in third column
+		near_ = proj[3][2] / (proj[2][2] - 1.0f);
+		far_  = proj[3][2] / (proj[2][2] + 1.0f);
+
+		const float log_ratio = std::log(far_ / near_);
+		depth_scale_          = static_cast<float>(CLUSTER_Z) / log_ratio;
+		depth_bias_           = -static_cast<float>(CLUSTER_Z) * std::log(near_) / log_ratio;
+
+		for (uint32_t z = 0; z < CLUSTER_Z; z++) {
+			const float d0 = slice_depth(near_, far_, z);
+			const float d1 = slice_depth(near_, far_, z + 1);
+			for (uint32_t y = 0; y < CLUSTER_Y; y++) {
+				const float y0 = -1.0f + 2.0f * static_cast<float>(y) / CLUSTER_Y;
+				const float y1 = -1.0f + 2.0f * static_cast<float>(y + 1) / CLUSTER_Y;
+				for (uint32_t x = 0; x < CLUSTER_X; x++) {
+					const float x0 = -1.0f + 2.0f * static_cast<float>(x) / CLUSTER_X;
+					const float x1 = -1.0f + 2.0f * static_cast<float>(x + 1) / CLUSTER_X;
+
+					// tile edges spread with depth, so box covers them at both slice planes
+					auto& box = bounds_[x + y * CLUSTER_X + z * CLUSTER_X * CLUSTER_Y];
+					box.min   = { std::min(x0 * d0, x0 * d1) / proj[0][0], std::min(y0 * d0, y0 * d1) / proj[1][1],
+					              -d1 };
+					box.max   = { std::max(x1 * d0, x1 * d1) / proj[0][0], std::max(y1 * d0, y1 * d1) / proj[1][1],
+					              -d0 };
+				}
+			}
+		}
+	}
+
+	void light_clusters::build(const glm::mat4& proj, const std::vector<cluster_light>& lights, size_t max_indices) {
+		if (proj != proj_) {
+			rebuild_bounds(proj);
+		}
+
+		pool_.parallel_for(CLUSTER_Z, 1, [this, &lights](size_t first, size_t last) {
+			for (size_t z = first; z < last; z++) {
+				build_slice(static_cast<uint32_t>(z), lights);
+			}
+		});
+
+		// slices were filled independently, now their lists are joined into one
+		indices_.clear();
+		overflowed_ = false;
+		for (uint32_t z = 0; z < CLUSTER_Z; z++) {
+			const auto& local = slice_indices_[z];
+			for (uint32_t i = z * CLUSTER_X * CLUSTER_Y; i < (z + 1) * CLUSTER_X * CLUSTER_Y; i++) {
+				auto&        range = grid_[i];
+				const size_t count = std::min<size_t>(range.count, max_indices - indices_.size());
+				overflowed_        = overflowed_ || count < range.count;
+
+				const auto begin = local.begin() + range.offset;
+				range.offset     = static_cast<uint32_t>(indices_.size());
+				range.count      = static_cast<uint32_t>(count);
+				indices_.insert(indices_.end(), begin, begin + static_cast<ptrdiff_t>(count));
+			}
+		}
+	}
+
+	void light_clusters::build_slice(uint32_t z, const std::vector<cluster_light>& lights) {
+		const float d0 = slice_depth(near_, far_, z);
+		const float d1 = slice_depth(near_, far_, z + 1);
+
+		// only lights reaching this depth range are tested against its clusters
+		auto& candidates = slices_[z];
+		candidates.x.clear();
+		candidates.y.clear();
+		candidates.z.clear();
+		candidates.radius_sq.clear();
+		candidates.index.clear();
+		for (size_t i = 0; i < lights.size(); i++) {
+			const auto& light = lights[i];
+			const float depth = -light.pos.z;
+			if (depth + light.radius < d0 || depth - light.radius > d1) {
+				continue;
+			}
+			candidates.x.push_back(light.pos.x);
+			candidates.y.push_back(light.pos.y);
+			candidates.z.push_back(light.pos.z);
+			candidates.radius_sq.push_back(light.radius * light.radius);
+			candidates.index.push_back(static_cast<uint16_t>(i));
+		}
+		while (candidates.x.size() % SIMD_WIDTH != 0) {
+			candidates.x.push_back(0.0f);
+			candidates.y.push_back(0.0f);
+			candidates.z.push_back(0.0f);
+			candidates.radius_sq.push_back(-1.0f);
+			candidates.index.push_back(0);
+		}
+
+		auto& out = slice_indices_[z];
+		out.clear();
+		for (uint32_t i = z * CLUSTER_X * CLUSTER_Y; i < (z + 1) * CLUSTER_X * CLUSTER_Y; i++) {
+			const auto&     box    = bounds_[i];
+			const glm::vec3 center = (box.min + box.max) * 0.5f;
+			const float     radius = glm::length(box.max - box.min) * 0.5f;
+
+			const auto offset = static_cast<uint32_t>(out.size());
+			for (size_t first = 0; first < candidates.x.size(); first += SIMD_WIDTH) {
+				for (uint32_t mask = overlap_mask(candidates, first, box); mask != 0; mask &= mask - 1) {
+					const auto  index = candidates.index[first + static_cast<size_t>(std::countr_zero(mask))];
+					const auto& light = lights[index];
+					if (light.cos_outer >= -1.0f && !cone_overlaps(light, center, radius)) {
+						continue;
+					}
+					out.push_back(index);
+				}
+			}
+			grid_[i] = { offset, static_cast<uint32_t>(out.size()) - offset };
+		}
+	}
+
+} // namespace kanso
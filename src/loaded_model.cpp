@@ -1,94 +1,108 @@
 #include "loaded_model.hpp"
+#include "raycast.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
+
 namespace kanso {
 
 	loaded_model::loaded_model(const shader& render_shader, const shader& outline_shader, const glm::vec3& pos,
-	                           const glm::vec3& scale, const glm::vec3& rot, std::shared_ptr<model_data> data)
+	                           const glm::vec3& scale, const glm::vec3& rot, std::shared_ptr<model_data> data,
+	                           float lod_screen_error)
 	    : scene_model(render_shader, outline_shader, pos, scale, rot, data->aabb_min(), data->aabb_max()),
 	      data_(std::move(data)),
-	      renderer_(renderer_factory::make_renderer())
+	      renderer_(renderer_factory::make_renderer()),
+	      lod_screen_error_(lod_screen_error)
 	{
 		recalculate_bounding_box();
 	}
 
-	void loaded_model::draw(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camera_pos) const {
-		renderer_->reset_stencil_test();
-		draw_model(render_shader(), view, proj, camera_pos);
+	void loaded_model::enqueue(render_queue& queue, frustum_culler& culler, const glm::mat4& proj,
+	                           const glm::vec3& camera_pos) const {
+		// model bounding sphere decides how big an error in model units looks on screen, LOD 0 once camera is inside
+		const float     world_scale = std::max({ std::abs(scale_.x), std::abs(scale_.y), std::abs(scale_.z) });
+		const glm::vec3 center      = model_matrix_ * glm::vec4((aabb_min_ + aabb_max_) * 0.5f, 1.0f);
+		const float     radius      = glm::length(aabb_max_ - aabb_min_) * 0.5f * world_scale;
+		const float     depth       = glm::length(camera_pos - center);
+		const float     distance    = depth - radius;
+		// proj[1][1] is cot(fov / 2), so size h at distance d covers h * proj[1][1] / (2 * d) of viewport height
+		const float error_to_screen = distance > 0.0f ? proj[1][1] * 0.5f / distance : std::numeric_limits<float>::max();
+
+		const auto visible = culler.cull(mesh_boxes_, mesh_visible_);
+		culler.stats().meshes_visible += visible;
+		culler.stats().meshes_culled += mesh_boxes_.count - visible;
+
+		// outline is drawn after every opaque packet, where stencil shows no model was drawn
+		size_t index = 0;
+		for (auto it = data_->meshes_begin(), end = data_->meshes_end(); it != end; ++it, ++index) {
+			if (mesh_visible_[index] == 0) {
+				continue;
+			}
+			const auto lod        = select_lod(*it, world_scale, error_to_screen);
+			const auto [min, max] = mesh_boxes_.box(index);
+			queue.push(render_pass::opaque, render_shader(), *it, lod, model_matrix_, depth, min, max);
+			if (selected_) {
+				queue.push(render_pass::outline, outline_shader_.id(), *it, lod, model_matrix_, depth, min, max);
+			}
+		}
 
+		// box only marks selection, every model of a large scene would write 24 vertices each frame
 		if (selected_) {
-			renderer_->enable_stencil_test();
-			draw_model(outline_shader_.id(), view, proj, camera_pos);
-			renderer_->reset_stencil_test();
+			queue.push_box(model_matrix_, aabb_min_, aabb_max_);
 		}
 	}
 
-	void loaded_model::draw_model(uint shader, const glm::mat4& view, const glm::mat4& proj,
-	                              const glm::vec3& camera_pos) const {
-		shader::use(shader);
-
-		model_matrix_ = { 1 };
-		model_matrix_ = glm::translate(model_matrix_, position_);
-		model_matrix_ = glm::scale(model_matrix_, scale_);
-
-		model_matrix_ = glm::rotate(model_matrix_, glm::radians(rotation_[0]), { 1, 0, 0 });
-		model_matrix_ = glm::rotate(model_matrix_, glm::radians(rotation_[1]), { 0, 1, 0 });
-		model_matrix_ = glm::rotate(model_matrix_, glm::radians(rotation_[2]), { 0, 0, 1 });
-
-		shader::set_uniform(shader, "model", model_matrix_);
-		shader::set_uniform(shader, "view", view);
-		shader::set_uniform(shader, "proj", proj);
-
-		shader::set_uniform(shader, "viewPos", camera_pos);
-		shader::set_uniform(shader, "material.shininess", 32.0f);
-
-		for (auto it = data_->meshes_begin(), end = data_->meshes_end(); it != end; ++it) {
-			it->draw(shader);
+	size_t loaded_model::select_lod(const mesh& mesh, float world_scale, float error_to_screen) const {
+		for (size_t lod = mesh.lod_count() - 1; lod > 0; lod--) {
+			if (mesh.lod_error(lod) * world_scale * error_to_screen <= lod_screen_error_) {
+				return lod;
+			}
 		}
-
-		draw_bounding_box(view, proj, camera_pos);
+		return 0;
 	}
 
-	void loaded_model::draw_bounding_box(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camera_pos) const {
-		for (const auto& line : aabb_box_) {
-			line.draw(view, proj, camera_pos);
+	std::optional<model_hit> loaded_model::intersect(const raycast& ray) const {
+		// affine inverse keeps distances along ray, so model space hits compare as they are
+		const glm::mat4 to_model  = glm::inverse(model_matrix_);
+		const glm::vec3 origin    = to_model * glm::vec4(ray.get_origin(), 1.0f);
+		const glm::vec3 direction = to_model * glm::vec4(ray.get_dir(), 0.0f);
+		const raycast   local(origin, direction);
+
+		std::optional<model_hit> best;
+		size_t                   index = 0;
+		for (auto it = data_->meshes_begin(), end = data_->meshes_end(); it != end; ++it, ++index) {
+			const float entry = local.entry_distance(it->aabb_min(), it->aabb_max());
+			if (best && entry >= best->triangle.distance) {
+				continue;
+			}
+			const auto hit = it->intersect(origin, direction);
+			if (hit && (!best || hit->distance < best->triangle.distance)) {
+				best = model_hit{ index, *hit };
+			}
 		}
+		return best;
 	}
 
-	glm::vec3 loaded_model::calculate_aabb(glm::vec3 p) const {
-		glm::mat4 model_matrix = { 1 };
-		model_matrix = glm::translate(model_matrix, position_);
-		model_matrix = glm::scale(model_matrix, scale_);
-
-		model_matrix = glm::rotate(model_matrix, glm::radians(rotation_[0]), { 1, 0, 0 });
-		model_matrix = glm::rotate(model_matrix, glm::radians(rotation_[1]), { 0, 1, 0 });
-		model_matrix = glm::rotate(model_matrix, glm::radians(rotation_[2]), { 0, 0, 1 });
-
-		return { model_matrix * glm::vec4(p, 1.0f) };
+	float loaded_model::hit_distance(const raycast& ray, float box_distance) const {
+		(void)box_distance;
+		const auto hit = intersect(ray);
+		return hit ? hit->triangle.distance : std::numeric_limits<float>::infinity();
 	}
 
 	glm::vec3 loaded_model::aabb_min() const {
-		return calculate_aabb(aabb_min_);
+		return world_min_;
 	}
 
 	glm::vec3 loaded_model::aabb_max() const {
-		return calculate_aabb(aabb_max_);
+		return world_max_;
 	}
 
+	// transform only changes through set_transform(), so matrix and boxes are derived here and not every frame
 	void loaded_model::recalculate_bounding_box() {
-		// NOLINTBEGIN(*union-access)
-		std::array<glm::vec3, 8> aabb_box_vertices{
-			{ { aabb_min_.x, aabb_min_.y, aabb_min_.z },
-			  { aabb_min_.x, aabb_min_.y, aabb_max_.z },
-			  { aabb_min_.x, aabb_max_.y, aabb_min_.z },
-			  { aabb_min_.x, aabb_max_.y, aabb_max_.z },
-			  { aabb_max_.x, aabb_min_.y, aabb_min_.z },
-			  { aabb_max_.x, aabb_min_.y, aabb_max_.z },
-			  { aabb_max_.x, aabb_max_.y, aabb_min_.z },
-			  { aabb_max_.x, aabb_max_.y, aabb_max_.z } },
-		};
-		// NOLINTEND(*union-access)
 		model_matrix_ = { 1 };
 		model_matrix_ = glm::translate(model_matrix_, position_);
 		model_matrix_ = glm::scale(model_matrix_, scale_);
@@ -97,24 +111,12 @@ namespace kanso {
 		model_matrix_ = glm::rotate(model_matrix_, glm::radians(rotation_[1]), { 0, 1, 0 });
 		model_matrix_ = glm::rotate(model_matrix_, glm::radians(rotation_[2]), { 0, 0, 1 });
 
-		for (auto& vertex : aabb_box_vertices) {
-			vertex = glm::vec3(model_matrix_ * glm::vec4(vertex, 1.0f));
+		// boxes around rotated boxes, corners alone are not min and max once model is rotated
+		std::tie(world_min_, world_max_) = transform_box(model_matrix_, aabb_min_, aabb_max_);
+		mesh_boxes_.clear();
+		for (auto it = data_->meshes_begin(), end = data_->meshes_end(); it != end; ++it) {
+			const auto [min, max] = transform_box(model_matrix_, it->aabb_min(), it->aabb_max());
+			mesh_boxes_.push(min, max);
 		}
-
-		aabb_box_.reserve(12);
-		aabb_box_.emplace_back(aabb_box_vertices[0], aabb_box_vertices[1]);
-		aabb_box_.emplace_back(aabb_box_vertices[0], aabb_box_vertices[2]);
-		aabb_box_.emplace_back(aabb_box_vertices[1], aabb_box_vertices[3]);
-		aabb_box_.emplace_back(aabb_box_vertices[2], aabb_box_vertices[3]);
-
-		aabb_box_.emplace_back(aabb_box_vertices[4], aabb_box_vertices[5]);
-		aabb_box_.emplace_back(aabb_box_vertices[4], aabb_box_vertices[6]);
-		aabb_box_.emplace_back(aabb_box_vertices[5], aabb_box_vertices[7]);
-		aabb_box_.emplace_back(aabb_box_vertices[6], aabb_box_vertices[7]);
-
-		aabb_box_.emplace_back(aabb_box_vertices[0], aabb_box_vertices[4]);
-		aabb_box_.emplace_back(aabb_box_vertices[1], aabb_box_vertices[5]);
-		aabb_box_.emplace_back(aabb_box_vertices[2], aabb_box_vertices[6]);
-		aabb_box_.emplace_back(aabb_box_vertices[3], aabb_box_vertices[7]);
 	}
 } // namespace kanso
@@ -3,6 +3,10 @@
 int main(int argc, char** argv) {
 
 	kanso::starter s{ argc, argv };
+	if (s.converting()) {
+		s.convert();
+		return 0;
+	}
 	s.make_app()->run();
 
 	return 0;
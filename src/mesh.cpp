@@ -1,17 +1,73 @@
 #include "mesh.hpp"
+#include "geometry_arena.hpp"
+#include "vertex_compression.hpp"
+
+#include <algorithm>
 
 namespace kanso {
 
 	mesh::mesh(mesh_data data)
 	    : vertices_(std::move(data.vertices)),
 	      indices_(std::move(data.indices)),
-	      texture_(data.raw_maps),
-	      renderer_(renderer_factory::make_renderer(vertices_, indices_)) {}
+	      lods_(std::move(data.lods)),
+	      bvh_(std::move(data.bvh)),
+	      aabb_min_(data.aabb_min),
+	      aabb_max_(data.aabb_max),
+	      texture_(std::move(data.raw_maps)) {
+		// every level lives in one index buffer, LOD 0 first
+		lod_ranges_.push_back({ 0, indices_.size(), 0.0f });
+		for (const auto& lod : lods_) {
+			const auto& last = lod_ranges_.back();
+			lod_ranges_.push_back({ last.first_index + last.index_count, lod.indices.size(), lod.error });
+		}
+	}
+
+	void mesh::upload() {
+		if (renderer_ != nullptr) {
+			return;
+		}
+		if (lods_.empty()) {
+			renderer_ = renderer_factory::make_renderer<arena_renderer>(vertices_, indices_);
+			return;
+		}
+
+		std::vector<int> all_indices;
+		all_indices.reserve(lod_ranges_.back().first_index + lod_ranges_.back().index_count);
+		all_indices.insert(all_indices.end(), indices_.begin(), indices_.end());
+		for (const auto& lod : lods_) {
+			all_indices.insert(all_indices.end(), lod.indices.begin(), lod.indices.end());
+		}
+		renderer_ = renderer_factory::make_renderer<arena_renderer>(vertices_, all_indices);
+	}
+
+	bool mesh::resident() {
+		return renderer_ != nullptr && texture_.resident();
+	}
 
-	void mesh::draw(uint shader) {
+	size_t mesh::upload_size() const {
+		const auto& last = lod_ranges_.back();
+		return vertices_.size() * vertex_stride(DEFAULT_VERTEX_FORMAT) +
+		       (last.first_index + last.index_count) * index_stride(vertices_.size());
+	}
 
-		texture_.bind(shader);
+	size_t mesh::lod_count() const {
+		return lod_ranges_.size();
+	}
+
+	float mesh::lod_error(size_t lod) const {
+		return lod_ranges_[std::min(lod, lod_ranges_.size() - 1)].error;
+	}
+
+	size_t mesh::first_index(size_t lod) const {
+		return lod_ranges_[std::min(lod, lod_ranges_.size() - 1)].first_index;
+	}
+
+	size_t mesh::index_count(size_t lod) const {
+		return lod_ranges_[std::min(lod, lod_ranges_.size() - 1)].index_count;
+	}
 
-		renderer_->draw_triangles();
+	const std::vector<int>& mesh::indices(size_t lod) const {
+		lod = std::min(lod, lod_ranges_.size() - 1);
+		return lod == 0 ? indices_ : lods_[lod - 1].indices;
 	}
 } // namespace kanso
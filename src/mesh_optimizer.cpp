@@ -0,0 +1,378 @@
+#include "mesh_optimizer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+namespace kanso {
+
+	mesh_optimization_stats& mesh_optimization_stats::operator+=(const mesh_optimization_stats& other) {
+		vertices_before += other.vertices_before;
+		vertices_after += other.vertices_after;
+		triangles_before += other.triangles_before;
+		triangles_after += other.triangles_after;
+		transforms_before += other.transforms_before;
+		transforms_after += other.transforms_after;
+		return *this;
+	}
+
+	namespace {
+
+		// Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+		constexpr float CACHE_DECAY_POWER   = 1.5f;
+		constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+		constexpr float VALENCE_BOOST_SCALE = 2.0f;
+		constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+		float vertex_score(int cache_pos, uint32_t remaining) {
+			if (remaining == 0) {
+				return -1.0f;
+			}
+
+			float score = 0.0f;
+			if (cache_pos >= 0) {
+				if (cache_pos < 3) {
+					score = LAST_TRIANGLE_SCORE;
+				} else {
+					const float scaler = 1.0f / static_cast<float>(VERTEX_CACHE_SIZE - 3);
+					score              = std::pow(1.0f - static_cast<float>(cache_pos - 3) * scaler, CACHE_DECAY_POWER);
+				}
+			}
+
+			return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remaining), -VALENCE_BOOST_POWER);
+		}
+
+		using vertex_key = std::array<uint32_t, sizeof(mesh_vertex) / sizeof(float)>;
+
+		struct vertex_key_hash {
+			size_t operator()(const vertex_key& key) const {
+				size_t hash = 0;
+				for (auto v : key) {
+					hash ^= std::hash<uint32_t>{}(v) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+				}
+				return hash;
+			}
+		};
+
+		vertex_key make_key(const mesh_vertex& vertex) {
+			static_assert(sizeof(mesh_vertex) == sizeof(vertex_key), "mesh_vertex must be tightly packed floats");
+
+			std::array<float, std::tuple_size_v<vertex_key>> values{};
+			std::memcpy(values.data(), &vertex, sizeof(mesh_vertex));
+
+			vertex_key key{};
+			for (size_t i = 0; i < values.size(); i++) {
+				// -0.0f and 0.0f are the same vertex
+				const float value = values[i] == 0.0f ? 0.0f : values[i];
+				std::memcpy(&key[i], &value, sizeof(float));
+			}
+			return key;
+		}
+
+		glm::vec3 triangle_normal(const std::vector<mesh_vertex>& vertices, const int* triangle) {
+			// NOLINTBEGIN(*pointer-arithmetic)
+			const auto& a = vertices[static_cast<size_t>(triangle[0])].pos;
+			const auto& b = vertices[static_cast<size_t>(triangle[1])].pos;
+			const auto& c = vertices[static_cast<size_t>(triangle[2])].pos;
+			// NOLINTEND(*pointer-arithmetic)
+			return glm::cross(b - a, c - a);
+		}
+
+	} // namespace
+
+	namespace mesh_optimizer {
+
+		mesh_optimization_stats optimize(std::vector<mesh_vertex>& vertices, std::vector<int>& indices) {
+			mesh_optimization_stats stats;
+			stats.vertices_before   = vertices.size();
+			stats.triangles_before  = indices.size() / 3;
+			stats.transforms_before = simulate_vertex_cache(indices, vertices.size(), VERTEX_CACHE_SIZE);
+
+			if (indices.size() % 3 == 0) {
+				weld_vertices(vertices, indices);
+				remove_degenerate_triangles(vertices, indices);
+				optimize_vertex_cache(indices, vertices.size());
+				optimize_overdraw(vertices, indices);
+				optimize_vertex_fetch(vertices, indices);
+			}
+
+			stats.vertices_after   = vertices.size();
+			stats.triangles_after  = indices.size() / 3;
+			stats.transforms_after = simulate_vertex_cache(indices, vertices.size(), VERTEX_CACHE_SIZE);
+
+			return stats;
+		}
+
+		void weld_vertices(std::vector<mesh_vertex>& vertices, std::vector<int>& indices) {
+			std::unordered_map<vertex_key, int, vertex_key_hash> unique;
+			unique.reserve(vertices.size());
+
+			std::vector<int>         remap(vertices.size());
+			std::vector<mesh_vertex> welded;
+			welded.reserve(vertices.size());
+
+			for (size_t i = 0; i < vertices.size(); i++) {
+				auto [it, inserted] = unique.try_emplace(make_key(vertices[i]), static_cast<int>(welded.size()));
+				if (inserted) {
+					welded.push_back(vertices[i]);
+				}
+				remap[i] = it->second;
+			}
+
+			for (auto& index : indices) {
+				index = remap[static_cast<size_t>(index)];
+			}
+			vertices = std::move(welded);
+		}
+
+		void remove_degenerate_triangles(const std::vector<mesh_vertex>& vertices, std::vector<int>& indices) {
+			size_t kept = 0;
+			for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+				const int* triangle = &indices[i];
+				// NOLINTBEGIN(*pointer-arithmetic)
+				if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2]) {
+					continue;
+				}
+				// NOLINTEND(*pointer-arithmetic)
+
+				const auto normal = triangle_normal(vertices, triangle);
+				if (glm::dot(normal, normal) == 0.0f) {
+					continue;
+				}
+
+				std::copy_n(indices.begin() + static_cast<std::ptrdiff_t>(i), 3,
+				            indices.begin() + static_cast<std::ptrdiff_t>(kept));
+				kept += 3;
+			}
+			indices.resize(kept);
+		}
+
+		void optimize_vertex_cache(std::vector<int>& indices, size_t vertex_count) {
+			const size_t triangle_count = indices.size() / 3;
+			if (triangle_count == 0) {
+				return;
+			}
+
+			// triangles adjacent to every vertex, first remaining[v] entries of each range are not emitted yet
+			std::vector<uint32_t> remaining(vertex_count, 0);
+			for (const auto index : indices) {
+				remaining[static_cast<size_t>(index)]++;
+			}
+
+			std::vector<uint32_t> offsets(vertex_count + 1, 0);
+			std::partial_sum(remaining.begin(), remaining.end(), offsets.begin() + 1);
+
+			std::vector<uint32_t> adjacency(indices.size());
+			{
+				std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+				for (size_t i = 0; i < indices.size(); i++) {
+					adjacency[cursor[static_cast<size_t>(indices[i])]++] = static_cast<uint32_t>(i / 3);
+				}
+			}
+
+			std::vector<int>   cache_pos(vertex_count, -1);
+			std::vector<float> vertex_scores(vertex_count);
+			for (size_t v = 0; v < vertex_count; v++) {
+				vertex_scores[v] = vertex_score(-1, remaining[v]);
+			}
+
+			std::vector<float> triangle_scores(triangle_count);
+			for (size_t t = 0; t < triangle_count; t++) {
+				triangle_scores[t] = vertex_scores[static_cast<size_t>(indices[t * 3])] +
+				                     vertex_scores[static_cast<size_t>(indices[t * 3 + 1])] +
+				                     vertex_scores[static_cast<size_t>(indices[t * 3 + 2])];
+			}
+
+			std::vector<bool> emitted(triangle_count, false);
+			std::vector<int>  result;
+			result.reserve(indices.size());
+
+			std::vector<int> cache;
+			std::vector<int> next_cache;
+			cache.reserve(VERTEX_CACHE_SIZE + 3);
+			next_cache.reserve(VERTEX_CACHE_SIZE + 3);
+
+			size_t  scan = 0;
+			int64_t best = -1;
+
+			while (result.size() < indices.size()) {
+				if (best < 0) {
+					// nothing adjacent to cache is left, continue with next triangle in input order
+					while (emitted[scan]) {
+						scan++;
+					}
+					best = static_cast<int64_t>(scan);
+				}
+
+				const auto triangle = static_cast<size_t>(best);
+				emitted[triangle]   = true;
+
+				next_cache.clear();
+				for (size_t k = 0; k < 3; k++) {
+					const int  vertex = indices[triangle * 3 + k];
+					const auto v      = static_cast<size_t>(vertex);
+					result.push_back(vertex);
+					next_cache.push_back(vertex);
+
+					auto* begin = &adjacency[offsets[v]];
+					auto* end   = begin + remaining[v]; // NOLINT(*pointer-arithmetic)
+					auto* it    = std::find(begin, end, static_cast<uint32_t>(triangle));
+					std::iter_swap(it, end - 1); // NOLINT(*pointer-arithmetic)
+					remaining[v]--;
+				}
+
+				for (const int vertex : cache) {
+					if (std::find(next_cache.begin(), next_cache.end(), vertex) == next_cache.end()) {
+						next_cache.push_back(vertex);
+					}
+				}
+				std::swap(cache, next_cache);
+
+				// evicted vertices lose their cache bonus
+				for (size_t i = 0; i < cache.size(); i++) {
+					cache_pos[static_cast<size_t>(cache[i])] = i < VERTEX_CACHE_SIZE ? static_cast<int>(i) : -1;
+				}
+
+				for (const int vertex : cache) {
+					const auto  v     = static_cast<size_t>(vertex);
+					const float score = vertex_score(cache_pos[v], remaining[v]);
+					const float delta = score - vertex_scores[v];
+					vertex_scores[v]  = score;
+					for (uint32_t i = offsets[v]; i < offsets[v] + remaining[v]; i++) {
+						triangle_scores[adjacency[i]] += delta;
+					}
+				}
+
+				best             = -1;
+				float best_score = -1.0f;
+				for (const int vertex : cache) {
+					const auto v = static_cast<size_t>(vertex);
+					for (uint32_t i = offsets[v]; i < offsets[v] + remaining[v]; i++) {
+						if (triangle_scores[adjacency[i]] > best_score) {
+							best_score = triangle_scores[adjacency[i]];
+							best       = adjacency[i];
+						}
+					}
+				}
+
+				if (cache.size() > VERTEX_CACHE_SIZE) {
+					cache.resize(VERTEX_CACHE_SIZE);
+				}
+			}
+
+			indices = std::move(result);
+		}
+
+		void optimize_overdraw(const std::vector<mesh_vertex>& vertices, std::vector<int>& indices) {
+			const size_t triangle_count = indices.size() / 3;
+			if (triangle_count == 0) {
+				return;
+			}
+
+			// cluster boundaries are where the cache is entirely cold, so reordering clusters keeps vertex cache order
+			std::vector<size_t> cluster_starts;
+			{
+				std::vector<size_t> stamps(vertices.size(), 0);
+				size_t              timestamp = VERTEX_CACHE_SIZE + 1;
+				for (size_t t = 0; t < triangle_count; t++) {
+					size_t misses = 0;
+					for (size_t k = 0; k < 3; k++) {
+						const auto v = static_cast<size_t>(indices[t * 3 + k]);
+						if (timestamp - stamps[v] > VERTEX_CACHE_SIZE) {
+							stamps[v] = timestamp++;
+							misses++;
+						}
+					}
+					if (t == 0 || misses == 3) {
+						cluster_starts.push_back(t);
+					}
+				}
+			}
+			cluster_starts.push_back(triangle_count);
+
+			glm::vec3 mesh_centroid{ 0.0f };
+			for (const auto& vertex : vertices) {
+				mesh_centroid += vertex.pos;
+			}
+			mesh_centroid /= static_cast<float>(std::max<size_t>(vertices.size(), 1));
+
+			const size_t       cluster_count = cluster_starts.size() - 1;
+			std::vector<float> sort_keys(cluster_count);
+			for (size_t c = 0; c < cluster_count; c++) {
+				glm::vec3 centroid{ 0.0f };
+				glm::vec3 normal{ 0.0f };
+				float     area = 0.0f;
+				for (size_t t = cluster_starts[c]; t < cluster_starts[c + 1]; t++) {
+					const int* triangle = &indices[t * 3];
+					const auto n        = triangle_normal(vertices, triangle);
+					const auto a        = glm::length(n);
+					// NOLINTBEGIN(*pointer-arithmetic)
+					centroid += (vertices[static_cast<size_t>(triangle[0])].pos + vertices[static_cast<size_t>(triangle[1])].pos +
+					             vertices[static_cast<size_t>(triangle[2])].pos) *
+					            (a / 3.0f);
+					// NOLINTEND(*pointer-arithmetic)
+					normal += n;
+					area += a;
+				}
+				const float normal_length = glm::length(normal);
+				if (area == 0.0f || normal_length == 0.0f) {
+					sort_keys[c] = 0.0f;
+					continue;
+				}
+				sort_keys[c] = glm::dot(centroid / area - mesh_centroid, normal / normal_length);
+			}
+
+			std::vector<size_t> order(cluster_count);
+			std::iota(order.begin(), order.end(), 0);
+			std::stable_sort(order.begin(), order.end(), [&sort_keys](size_t l, size_t r) {
+				return sort_keys[l] > sort_keys[r];
+			});
+
+			std::vector<int> result;
+			result.reserve(indices.size());
+			for (const auto c : order) {
+				result.insert(result.end(), indices.begin() + static_cast<std::ptrdiff_t>(cluster_starts[c] * 3),
+				              indices.begin() + static_cast<std::ptrdiff_t>(cluster_starts[c + 1] * 3));
+			}
+			indices = std::move(result);
+		}
+
+		void optimize_vertex_fetch(std::vector<mesh_vertex>& vertices, std::vector<int>& indices) {
+			std::vector<int>         remap(vertices.size(), -1);
+			std::vector<mesh_vertex> ordered;
+			ordered.reserve(vertices.size());
+
+			for (auto& index : indices) {
+				auto& mapped = remap[static_cast<size_t>(index)];
+				if (mapped < 0) {
+					mapped = static_cast<int>(ordered.size());
+					ordered.push_back(vertices[static_cast<size_t>(index)]);
+				}
+				index = mapped;
+			}
+			vertices = std::move(ordered);
+		}
+
+		size_t simulate_vertex_cache(const std::vector<int>& indices, size_t vertex_count, size_t cache_size) {
+			std::vector<size_t> stamps(vertex_count, 0);
+			size_t              timestamp = cache_size + 1;
+			size_t              misses    = 0;
+			for (const auto index : indices) {
+				const auto v = static_cast<size_t>(index);
+				if (timestamp - stamps[v] > cache_size) {
+					stamps[v] = timestamp++;
+					misses++;
+				}
+			}
+			return misses;
+		}
+
+	} // namespace mesh_optimizer
+
+} // namespace kanso
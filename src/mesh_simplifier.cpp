@@ -0,0 +1,301 @@
+#include "mesh_simplifier.hpp"
+#include "mesh_optimizer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+
+namespace kanso {
+
+	namespace {
+
+		// area weighted sum of squared distances to triangle planes
+		struct quadric {
+			std::array<double, 10> q{}; // a2 ab ac ad b2 bc bd c2 cd d2
+			double                 weight{};
+
+			static quadric from_plane(const glm::dvec3& n, double d, double w) {
+				quadric result;
+				result.q      = { n.x * n.x * w, n.x * n.y * w, n.x * n.z * w, n.x * d * w, n.y * n.y * w,
+					              n.y * n.z * w, n.y * d * w,   n.z * n.z * w, n.z * d * w, d * d * w };
+				result.weight = w;
+				return result;
+			}
+
+			quadric& operator+=(const quadric& other) {
+				for (size_t i = 0; i < q.size(); i++) {
+					q[i] += other.q[i];
+				}
+				weight += other.weight;
+				return *this;
+			}
+
+			// mean squared distance of p to accumulated planes
+			[[nodiscard]] double error(const glm::vec3& p) const {
+				const double x = p.x;
+				const double y = p.y;
+				const double z = p.z;
+				// NOLINTBEGIN(*magic-numbers)
+				const double e = q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x + q[4] * y * y +
+				                 2 * q[5] * y * z + 2 * q[6] * y + q[7] * z * z + 2 * q[8] * z + q[9];
+				// NOLINTEND(*magic-numbers)
+				return weight > 0.0 ? std::abs(e) / weight : 0.0;
+			}
+		};
+
+		struct collapse {
+			double   cost{};
+			uint32_t from{};
+			uint32_t to{};
+		};
+
+		uint64_t edge_key(uint32_t a, uint32_t b) {
+			return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+		}
+
+		std::vector<uint64_t> unique_edges(const std::vector<int>& indices) {
+			std::vector<uint64_t> edges;
+			edges.reserve(indices.size());
+			for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+				for (size_t k = 0; k < 3; k++) {
+					edges.push_back(edge_key(static_cast<uint32_t>(indices[i + k]),
+					                         static_cast<uint32_t>(indices[i + (k + 1) % 3])));
+				}
+			}
+			std::sort(edges.begin(), edges.end());
+			return edges;
+		}
+
+		// vertices on edges used by one triangle only, these are mesh borders or seams split by welding
+		std::vector<bool> find_locked(size_t vertex_count, const std::vector<int>& indices) {
+			std::vector<bool> locked(vertex_count, false);
+			const auto        edges = unique_edges(indices);
+			for (size_t i = 0; i < edges.size();) {
+				size_t j = i;
+				while (j < edges.size() && edges[j] == edges[i]) {
+					j++;
+				}
+				if (j - i == 1) {
+					locked[edges[i] >> 32]         = true;
+					locked[edges[i] & 0xffffffffU] = true;
+				}
+				i = j;
+			}
+			return locked;
+		}
+
+		// true if moving from onto to keeps every remaining triangle around from facing the same way
+		bool preserves_orientation(const std::vector<mesh_vertex>& vertices, const std::vector<int>& indices,
+		                           const std::vector<uint32_t>& triangles, uint32_t from, uint32_t to) {
+			for (const auto triangle : triangles) {
+				std::array<uint32_t, 3> corners{};
+				for (size_t k = 0; k < 3; k++) {
+					corners[k] = static_cast<uint32_t>(indices[triangle * 3 + k]);
+				}
+				if (std::find(corners.begin(), corners.end(), to) != corners.end()) {
+					continue; // collapses to degenerate and is removed
+				}
+
+				std::array<glm::vec3, 3> before{};
+				std::array<glm::vec3, 3> after{};
+				for (size_t k = 0; k < 3; k++) {
+					before[k] = vertices[corners[k]].pos;
+					after[k]  = corners[k] == from ? vertices[to].pos : before[k];
+				}
+				const auto n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+				const auto n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+				if (glm::dot(n0, n1) <= 0.0f) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+	} // namespace
+
+	namespace mesh_simplifier {
+
+		mesh_lod simplify(const std::vector<mesh_vertex>& vertices, const std::vector<int>& indices,
+		                  size_t target_index_count, float max_error) {
+			const size_t vertex_count = vertices.size();
+			mesh_lod     lod{ indices, 0.0f };
+
+			std::vector<quadric> quadrics(vertex_count);
+			for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+				const glm::dvec3 a(vertices[static_cast<size_t>(indices[i])].pos);
+				const glm::dvec3 b(vertices[static_cast<size_t>(indices[i + 1])].pos);
+				const glm::dvec3 c(vertices[static_cast<size_t>(indices[i + 2])].pos);
+				const glm::dvec3 cross  = glm::cross(b - a, c - a);
+				const double     length = glm::length(cross);
+				if (length == 0.0) {
+					continue;
+				}
+				const glm::dvec3 n    = cross / length;
+				const auto       q    = quadric::from_plane(n, -glm::dot(n, a), length * 0.5);
+				for (size_t k = 0; k < 3; k++) {
+					quadrics[static_cast<size_t>(indices[i + k])] += q;
+				}
+			}
+
+			const auto   locked          = find_locked(vertex_count, indices);
+			const double max_cost        = static_cast<double>(max_error) * static_cast<double>(max_error);
+			double       collapsed_error = 0.0;
+
+			std::vector<uint32_t> remap(vertex_count);
+			std::vector<bool>     touched(vertex_count);
+			std::vector<uint32_t> offsets(vertex_count + 1);
+			std::vector<uint32_t> adjacency;
+			std::vector<collapse> collapses;
+
+			while (lod.indices.size() > target_index_count) {
+				// candidate collapses over every edge, cheaper direction first
+				const auto edges = unique_edges(lod.indices);
+				collapses.clear();
+				for (size_t i = 0; i < edges.size(); i++) {
+					if (i > 0 && edges[i] == edges[i - 1]) {
+						continue;
+					}
+					const auto a = static_cast<uint32_t>(edges[i] >> 32);
+					const auto b = static_cast<uint32_t>(edges[i] & 0xffffffffU);
+
+					quadric merged = quadrics[a];
+					merged += quadrics[b];
+
+					collapse best{ std::numeric_limits<double>::max(), 0, 0 };
+					if (!locked[a]) {
+						best = { merged.error(vertices[b].pos), a, b };
+					}
+					if (!locked[b]) {
+						const double cost = merged.error(vertices[a].pos);
+						if (cost < best.cost) {
+							best = { cost, b, a };
+						}
+					}
+					if (best.cost <= max_cost) {
+						collapses.push_back(best);
+					}
+				}
+				if (collapses.empty()) {
+					break;
+				}
+				std::sort(collapses.begin(), collapses.end(),
+				          [](const collapse& l, const collapse& r) { return l.cost < r.cost; });
+
+				// triangles around every vertex of current level
+				std::fill(offsets.begin(), offsets.end(), 0);
+				for (const auto index : lod.indices) {
+					offsets[static_cast<size_t>(index) + 1]++;
+				}
+				std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+				adjacency.resize(lod.indices.size());
+				{
+					std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+					for (size_t i = 0; i < lod.indices.size(); i++) {
+						adjacency[cursor[static_cast<size_t>(lod.indices[i])]++] = static_cast<uint32_t>(i / 3);
+					}
+				}
+
+				std::iota(remap.begin(), remap.end(), 0);
+				std::fill(touched.begin(), touched.end(), false);
+
+				// each collapse removes about two triangles, stop once the target is reached
+				const size_t triangles_to_remove = (lod.indices.size() - target_index_count) / 3;
+				size_t       removed             = 0;
+				for (const auto& c : collapses) {
+					if (touched[c.from] || touched[c.to]) {
+						continue;
+					}
+
+					const std::vector<uint32_t> around(adjacency.begin() + offsets[c.from],
+					                                   adjacency.begin() + offsets[c.from + 1]);
+					if (!preserves_orientation(vertices, lod.indices, around, c.from, c.to)) {
+						continue;
+					}
+
+					// neighbours of collapsed vertex are frozen too, so orientation checks above stay valid this pass
+					for (const auto triangle : around) {
+						for (size_t k = 0; k < 3; k++) {
+							const auto corner = static_cast<size_t>(lod.indices[triangle * 3 + k]);
+							touched[corner]   = true;
+							if (corner == c.to) {
+								removed++;
+							}
+						}
+					}
+					touched[c.to] = true;
+
+					remap[c.from] = c.to;
+					quadrics[c.to] += quadrics[c.from];
+					collapsed_error = std::max(collapsed_error, c.cost);
+
+					if (removed >= triangles_to_remove) {
+						break;
+					}
+				}
+
+				size_t kept = 0;
+				for (size_t i = 0; i + 2 < lod.indices.size(); i += 3) {
+					const auto a = static_cast<int>(remap[static_cast<size_t>(lod.indices[i])]);
+					const auto b = static_cast<int>(remap[static_cast<size_t>(lod.indices[i + 1])]);
+					const auto c = static_cast<int>(remap[static_cast<size_t>(lod.indices[i + 2])]);
+					if (a == b || b == c || a == c) {
+						continue;
+					}
+					lod.indices[kept++] = a;
+					lod.indices[kept++] = b;
+					lod.indices[kept++] = c;
+				}
+				if (kept == lod.indices.size()) {
+					break;
+				}
+				lod.indices.resize(kept);
+			}
+
+			lod.error = static_cast<float>(std::sqrt(collapsed_error));
+			return lod;
+		}
+
+		std::vector<mesh_lod> build_lod_chain(const std::vector<mesh_vertex>& vertices, const std::vector<int>& indices) {
+			std::vector<mesh_lod> lods;
+			if (vertices.empty() || indices.size() < MIN_LOD_INDICES * 2) {
+				return lods;
+			}
+
+			glm::vec3 min = vertices.front().pos;
+			glm::vec3 max = vertices.front().pos;
+			for (const auto& vertex : vertices) {
+				min = glm::min(min, vertex.pos);
+				max = glm::max(max, vertex.pos);
+			}
+			const float max_error = glm::length(max - min) * MAX_LOD_ERROR_RATIO;
+
+			size_t previous = indices.size();
+			float  target   = static_cast<float>(indices.size());
+			for (size_t level = 0; level < MAX_LOD_COUNT; level++) {
+				target *= LOD_REDUCTION;
+				const size_t target_count = static_cast<size_t>(target) / 3 * 3;
+				if (target_count < MIN_LOD_INDICES) {
+					break;
+				}
+
+				// every level starts from base mesh, so its error is measured against what is actually drawn at LOD 0
+				auto lod = simplify(vertices, indices, target_count, max_error);
+				if (static_cast<float>(lod.indices.size()) > static_cast<float>(previous) * 0.8f) {
+					break;
+				}
+				previous = lod.indices.size();
+
+				mesh_optimizer::optimize_vertex_cache(lod.indices, vertices.size());
+				lods.push_back(std::move(lod));
+			}
+			return lods;
+		}
+
+	} // namespace mesh_simplifier
+
+} // namespace kanso
@@ -0,0 +1,217 @@
+#include "model_cache.hpp"
+#include "binary_io.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <functional>
+#include <sstream>
+
+namespace kanso {
+
+	namespace {
+
+		constexpr std::array<char, 4> CACHE_MAGIC   = { 'K', 'M', 'C', 'H' };
+		constexpr uint32_t            CACHE_VERSION = 4;
+
+		struct cache_header {
+			std::array<char, 4> magic{};
+			uint32_t            version{};
+			uint32_t            import_flags{};
+			uint32_t            mesh_count{};
+			int64_t             source_mtime{};
+			uint64_t            source_size{};
+			uint64_t            payload_size{};
+			uint64_t            payload_hash{};
+			uint32_t            path_size{};
+			uint32_t            reserved{};
+		};
+
+		struct cached_mesh_header {
+			uint32_t             vertex_count{};
+			uint32_t             index_count{};
+			uint32_t             map_count{};
+			uint32_t             lod_count{};
+			uint32_t             bvh_node_count{};
+			uint32_t             bvh_triangle_count{};
+			std::array<float, 3> aabb_min{};
+			std::array<float, 3> aabb_max{};
+		};
+
+		struct cached_lod_header {
+			uint32_t index_count{};
+			float    error{};
+		};
+
+		struct cached_map_header {
+			uint32_t path_size{};
+			uint32_t type_size{};
+		};
+
+		std::optional<std::vector<mesh_data>> parse_payload(byte_reader& reader, uint32_t mesh_count) {
+			std::vector<mesh_data> meshes;
+			meshes.reserve(mesh_count);
+
+			for (uint32_t i = 0; i < mesh_count; i++) {
+				cached_mesh_header header;
+				if (!reader.read(header)) {
+					return std::nullopt;
+				}
+
+				std::vector<mesh_vertex> vertices(header.vertex_count);
+				std::vector<int>         indices(header.index_count);
+				if (!reader.read(vertices.data(), vertices.size() * sizeof(mesh_vertex)) ||
+				    !reader.read(indices.data(), indices.size() * sizeof(int)))
+				{
+					return std::nullopt;
+				}
+
+				std::vector<mesh_lod> lods(header.lod_count);
+				for (auto& lod : lods) {
+					cached_lod_header lod_header;
+					if (!reader.read(lod_header) || !reader.read(lod.indices, lod_header.index_count)) {
+						return std::nullopt;
+					}
+					lod.error = lod_header.error;
+				}
+
+				std::vector<triangle_bvh::node> bvh_nodes;
+				std::vector<uint32_t>           bvh_triangles;
+				if (!reader.read(bvh_nodes, header.bvh_node_count) ||
+				    !reader.read(bvh_triangles, header.bvh_triangle_count))
+				{
+					return std::nullopt;
+				}
+
+				std::vector<raw_tex> maps(header.map_count);
+				for (auto& map : maps) {
+					cached_map_header map_header;
+					if (!reader.read(map_header) || !reader.read(map.path, map_header.path_size) ||
+					    !reader.read(map.type, map_header.type_size))
+					{
+						return std::nullopt;
+					}
+				}
+
+				const glm::vec3 aabb_min{ header.aabb_min[0], header.aabb_min[1], header.aabb_min[2] };
+				const glm::vec3 aabb_max{ header.aabb_max[0], header.aabb_max[1], header.aabb_max[2] };
+				meshes.emplace_back(std::move(vertices), std::move(indices), std::move(maps), aabb_min, aabb_max,
+				                    std::move(lods), triangle_bvh(std::move(bvh_nodes), std::move(bvh_triangles)));
+			}
+
+			return meshes;
+		}
+
+	} // namespace
+
+	model_cache::model_cache(std::string cache_dir) : cache_dir_(std::move(cache_dir)) {}
+
+	std::string model_cache::entry_path(std::string_view path) const {
+		return fmt::format("{}/{:016x}.kmc", cache_dir_, std::hash<std::string_view>{}(path));
+	}
+
+	std::optional<std::vector<mesh_data>> model_cache::load(std::string_view path, uint import_flags) const {
+		int64_t  mtime{};
+		uint64_t size{};
+		if (!source_stamp(path, mtime, size)) {
+			return std::nullopt;
+		}
+
+		const auto        cache_path = entry_path(path);
+		const mapped_file file(cache_path);
+		if (file.data() == nullptr) {
+			return std::nullopt;
+		}
+
+		byte_reader  reader(file.data(), file.size());
+		cache_header header;
+		if (!reader.read(header) || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION) {
+			spdlog::warn("Import cache entry {} for {} is corrupt or outdated", cache_path, path);
+			return std::nullopt;
+		}
+
+		std::string cached_path;
+		if (!reader.read(cached_path, header.path_size) || cached_path != path) {
+			// hash collision or corrupt name, either way the entry is not ours
+			return std::nullopt;
+		}
+
+		if (header.import_flags != import_flags || header.source_mtime != mtime || header.source_size != size) {
+			spdlog::debug("Import cache entry for {} is stale", path);
+			return std::nullopt;
+		}
+
+		// payload is hashed as a whole before parsing, so counts read from it below can be trusted
+		const size_t payload_offset = reader.offset();
+		if (header.payload_size != file.size() - payload_offset ||
+		    header.payload_hash != fnv1a(file.data() + payload_offset, header.payload_size)) // NOLINT(*pointer-arithmetic)
+		{
+			spdlog::warn("Import cache entry {} for {} is corrupt", cache_path, path);
+			return std::nullopt;
+		}
+
+		auto meshes = parse_payload(reader, header.mesh_count);
+		if (!meshes) {
+			spdlog::warn("Import cache entry {} for {} is corrupt", cache_path, path);
+		}
+		return meshes;
+	}
+
+	void model_cache::store(std::string_view path, uint import_flags, const std::vector<mesh_data>& meshes) const {
+		cache_header header;
+		header.magic        = CACHE_MAGIC;
+		header.version      = CACHE_VERSION;
+		header.import_flags = import_flags;
+		header.mesh_count   = static_cast<uint32_t>(meshes.size());
+		header.path_size    = static_cast<uint32_t>(path.size());
+		if (!source_stamp(path, header.source_mtime, header.source_size)) {
+			return;
+		}
+
+		std::ostringstream payload(std::ios::binary);
+		for (const auto& mesh : meshes) {
+			cached_mesh_header mesh_header;
+			mesh_header.vertex_count       = static_cast<uint32_t>(mesh.vertices.size());
+			mesh_header.index_count        = static_cast<uint32_t>(mesh.indices.size());
+			mesh_header.map_count          = static_cast<uint32_t>(mesh.raw_maps.size());
+			mesh_header.lod_count          = static_cast<uint32_t>(mesh.lods.size());
+			mesh_header.bvh_node_count     = static_cast<uint32_t>(mesh.bvh.nodes().size());
+			mesh_header.bvh_triangle_count = static_cast<uint32_t>(mesh.bvh.triangles().size());
+			mesh_header.aabb_min           = { mesh.aabb_min[0], mesh.aabb_min[1], mesh.aabb_min[2] };
+			mesh_header.aabb_max           = { mesh.aabb_max[0], mesh.aabb_max[1], mesh.aabb_max[2] };
+
+			write(payload, mesh_header);
+			write(payload, mesh.vertices);
+			write(payload, mesh.indices);
+			for (const auto& lod : mesh.lods) {
+				write(payload, cached_lod_header{ static_cast<uint32_t>(lod.indices.size()), lod.error });
+				write(payload, lod.indices);
+			}
+			write(payload, mesh.bvh.nodes());
+			write(payload, mesh.bvh.triangles());
+			for (const auto& map : mesh.raw_maps) {
+				write(payload, cached_map_header{ static_cast<uint32_t>(map.path.size()),
+				                                  static_cast<uint32_t>(map.type.size()) });
+				payload.write(map.path.data(), static_cast<std::streamsize>(map.path.size()));
+				payload.write(map.type.data(), static_cast<std::streamsize>(map.type.size()));
+			}
+		}
+
+		const auto bytes     = payload.str();
+		header.payload_size = bytes.size();
+		header.payload_hash = fnv1a(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size()); // NOLINT(*reinterpret-cast)
+
+		const auto cache_path = entry_path(path);
+		const bool written    = write_file_atomically(cache_path, [&](std::ostream& out) {
+			write(out, header);
+			out.write(path.data(), static_cast<std::streamsize>(path.size()));
+			out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+		});
+		if (!written) {
+			spdlog::warn("Failed to write import cache entry for {}", path);
+			return;
+		}
+
+		spdlog::debug("Cached import of {} to {}", path, cache_path);
+	}
+
+} // namespace kanso
@@ -1,6 +1,11 @@
 #include "model_data_loader.hpp"
-#include "stb_image.h"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "job_graph.hpp"
+#include "model_cache.hpp"
+#include "texture_cache.hpp"
 #include "thread_pool.hpp"
+#include "upload_queue.hpp"
 
 #include <spdlog/spdlog.h>
 #include <assimp/mesh.h>
@@ -11,13 +16,15 @@
 
 #include <stack>
 #include <set>
-#include <list>
 #include <sstream>
 
 namespace kanso {
 
 	namespace {
 
+		constexpr uint IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_OptimizeMeshes |
+		                              aiProcess_OptimizeGraph | aiProcess_GenBoundingBoxes;
+
 		template<typename OutputIt>
 		void collect_ai_meshes_data(aiNode* root_node, const aiScene* scene, OutputIt meshes) {
 			if (root_node == nullptr || scene == nullptr) {
@@ -78,20 +85,15 @@ namespace kanso {
 
 		template<typename OutputIt>
 		void parse_textures(std::string_view dir, const aiMaterial* mat, aiTextureType ai_type,
-		                                    std::string_view type_name, OutputIt out) {
+		                                    std::string_view type_name, thread_pool& pool, upload_queue& uploads,
+		                                    OutputIt out) {
 			for (uint i = 0; i < mat->GetTextureCount(ai_type); i++) {
 				aiString filename;
 				mat->GetTexture(ai_type, i, &filename);
 				std::ostringstream oss;
 				oss << dir << '/' << filename.C_Str();
-				auto path = oss.str();
 				raw_tex tex;
-				tex.bytes = stbi_load(path.c_str(), &tex.width, &tex.height, &tex.nr_channels, 0);
-				if (tex.bytes == nullptr) {
-					spdlog::warn("Null texture");
-					continue;
-				}
-				tex.path = path;
+				tex.path = texture_cache::instance().request(oss.str(), pool, uploads);
 				tex.type = type_name;
 
 				try {
@@ -104,7 +106,8 @@ namespace kanso {
 		}
 
 		template<typename OutputIt>
-		void create_raw_maps(std::string_view dir, const aiMaterial* mat, OutputIt out) {
+		void create_raw_maps(std::string_view dir, const aiMaterial* mat, thread_pool& pool, upload_queue& uploads,
+		                     OutputIt out) {
 			const static std::vector<std::pair<aiTextureType, std::string_view>> map_conf = {
 				{ aiTextureType_DIFFUSE, "texture_diffuse" },
 				{ aiTextureType_SPECULAR, "texture_specular" },
@@ -120,13 +123,41 @@ namespace kanso {
 			for (const auto& pair : map_conf) {
 				std::vector<raw_tex> raw_textures;
 				raw_textures.reserve(mat->GetTextureCount(pair.first));
-				parse_textures(dir, mat, pair.first, pair.second, std::back_inserter(raw_textures));
+				parse_textures(dir, mat, pair.first, pair.second, pool, uploads, std::back_inserter(raw_textures));
 				if (!raw_textures.empty()) {
 					*out++ = raw_textures[0];
 				}
 			}
 		}
 
+		struct imported_geometry {
+			std::vector<mesh_vertex> vertices;
+			std::vector<int>         indices;
+			std::vector<mesh_lod>    lods;
+			triangle_bvh             bvh;
+			mesh_optimization_stats  stats;
+		};
+
+		imported_geometry import_geometry(const aiMesh* ai_mesh) {
+			imported_geometry geometry;
+			geometry.vertices.reserve(ai_mesh->mNumVertices);
+			parse_vertices(ai_mesh, std::back_inserter(geometry.vertices));
+
+			size_t total_indices = 0;
+			for (size_t i = 0; i < ai_mesh->mNumFaces; ++i) {
+				total_indices += ai_mesh->mFaces[i].mNumIndices;  // NOLINT(*pointer-arithmetic)
+			}
+
+			geometry.indices.reserve(total_indices);
+			parse_indices(ai_mesh, std::back_inserter(geometry.indices));
+
+			geometry.stats = mesh_optimizer::optimize(geometry.vertices, geometry.indices);
+			geometry.lods  = mesh_simplifier::build_lod_chain(geometry.vertices, geometry.indices);
+			// over final index order, so picking hits the triangles that are drawn
+			geometry.bvh = triangle_bvh::build(geometry.vertices, geometry.indices);
+			return geometry;
+		}
+
 	} // anonymous namespace
 
 	template<typename InputIt>
@@ -141,88 +172,221 @@ namespace kanso {
 			}
 			meshes_.emplace_back(data);
 		});
+		occluder_ = make_occluder(meshes_);
 	}
 
-	model_data_loader::model_data_loader(std::vector<std::string>::iterator paths_begin, std::vector<std::string>::iterator paths_end) {
+	// assimp scene of one model and everything computed from it while import jobs of that model run
+	struct model_data_loader::import_state {
+		std::string                       path;
+		Assimp::Importer                  importer;
+		const aiScene*                    scene{};
+		std::vector<aiMesh*>              ai_meshes;
+		std::vector<imported_geometry>    geometry;
+		std::vector<std::vector<raw_tex>> maps;
+	};
+
+	model_data_loader::model_data_loader(std::vector<std::string>::iterator paths_begin,
+	                                     std::vector<std::string>::iterator paths_end, thread_pool& pool,
+	                                     upload_queue& uploads)
+	    : uploads_(uploads),
+	      pool_(pool),
+	      graph_(std::make_unique<job_graph>(pool_)) {
 		load(paths_begin, paths_end);
 	}
 
+	model_data_loader::~model_data_loader() {
+		// import jobs refer to this loader and have to finish here. Texture decoding jobs they enqueue only
+		// refer to upload queue, owner of pool joins them
+		graph_->wait();
+
+		// nothing becomes resident anymore, waiting coroutines continue with nullptr
+		std::vector<resident_awaiter*> waiters;
+		{
+			const std::lock_guard<std::mutex> lock(mut_);
+			waiters.swap(waiters_);
+		}
+		for (auto* waiter : waiters) {
+			waiter->handle.resume();
+		}
+	}
+
 	template<typename InputIt>
 	void model_data_loader::load(InputIt paths_begin, InputIt paths_end) {
-		const std::unordered_set<std::string_view> unique_paths{ paths_begin, paths_end };
+		const std::lock_guard<std::mutex> lock(mut_);
+		for (auto it = paths_begin; it != paths_end; ++it) {
+			if (requested_.insert(*it).second) {
+				import(*it);
+			}
+		}
+	}
+
+	void model_data_loader::import(const std::string& path) {
+		// every model is its own chain of jobs, so small models don't wait behind large ones
+		++remaining_imports_;
+		auto state  = std::make_shared<import_state>();
+		state->path = path;
+		graph_->add(fmt::format("read {}", path), [this, state]() { read_model(state); });
+	}
+
+	task<std::shared_ptr<model_data>> model_data_loader::load_model(std::string path) {
+		co_return co_await resident_awaiter{ *this, std::move(path), nullptr, {} };
+	}
 
+	bool model_data_loader::wait_for(resident_awaiter& awaiter) {
+		const std::lock_guard<std::mutex> lock(mut_);
+		if (auto it = resident_.find(awaiter.path); it != resident_.end()) {
+			awaiter.data = it->second;
+			return false;
+		}
+
+		waiters_.push_back(&awaiter);
+		if (requested_.insert(awaiter.path).second) {
+			import(awaiter.path);
+		}
+		return true;
+	}
+
+	void model_data_loader::resume_resident() {
+		std::vector<resident_awaiter*> ready;
 		{
-			thread_pool pool{ std::thread::hardware_concurrency() };
-			for (const auto& path : unique_paths) {
-				pool.enqueue([this, path]() { load_raw_model(path); });
+			const std::lock_guard<std::mutex> lock(mut_);
+			auto uploaded = std::partition(pending_.begin(), pending_.end(), [](auto& data) { return !data->resident(); });
+			for (auto it = uploaded; it != pending_.end(); ++it) {
+				spdlog::debug("Model {} is resident", (*it)->name());
+				resident_.emplace((*it)->name(), std::move(*it));
+			}
+			pending_.erase(uploaded, pending_.end());
+
+			auto waiting = std::partition(waiters_.begin(), waiters_.end(),
+			                              [this](auto* waiter) { return !resident_.contains(waiter->path); });
+			for (auto it = waiting; it != waiters_.end(); ++it) {
+				(*it)->data = resident_.at((*it)->path);
 			}
+			ready.assign(waiting, waiters_.end());
+			waiters_.erase(waiting, waiters_.end());
+		}
+
+		// resumed coroutines may request more models, so lock is released first
+		for (auto* waiter : ready) {
+			waiter->handle.resume();
 		}
+	}
 
-		for (auto&& kv : raw_models_data_) {
-			auto data = std::make_unique<model_data>(kv.first, kv.second.begin(), kv.second.end());
-			models_data_.emplace(kv.first, std::move(data));
+	task<void> model_data_loader::upload(std::shared_ptr<model_data> data) {
+		// every mesh continues on render thread as its own upload job, so large models are spread over frames
+		for (auto it = data->meshes_begin(), end = data->meshes_end(); it != end; ++it) {
+			co_await uploads_.schedule(it->upload_size());
+			it->upload();
 		}
 	}
 
-	void model_data_loader::load_raw_model(std::string_view path) {
+	void model_data_loader::publish(std::shared_ptr<model_data> data) {
+		upload(data).detach();
+
+		{
+			const std::lock_guard<std::mutex> lock(mut_);
+			pending_.emplace_back(std::move(data));
+		}
+
+		if (--remaining_imports_ == 0) {
+			for (const auto& stage : graph_->critical_path()) {
+				spdlog::info("Import critical path: {} started at {:.1f} ms, took {:.1f} ms", stage.name,
+				             std::chrono::duration<double, std::milli>(stage.start).count(),
+				             std::chrono::duration<double, std::milli>(stage.duration).count());
+			}
+		}
+	}
+
+	void model_data_loader::read_model(const std::shared_ptr<import_state>& state) {
+		const auto& path = state->path;
 		spdlog::debug("Loading {} model", path);
 
-		Assimp::Importer importer;
-		const aiScene*   scene = importer.ReadFile(path.data(), aiProcess_Triangulate | aiProcess_FlipUVs |
-		                                                             aiProcess_OptimizeMeshes | aiProcess_OptimizeGraph | aiProcess_GenBoundingBoxes);
+		const model_cache cache;
+		if (auto cached = cache.load(path, IMPORT_FLAGS)) {
+			spdlog::debug("Loaded {} model from import cache", path);
+			// cached entries only keep texture references, images are decoded again
+			for (auto& data : *cached) {
+				for (auto& tex : data.raw_maps) {
+					tex.path = texture_cache::instance().request(tex.path, pool_, uploads_);
+				}
+			}
+			publish(std::make_shared<model_data>(path, cached->begin(), cached->end()));
+			return;
+		}
+
+		state->scene = state->importer.ReadFile(path.c_str(), IMPORT_FLAGS);
+		const auto* scene = state->scene;
 		if (scene == nullptr || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) != 0 ||
 		    scene->mRootNode == nullptr)
 		{
 			spdlog::error("Failed to open file: {}", path);
-			const std::lock_guard<std::mutex> lock(mut_);
-			raw_models_data_.emplace_back(path, raw_model_data{});
+			const raw_model_data empty;
+			publish(std::make_shared<model_data>(path, empty.begin(), empty.end()));
 			return;
 		}
 
-		std::list<aiMesh*> ai_meshes;
-		collect_ai_meshes_data(scene->mRootNode, scene, std::back_inserter(ai_meshes));
+		collect_ai_meshes_data(scene->mRootNode, scene, std::back_inserter(state->ai_meshes));
+		state->geometry.resize(state->ai_meshes.size());
+		state->maps.resize(state->ai_meshes.size());
 
-		auto dir = path.substr(0, path.find_last_of('/'));
+		// textures start decoding now and overlap with geometry jobs below
+		const auto dir = path.substr(0, path.find_last_of('/'));
+		for (size_t i = 0; i < state->ai_meshes.size(); i++) {
+			const auto* ai_mesh = state->ai_meshes[i];
+			if (ai_mesh->mMaterialIndex >= 0) {
+				const auto* mat = scene->mMaterials[ai_mesh->mMaterialIndex]; // NOLINT(*pointer-arithmetic)
+				create_raw_maps(dir, mat, pool_, uploads_, std::back_inserter(state->maps[i]));
+			}
+		}
+
+		std::vector<job_graph::node_id> meshes;
+		meshes.reserve(state->ai_meshes.size());
+		for (size_t i = 0; i < state->ai_meshes.size(); i++) {
+			meshes.push_back(graph_->add(fmt::format("mesh {}#{}", path, i), [state, i]() {
+				state->geometry[i] = import_geometry(state->ai_meshes[i]);
+			}));
+		}
+		graph_->add(fmt::format("build {}", path), [this, state]() { build_model(*state); }, meshes);
+	}
 
-		raw_model_data meshes_data;
-		for (const auto& ai_mesh : ai_meshes) {
+	void model_data_loader::build_model(import_state& state) {
+		const auto& path = state.path;
 
-			const auto aabb = ai_mesh->mAABB;
+		raw_model_data          meshes_data;
+		mesh_optimization_stats optimization_stats;
+		size_t                  lod_count = 0;
+		meshes_data.reserve(state.ai_meshes.size());
+		for (size_t i = 0; i < state.ai_meshes.size(); i++) {
+			const auto aabb = state.ai_meshes[i]->mAABB;
 			const glm::vec3 aabb_max { aabb.mMax.x, aabb.mMax.y, aabb.mMax.z };
 			const glm::vec3 aabb_min { aabb.mMin.x, aabb.mMin.y, aabb.mMin.z };
 
-			std::vector<mesh_vertex> vertices;
-			vertices.reserve(ai_mesh->mNumVertices);
-			parse_vertices(ai_mesh, std::back_inserter(vertices));
+			auto& mesh = state.geometry[i];
+			optimization_stats += mesh.stats;
+			lod_count += mesh.lods.size();
 
-			size_t total_indices = 0;
-			for (size_t i = 0; i < ai_mesh->mNumFaces; ++i) {
-				total_indices += ai_mesh->mFaces[i].mNumIndices;  // NOLINT(*pointer-arithmetic)
+			if (mesh.vertices.empty() && mesh.indices.empty() && state.maps[i].empty()) {
+				spdlog::warn("Wrong path");
 			}
+			meshes_data.emplace_back(std::move(mesh.vertices), std::move(mesh.indices), std::move(state.maps[i]), aabb_min,
+			                         aabb_max, std::move(mesh.lods), std::move(mesh.bvh));
+		}
 
-			std::vector<int> indices(total_indices);
-			parse_indices(ai_mesh, std::back_inserter(indices));
+		spdlog::info("Optimized {}: vertices {} -> {}, triangles {} -> {}, ACMR {:.3f} -> {:.3f}, {} KiB -> {} KiB", path,
+		             optimization_stats.vertices_before, optimization_stats.vertices_after,
+		             optimization_stats.triangles_before, optimization_stats.triangles_after,
+		             optimization_stats.acmr_before(), optimization_stats.acmr_after(),
+		             optimization_stats.bytes_before() / 1024, optimization_stats.bytes_after() / 1024);
+		spdlog::debug("Generated {} LOD levels for {} meshes of {}", lod_count, meshes_data.size(), path);
 
-			if (ai_mesh->mMaterialIndex >= 0) {
-				// if textures present
-				const auto* mat = scene->mMaterials[ai_mesh->mMaterialIndex]; // NOLINT(*pointer-arithmetic)
-				std::vector<raw_tex> raw_maps;
-				create_raw_maps(dir, mat, std::back_inserter(raw_maps));
-				if (vertices.empty() && indices.empty() && raw_maps.empty()) {
-					spdlog::warn("Wrong path");
-				}
-				meshes_data.emplace_back(std::move(vertices), std::move(indices), std::move(raw_maps), aabb_min, aabb_max);
+		// assimp scene is no longer needed, free it before writing cache and uploading
+		state.importer.FreeScene();
+		state.ai_meshes.clear();
 
-			} else {
-				meshes_data.emplace_back(std::move(vertices), std::move(indices), std::vector<raw_tex>{}, aabb_min, aabb_max);
-			}
-		}
+		const model_cache cache;
+		cache.store(path, IMPORT_FLAGS, meshes_data);
 
-		std::pair<std::string_view, raw_model_data> pair{ path, std::move(meshes_data) };
-		{
-			const std::lock_guard<std::mutex> lock(mut_);
-			raw_models_data_.emplace_back(std::move(pair));
-		}
+		publish(std::make_shared<model_data>(path, meshes_data.begin(), meshes_data.end()));
 	}
 
 } // namespace kanso
@@ -1,6 +1,7 @@
 #include "object_manager.hpp"
 #include "light.hpp"
 #include "model.hpp"
+#include "raycast.hpp"
 
 namespace kanso {
 
@@ -10,29 +11,63 @@ namespace kanso {
 	{
 		model_views_.reserve(models_.size());
 		for (const auto& model : models_) {
-			model_view const view{
-				model->id(),
-				model->name(),
-				{ model->pos()[0], model->pos()[1], model->pos()[2] },
-				{ model->rot()[0], model->pos()[1], model->pos()[2] },
-				{ model->scale()[0], model->scale()[1], model->scale()[2] },
-				model->type()
-			};
-			model_views_.emplace_back(view);
+			model_views_.emplace_back(make_view(*model));
 		}
 
+		proxies_.reserve(models_.size());
+		for (size_t i = 0; i < models_.size(); i++) {
+			track(i);
+		}
 	}
 
 	void object_manager::add_model(std::unique_ptr<model> model) {
-		model_view const view{
-			model->id(),
-			model->name(),
-			{ model->pos()[0], model->pos()[1], model->pos()[2] },
-			{ model->rot()[0], model->pos()[1], model->pos()[2] },
-			{ model->scale()[0], model->scale()[1], model->scale()[2] },
-			model->type()
-		};
-		model_views_.emplace_back(view);
+		model_views_.emplace_back(make_view(*model));
 		models_.emplace_back(std::move(model));
+		track(models_.size() - 1);
+	}
+
+	void object_manager::set_transform(size_t index, const glm::vec3& pos, const glm::vec3& scale,
+	                                   const glm::vec3& rot) {
+		if (!models_[index]->is_scene_model()) {
+			return;
+		}
+		static_cast<scene_model*>(models_[index].get())->set_transform(pos, scale, rot);
+		model_views_[index] = make_view(*models_[index]);
+		update_bounds(index);
+	}
+
+	void object_manager::update_bounds(size_t index) {
+		if (proxies_[index] == aabb_tree::NULL_NODE) {
+			return;
+		}
+		const auto* bounded = static_cast<const scene_model*>(models_[index].get());
+		bounds_.move(proxies_[index], bounded->aabb_min(), bounded->aabb_max());
+	}
+
+	std::shared_ptr<model> object_manager::pick(const raycast& ray) const {
+		// boxes only order candidates, a model is hit where the ray meets its triangles
+		const auto hit = bounds_.nearest_hit(ray, [this, &ray](uint32_t index, float box_distance) {
+			return static_cast<const scene_model*>(models_[index].get())->hit_distance(ray, box_distance);
+		});
+		return hit ? models_[hit->value] : nullptr;
+	}
+
+	void object_manager::track(size_t index) {
+		const auto& model = models_[index];
+		if (!model->is_scene_model()) {
+			proxies_.push_back(aabb_tree::NULL_NODE);
+			return;
+		}
+		const auto* bounded = static_cast<const scene_model*>(model.get());
+		proxies_.push_back(bounds_.insert(bounded->aabb_min(), bounded->aabb_max(), static_cast<uint32_t>(index)));
+	}
+
+	model_view object_manager::make_view(const model& model) {
+		return { model.id(),
+		         model.name(),
+		         { model.pos()[0], model.pos()[1], model.pos()[2] },
+		         { model.rot()[0], model.rot()[1], model.rot()[2] },
+		         { model.scale()[0], model.scale()[1], model.scale()[2] },
+		         model.type() };
 	}
 }
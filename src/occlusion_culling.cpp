@@ -0,0 +1,262 @@
+#include "occlusion_culling.hpp"
+#include "mesh.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KANSO_OCCLUSION_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace kanso {
+
+	namespace {
+
+		constexpr int SIMD_WIDTH = 4;
+
+		// rows rasterized by one job, bands never share pixels so jobs need no locking
+		constexpr int BAND_ROWS = 16;
+
+		// corners closer to camera plane than this are treated as crossing it
+		constexpr float MIN_CLIP_W = 1e-5f;
+
+		// twice the area in pixels below which triangles cover no pixel center worth writing
+		constexpr float MIN_AREA = 1e-6f;
+
+		// edge a -> b as plane, positive on its left
+		glm::vec3 edge(const glm::vec2& a, const glm::vec2& b) {
+			return { a.y - b.y, b.x - a.x, a.x * b.y - a.y * b.x };
+		}
+
+		float plane_at(const glm::vec3& plane, float x, float y) {
+			return plane.x * x + plane.y * y + plane.z;
+		}
+
+	} // namespace
+
+	occluder_mesh make_occluder(const std::vector<mesh>& meshes) {
+		occluder_mesh hull;
+		for (const auto& mesh : meshes) {
+			const auto& vertices = mesh.vertices();
+			const auto& indices  = mesh.indices(mesh.lod_count() - 1);
+
+			// only vertices the coarsest level still references are kept
+			std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+			for (const int index : indices) {
+				auto& slot = remap[static_cast<size_t>(index)];
+				if (slot == UINT32_MAX) {
+					slot = static_cast<uint32_t>(hull.vertices.size());
+					hull.vertices.push_back(vertices[static_cast<size_t>(index)].pos);
+				}
+				hull.indices.push_back(slot);
+			}
+		}
+		return hull;
+	}
+
+	occlusion_buffer::occlusion_buffer(int width, int height)
+	    : width_((std::max(width, 1) + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH),
+	      height_(std::max(height, 1)),
+	      depth_(static_cast<size_t>(width_) * static_cast<size_t>(height_), 1.0f) {}
+
+	void occlusion_buffer::begin(const glm::mat4& view_proj) {
+		view_proj_ = view_proj;
+		std::fill(depth_.begin(), depth_.end(), 1.0f);
+		occluders_.clear();
+		triangles_.clear();
+		stats_ = {};
+	}
+
+	void occlusion_buffer::add_occluder(const occluder_mesh& mesh, const glm::mat4& model) {
+		occluders_.push_back({ &mesh, view_proj_ * model, triangles_.size() });
+		triangles_.resize(triangles_.size() + mesh.indices.size() / 3);
+		stats_.occluders++;
+	}
+
+	void occlusion_buffer::render(thread_pool* pool) {
+		// every occluder writes its own slice of triangles_, every band its own rows of depth_
+		auto setup_occluders = [this](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++) {
+				setup(occluders_[i]);
+			}
+		};
+
+		auto rasterize_bands = [this](size_t first, size_t last) {
+			for (size_t band = first; band < last; band++) {
+				const int first_row = static_cast<int>(band) * BAND_ROWS;
+				const int last_row  = std::min(first_row + BAND_ROWS, height_);
+				for (const auto& triangle : triangles_) {
+					if (triangle.min_x <= triangle.max_x && triangle.min_y < last_row && triangle.max_y >= first_row) {
+						rasterize(triangle, first_row, last_row);
+					}
+				}
+			}
+		};
+
+		if (pool != nullptr) {
+			pool->parallel_for(occluders_.size(), 1, setup_occluders);
+		} else {
+			setup_occluders(0, occluders_.size());
+		}
+		stats_.triangles = static_cast<size_t>(std::count_if(triangles_.begin(), triangles_.end(), [](const auto& t) {
+			return t.min_x <= t.max_x;
+		}));
+		if (stats_.triangles == 0) {
+			return;
+		}
+
+		const auto bands = static_cast<size_t>((height_ + BAND_ROWS - 1) / BAND_ROWS);
+		if (pool != nullptr) {
+			pool->parallel_for(bands, 1, rasterize_bands);
+		} else {
+			rasterize_bands(0, bands);
+		}
+	}
+
+	void occlusion_buffer::setup(const queued_occluder& occluder) {
+		const auto& mesh = *occluder.mesh;
+		const auto  size = glm::vec2(static_cast<float>(width_), static_cast<float>(height_));
+		auto*       out  = &triangles_[occluder.first_triangle];
+
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+			auto& triangle = *out++; // NOLINT(*pointer-arithmetic)
+			triangle.min_x = 0;
+			triangle.max_x = -1;
+
+			std::array<glm::vec2, 3> screen{};
+			std::array<float, 3>     depth{};
+			bool                     clipped = false;
+			for (size_t corner = 0; corner < 3; corner++) {
+				const glm::vec4 clip = occluder.matrix * glm::vec4(mesh.vertices[mesh.indices[i + corner]], 1.0f);
+				// dropping triangles through camera plane only loses occlusion, never hides anything wrongly
+				clipped               = clipped || clip.w < MIN_CLIP_W;
+				const float inverse_w = 1.0f / std::max(clip.w, MIN_CLIP_W);
+				screen[corner]        = (glm::vec2(clip) * inverse_w * 0.5f + 0.5f) * size;
+				depth[corner]         = clip.z * inverse_w;
+			}
+			if (clipped) {
+				continue;
+			}
+
+			// pixel x is covered where its center x + 0.5 is inside
+			const glm::vec2 lower = glm::min(glm::min(screen[0], screen[1]), screen[2]);
+			const glm::vec2 upper = glm::max(glm::max(screen[0], screen[1]), screen[2]);
+			triangle.min_x        = std::max(static_cast<int>(std::ceil(lower.x - 0.5f)), 0);
+			triangle.max_x        = std::min(static_cast<int>(std::floor(upper.x - 0.5f)), width_ - 1);
+			triangle.min_y        = std::max(static_cast<int>(std::ceil(lower.y - 0.5f)), 0);
+			triangle.max_y        = std::min(static_cast<int>(std::floor(upper.y - 0.5f)), height_ - 1);
+
+			const glm::vec3 bc   = edge(screen[1], screen[2]);
+			const glm::vec3 ca   = edge(screen[2], screen[0]);
+			const glm::vec3 ab   = edge(screen[0], screen[1]);
+			const float     area = plane_at(ab, screen[2].x, screen[2].y);
+			if (std::abs(area) < MIN_AREA || triangle.min_y > triangle.max_y) {
+				triangle.max_x = -1;
+				continue;
+			}
+
+			// device depth is affine in screen space, weights of corners are edges over area. Both windings
+			// are kept, so open or one sided hulls occlude from either side
+			triangle.depth   = (bc * depth[0] + ca * depth[1] + ab * depth[2]) / area;
+			const float sign = area > 0.0f ? 1.0f : -1.0f;
+			triangle.edges   = { bc * sign, ca * sign, ab * sign };
+		}
+	}
+
+	void occlusion_buffer::rasterize(const raster_triangle& triangle, int first_row, int last_row) {
+		const auto& [e0, e1, e2] = triangle.edges;
+		const int   end_y        = std::min(triangle.max_y + 1, last_row);
+
+		for (int y = std::max(triangle.min_y, first_row); y < end_y; y++) {
+			const float py  = static_cast<float>(y) + 0.5f;
+			float*      row = &depth_[static_cast<size_t>(y) * static_cast<size_t>(width_)];
+#if defined(KANSO_OCCLUSION_SSE2)
+			const __m128 zero   = _mm_setzero_ps();
+			const __m128 offset = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+			const __m128 r0     = _mm_set1_ps(e0.y * py + e0.z);
+			const __m128 r1     = _mm_set1_ps(e1.y * py + e1.z);
+			const __m128 r2     = _mm_set1_ps(e2.y * py + e2.z);
+			const __m128 rz     = _mm_set1_ps(triangle.depth.y * py + triangle.depth.z);
+
+			// lanes left of min_x or right of max_x fail an edge test, width is a multiple of four
+			for (int x = triangle.min_x / SIMD_WIDTH * SIMD_WIDTH; x <= triangle.max_x; x += SIMD_WIDTH) {
+				const __m128 px     = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offset);
+				const __m128 w0     = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(e0.x)), r0);
+				const __m128 w1     = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(e1.x)), r1);
+				const __m128 w2     = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(e2.x)), r2);
+				const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)),
+				                                 _mm_cmpge_ps(w2, zero));
+				const __m128 z      = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(triangle.depth.x)), rz);
+				const __m128 old    = _mm_loadu_ps(row + x); // NOLINT(*pointer-arithmetic)
+				const __m128 nearer = _mm_and_ps(inside, _mm_min_ps(old, z));
+				_mm_storeu_ps(row + x, _mm_or_ps(nearer, _mm_andnot_ps(inside, old))); // NOLINT(*pointer-arithmetic)
+			}
+#else
+			for (int x = triangle.min_x; x <= triangle.max_x; x++) {
+				const float px = static_cast<float>(x) + 0.5f;
+				if (plane_at(e0, px, py) >= 0.0f && plane_at(e1, px, py) >= 0.0f && plane_at(e2, px, py) >= 0.0f) {
+					row[x] = std::min(row[x], plane_at(triangle.depth, px, py)); // NOLINT(*pointer-arithmetic)
+				}
+			}
+#endif
+		}
+	}
+
+	bool occlusion_buffer::visible(const glm::vec3& min, const glm::vec3& max) const {
+		if (stats_.triangles == 0) {
+			return true;
+		}
+
+		const auto size    = glm::vec2(static_cast<float>(width_), static_cast<float>(height_));
+		glm::vec2  lower   = size;
+		glm::vec2  upper   = glm::vec2(0.0f);
+		float      nearest = 1.0f;
+		for (int corner = 0; corner < 8; corner++) {
+			const glm::vec3 point((corner & 1) != 0 ? max.x : min.x, (corner & 2) != 0 ? max.y : min.y,
+			                      (corner & 4) != 0 ? max.z : min.z);
+			const glm::vec4 clip = view_proj_ * glm::vec4(point, 1.0f);
+			// box reaches camera plane, camera may be inside it
+			if (clip.w < MIN_CLIP_W) {
+				return true;
+			}
+			const glm::vec2 screen = (glm::vec2(clip) / clip.w * 0.5f + 0.5f) * size;
+			lower                  = glm::min(lower, screen);
+			upper                  = glm::max(upper, screen);
+			nearest                = std::min(nearest, clip.z / clip.w);
+		}
+
+		// occluders cover pixels by their centers, so a silhouette edge may cut up to half a pixel off box
+		// unnoticed. Pixels box touches plus a ring of one more always hold a center on the open side of an edge,
+		// and one at least as far as every point of box along a sloped occluder. Off screen is frustum's business
+		const int min_x = std::max(static_cast<int>(std::floor(lower.x)) - 1, 0);
+		const int max_x = std::min(static_cast<int>(std::floor(upper.x)) + 1, width_ - 1);
+		const int min_y = std::max(static_cast<int>(std::floor(lower.y)) - 1, 0);
+		const int max_y = std::min(static_cast<int>(std::floor(upper.y)) + 1, height_ - 1);
+		if (min_x > max_x || min_y > max_y) {
+			return true;
+		}
+
+		for (int y = min_y; y <= max_y; y++) {
+			const float* row = &depth_[static_cast<size_t>(y) * static_cast<size_t>(width_)];
+#if defined(KANSO_OCCLUSION_SSE2)
+			// extra pixels of outer groups only make test stricter
+			const __m128 box_depth = _mm_set1_ps(nearest);
+			for (int x = min_x / SIMD_WIDTH * SIMD_WIDTH; x <= max_x; x += SIMD_WIDTH) {
+				if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), box_depth)) != 0) { // NOLINT(*pointer-arithmetic)
+					return true;
+				}
+			}
+#else
+			for (int x = min_x; x <= max_x; x++) {
+				if (row[x] >= nearest) { // NOLINT(*pointer-arithmetic)
+					return true;
+				}
+			}
+#endif
+		}
+		return false;
+	}
+
+} // namespace kanso
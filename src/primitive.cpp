@@ -11,6 +11,14 @@ namespace kanso {
 		renderer_->draw_line();
 	}
 
+	void line::enqueue(render_queue& queue, frustum_culler& culler, const glm::mat4& proj,
+	                   const glm::vec3& camera_pos) const {
+		(void)culler;
+		(void)proj;
+		(void)camera_pos;
+		queue.push_custom(render_pass::opaque, 0, *this, 0.0f);
+	}
+
 	line::line(const glm::vec3& start, const glm::vec3& end, std::string_view vert_file, std::string_view frag_file)
 	    : model(vert_file, frag_file), renderer_(renderer_factory::make_renderer(start, end)), start_(start) {}
 
@@ -1,19 +1,26 @@
 #include "raycast.hpp"
 
+#include <limits>
+
 namespace kanso {
 	raycast::raycast(const glm::vec3& origin, const glm::vec3& direction)
 	    : ray_origin_(origin),
-	      ray_direction_(direction) {}
+	      ray_direction_(direction),
+	      inv_direction_(1.0f / direction) {}
 
 	raycast::raycast(float mouse_x, float mouse_y, int screen_width, int screen_height, const glm::mat4& view,
 	                 const glm::mat4& proj) {
 		std::tie(ray_origin_, ray_direction_) = world_dir(mouse_x, mouse_y, screen_width, screen_height, view, proj);
+		inv_direction_                        = 1.0f / ray_direction_;
 	}
 
 	bool raycast::is_intersects(const glm::vec3& aabb_min, const glm::vec3& aabb_max) const {
-		const glm::vec3 inv_dir = 1.0f / ray_direction_;
-		const glm::vec3 t_min   = (aabb_min - ray_origin_) * inv_dir;
-		const glm::vec3 t_max   = (aabb_max - ray_origin_) * inv_dir;
+		return entry_distance(aabb_min, aabb_max) != std::numeric_limits<float>::infinity();
+	}
+
+	float raycast::entry_distance(const glm::vec3& aabb_min, const glm::vec3& aabb_max) const {
+		const glm::vec3 t_min = (aabb_min - ray_origin_) * inv_direction_;
+		const glm::vec3 t_max = (aabb_max - ray_origin_) * inv_direction_;
 
 		const glm::vec3 t1 = glm::min(t_min, t_max);
 		const glm::vec3 t2 = glm::max(t_min, t_max);
@@ -23,7 +30,10 @@ namespace kanso {
 		const float t_exit  = std::min(std::min(t2.x, t2.y), t2.z);
 		// NOLINTEND(*union-access)
 
-		return t_entry <= t_exit && t_exit >= 0.0f;
+		if (!(t_entry <= t_exit && t_exit >= 0.0f)) {
+			return std::numeric_limits<float>::infinity();
+		}
+		return std::max(t_entry, 0.0f);
 	}
 
 	std::pair<glm::vec3, glm::vec3> raycast::world_dir(float mouse_x, float mouse_y, int screen_width,
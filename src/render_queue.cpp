@@ -0,0 +1,420 @@
+#include "render_queue.hpp"
+#include "mesh.hpp"
+#include "model.hpp"
+#include "shader_cache.hpp"
+#include "glad/glad.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+namespace kanso {
+
+	namespace {
+
+		constexpr int PROGRAM_BITS  = 10;
+		constexpr int MATERIAL_BITS = 14;
+		constexpr int VAO_BITS      = 14;
+		constexpr int LOD_BITS      = 4;
+		constexpr int DEPTH_BITS    = 20;
+
+		constexpr int LOD_SHIFT      = DEPTH_BITS;
+		constexpr int VAO_SHIFT      = LOD_SHIFT + LOD_BITS;
+		constexpr int MATERIAL_SHIFT = VAO_SHIFT + VAO_BITS;
+		constexpr int PROGRAM_SHIFT  = MATERIAL_SHIFT + MATERIAL_BITS;
+		constexpr int PASS_SHIFT     = PROGRAM_SHIFT + PROGRAM_BITS;
+
+		static_assert(PASS_SHIFT + 2 == 64, "sort key fields must fill 64 bits");
+
+		constexpr uint64_t field(uint64_t value, int bits, int shift) {
+			return (value & ((uint64_t{ 1 } << bits) - 1)) << shift;
+		}
+
+		// bits of non negative float order like the float itself, top ones below sign keep that order
+		uint64_t depth_bits(float depth) {
+			return std::bit_cast<uint32_t>(std::max(depth, 0.0f)) >> (31 - DEPTH_BITS);
+		}
+
+		constexpr int    RADIX_BITS = 8;
+		constexpr size_t BUCKETS    = size_t{ 1 } << RADIX_BITS;
+
+		// per frame data of a scene with a few thousand draws fits without growing
+		constexpr size_t INITIAL_FRAME_DATA = size_t{ 1 } << 20;
+
+		// corners of box as bits of index, x in bit 0, y in bit 1 and z in bit 2
+		constexpr std::array<std::pair<size_t, size_t>, 12> BOX_EDGES = { {
+		    { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, // along x
+		    { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 }, // along y
+		    { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }, // along z
+		} };
+
+	} // namespace
+
+	uint64_t make_sort_key(render_pass pass, uint program, uint material, uint vertex_array, size_t lod,
+	                       float depth) {
+		return field(static_cast<uint64_t>(pass), 2, PASS_SHIFT) | field(program, PROGRAM_BITS, PROGRAM_SHIFT) |
+		       field(material, MATERIAL_BITS, MATERIAL_SHIFT) | field(vertex_array, VAO_BITS, VAO_SHIFT) |
+		       field(lod, LOD_BITS, LOD_SHIFT) | depth_bits(depth);
+	}
+
+	void radix_sort(std::vector<sort_item>& items, std::vector<sort_item>& scratch) {
+		scratch.resize(items.size());
+
+		// histograms of every digit in one read of keys
+		std::array<std::array<size_t, BUCKETS>, 64 / RADIX_BITS> counts{};
+		for (const auto& item : items) {
+			for (size_t digit = 0; digit < counts.size(); digit++) {
+				counts[digit][(item.key >> (digit * RADIX_BITS)) & (BUCKETS - 1)]++;
+			}
+		}
+
+		for (size_t digit = 0; digit < counts.size(); digit++) {
+			auto& count = counts[digit];
+			// whole queue in one bucket, order would not change
+			if (std::find(count.begin(), count.end(), items.size()) != count.end()) {
+				continue;
+			}
+
+			size_t offset = 0;
+			for (auto& bucket : count) {
+				offset += std::exchange(bucket, offset);
+			}
+			const auto shift = digit * RADIX_BITS;
+			for (const auto& item : items) {
+				scratch[count[(item.key >> shift) & (BUCKETS - 1)]++] = item;
+			}
+			items.swap(scratch);
+		}
+	}
+
+	render_queue::program_uniforms::program_uniforms(uint program)
+	    : shininess(shader::find_uniform<float>(program, "material.shininess")) {}
+
+	render_queue::render_queue()
+	    : state_(renderer_factory::make_renderer()),
+	      ring_(INITIAL_FRAME_DATA),
+	      // GL 4.1 has neither, commands without base instance could not address their slice of instance buffer
+	      multi_draw_(GLAD_GL_ARB_multi_draw_indirect != 0 && GLAD_GL_ARB_base_instance != 0) {
+		glGenVertexArrays(1, &line_vao_);
+		glBindVertexArray(line_vao_);
+		glEnableVertexAttribArray(0);
+		glBindVertexArray(0);
+
+		GLint alignment = 0;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		uniform_alignment_ = std::bit_ceil(static_cast<size_t>(std::max(alignment, 1)));
+
+		// culled instances are only ever drawn through indirect commands
+		if (multi_draw_ && gpu_culler::supported()) {
+			try {
+				gpu_culler_ = std::make_unique<gpu_culler>();
+			} catch (const exception::base_kanso_exception& e) {
+				spdlog::warn("GPU culling disabled, culling shaders failed: {}", e.what());
+			}
+		}
+	}
+
+	render_queue::~render_queue() {
+		glDeleteVertexArrays(1, &line_vao_);
+	}
+
+	void render_queue::clear() {
+		packets_.clear();
+		items_.clear();
+		line_vertices_.clear();
+		custom_packets_ = 0;
+	}
+
+	void render_queue::push(render_pass pass, uint program, mesh& mesh, size_t lod, const glm::mat4& model, float depth,
+	                        const glm::vec3& box_min, const glm::vec3& box_max) {
+		auto& geometry = mesh.geometry();
+		items_.push_back({ make_sort_key(pass, program, mesh.maps().sort_id(), geometry.vertex_array(), lod, depth),
+		                   static_cast<uint32_t>(packets_.size()) });
+		packets_.push_back({ pass, program, &mesh.maps(), &geometry, nullptr, model, mesh.first_index(lod),
+		                     mesh.index_count(lod), box_min, box_max });
+	}
+
+	void render_queue::push_custom(render_pass pass, uint program, const immediate_drawable& drawable, float depth) {
+		items_.push_back({ make_sort_key(pass, program, 0, 0, 0, depth), static_cast<uint32_t>(packets_.size()) });
+		packets_.push_back({ pass, program, nullptr, nullptr, &drawable, glm::mat4{ 1.0f }, 0, 0, {}, {} });
+		custom_packets_++;
+	}
+
+	void render_queue::push_box(const glm::mat4& model, const glm::vec3& box_min, const glm::vec3& box_max) {
+		std::array<glm::vec3, 8> corners{};
+		for (size_t i = 0; i < corners.size(); i++) {
+			const glm::vec3 corner{ (i & 1) != 0 ? box_max.x : box_min.x, (i & 2) != 0 ? box_max.y : box_min.y,
+			                        (i & 4) != 0 ? box_max.z : box_min.z };
+			corners[i] = glm::vec3(model * glm::vec4(corner, 1.0f));
+		}
+		for (const auto& [from, to] : BOX_EDGES) {
+			line_vertices_.push_back(corners[from]);
+			line_vertices_.push_back(corners[to]);
+		}
+	}
+
+	render_queue::program_uniforms& render_queue::uniforms_for(uint program) {
+		auto it = uniforms_.find(program);
+		if (it == uniforms_.end()) {
+			it = uniforms_.emplace(program, program_uniforms{ program }).first;
+		}
+		return it->second;
+	}
+
+	void render_queue::apply_pass(render_pass pass) {
+		if (pass == render_pass::outline) {
+			state_->enable_stencil_test();
+		} else {
+			state_->reset_stencil_test();
+		}
+	}
+
+	void render_queue::build_batches() {
+		batches_.clear();
+		uint32_t instances = 0;
+		for (uint32_t i = 0; i < items_.size(); i++) {
+			const auto& packet = packets_[items_[i].packet];
+			const bool  joins  = !batches_.empty() &&
+			                     packet.instances_with(packets_[items_[batches_.back().first_item].packet]);
+			if (joins) {
+				batches_.back().item_count++;
+			} else {
+				batches_.push_back({ i, 1, instances });
+			}
+			if (packet.custom == nullptr) {
+				instances++;
+			}
+		}
+	}
+
+	bool render_queue::write_frame_data(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camera_pos) {
+		const size_t instance_count = packets_.size() - custom_packets_;
+		const size_t command_count  = multi_draw_ ? batches_.size() : 0;
+		// culling pass reads instances and commands as storage buffers, which have an alignment of their own
+		const bool   gpu_culling    = gpu_culler_ != nullptr;
+		const size_t storage_align  = gpu_culling ? gpu_culler_->storage_alignment() : alignof(indirect_command);
+		const size_t instance_align = std::max(storage_align, alignof(glm::vec4));
+		const size_t params_size    = gpu_culling ? sizeof(gpu_culler::cull_params) : 0;
+		const size_t bounds_size    = gpu_culling ? instance_count * sizeof(gpu_culler::instance_bounds) : 0;
+		const size_t lines_size     = line_vertices_.size() * sizeof(glm::vec3);
+		// alignment padding of every allocation counted in full
+		ring_.begin_frame(uniform_alignment_ + sizeof(camera_block) + instance_align +
+		                  instance_count * sizeof(instance_data) + storage_align +
+		                  command_count * sizeof(indirect_command) + uniform_alignment_ + params_size +
+		                  storage_align + bounds_size + alignof(glm::vec4) + lines_size);
+
+		const auto camera    = ring_.allocate(sizeof(camera_block), uniform_alignment_);
+		const auto instances = ring_.allocate(instance_count * sizeof(instance_data), instance_align);
+		const auto commands  = ring_.allocate(command_count * sizeof(indirect_command), storage_align);
+		const auto params    = ring_.allocate(params_size, uniform_alignment_);
+		const auto bounds    = ring_.allocate(bounds_size, storage_align);
+		const auto lines     = ring_.allocate(lines_size, alignof(glm::vec4));
+		if (camera.data == nullptr || instances.data == nullptr || commands.data == nullptr ||
+		    params.data == nullptr || bounds.data == nullptr || lines.data == nullptr) {
+			spdlog::error("Could not map {} draws of frame for writing, frame is skipped", packets_.size());
+			ring_.end_frame();
+			return false;
+		}
+		camera_offset_   = camera.offset;
+		instance_offset_ = instances.offset;
+		command_offset_  = commands.offset;
+		params_offset_   = params.offset;
+		bounds_offset_   = bounds.offset;
+		lines_offset_    = lines.offset;
+
+		// mapped memory may be write combined, so it is only ever written front to back and never read
+		const camera_block block{ view, proj, glm::vec4(camera_pos, 1.0f) };
+		std::memcpy(camera.data, &block, sizeof(block));
+		if (gpu_culling) {
+			const auto cull_params = gpu_culler_->params(view, proj, instance_count);
+			std::memcpy(params.data, &cull_params, sizeof(cull_params));
+		}
+
+		// batches cover sorted items in order, so instances keep their order and each knows its command
+		size_t written = 0;
+		for (uint32_t b = 0; b < batches_.size(); b++) {
+			const auto& batch = batches_[b];
+			for (uint32_t i = batch.first_item; i < batch.first_item + batch.item_count; i++) {
+				const auto& packet = packets_[items_[i].packet];
+				if (packet.custom != nullptr) {
+					continue;
+				}
+				const auto          layout  = packet.geometry->layout();
+				const float         compact = layout.format == vertex_format::compact ? 1.0f : 0.0f;
+				const instance_data instance{ packet.model, glm::transpose(glm::inverse(glm::mat3(packet.model))),
+				                              glm::vec4(layout.offset, compact), layout.scale };
+				std::memcpy(instances.data + written * sizeof(instance_data), &instance, sizeof(instance)); // NOLINT(*pointer-arithmetic)
+				if (gpu_culling) {
+					const gpu_culler::instance_bounds box{ packet.box_min, b, packet.box_max, 0 };
+					std::memcpy(bounds.data + written * sizeof(box), &box, sizeof(box)); // NOLINT(*pointer-arithmetic)
+				}
+				written++;
+			}
+		}
+
+		// culled commands start empty, culling pass counts their surviving instances
+		for (size_t i = 0; i < command_count; i++) {
+			const auto&      batch  = batches_[i];
+			const auto&      packet = packets_[items_[batch.first_item].packet];
+			indirect_command command{};
+			if (packet.custom == nullptr) {
+				command = { static_cast<uint32_t>(packet.index_count), gpu_culling ? 0U : batch.item_count,
+				            static_cast<uint32_t>(packet.geometry->base_index() + packet.first_index),
+				            packet.geometry->base_vertex(), batch.first_instance };
+			}
+			std::memcpy(commands.data + i * sizeof(indirect_command), &command, sizeof(command)); // NOLINT(*pointer-arithmetic)
+		}
+
+		if (lines_size > 0) {
+			std::memcpy(lines.data, line_vertices_.data(), lines_size);
+		}
+
+		ring_.flush();
+		return true;
+	}
+
+	bool render_queue::shares_state(const draw_batch& a, const draw_batch& b) const {
+		const auto& first = packets_[items_[a.first_item].packet];
+		const auto& other = packets_[items_[b.first_item].packet];
+		return first.custom == nullptr && other.custom == nullptr && first.pass == other.pass &&
+		       first.program == other.program && first.geometry->vertex_array() == other.geometry->vertex_array() &&
+		       (first.maps == other.maps || first.maps->same_maps(*other.maps));
+	}
+
+	void render_queue::draw_lines(uint buffer) {
+		if (line_vertices_.empty()) {
+			return;
+		}
+		if (line_program_ == 0) {
+			line_program_ = shader_cache::instance().program("debug_line").id();
+		}
+
+		// vertices are in world space, Camera block bound for packets places them
+		apply_pass(render_pass::overlay);
+		shader::use(line_program_);
+		glBindVertexArray(line_vao_);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
+		                      reinterpret_cast<const void*>(lines_offset_)); // NOLINT(*reinterpret-cast,*int-to-ptr)
+		glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(line_vertices_.size()));
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		draw_calls_++;
+	}
+
+	void render_queue::submit(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camera_pos) {
+		radix_sort(items_, scratch_);
+		build_batches();
+		draw_calls_ = 0;
+		if (!write_frame_data(view, proj, camera_pos)) {
+			return;
+		}
+		const uint buffer = ring_.buffer();
+
+		// surviving instances are packed into culler's own buffer, commands then address it from its start
+		uint   instance_buffer = buffer;
+		size_t instance_base   = instance_offset_;
+		if (gpu_culler_ != nullptr) {
+			gpu_culler_->cull({ buffer, params_offset_, bounds_offset_, instance_offset_, command_offset_,
+			                    packets_.size() - custom_packets_, batches_.size() });
+			instance_buffer = gpu_culler_->instance_buffer();
+			instance_base   = 0;
+		}
+
+		glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, buffer, static_cast<GLintptr>(camera_offset_),
+		                  sizeof(camera_block));
+		if (multi_draw_) {
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+		}
+
+		// state left by previous batch, reset whenever custom packet may have changed it behind queue's back
+		auto           pass         = render_pass::opaque;
+		uint           program      = 0;
+		const texture* maps         = nullptr;
+		uint           vertex_array = 0;
+		apply_pass(pass);
+
+		for (size_t i = 0; i < batches_.size();) {
+			const auto& batch  = batches_[i];
+			const auto& packet = packets_[items_[batch.first_item].packet];
+			if (packet.pass != pass) {
+				pass = packet.pass;
+				apply_pass(pass);
+			}
+
+			if (packet.custom != nullptr) {
+				packet.custom->draw(view, proj, camera_pos);
+				program      = 0;
+				maps         = nullptr;
+				vertex_array = 0;
+				draw_calls_++;
+				i++;
+				continue;
+			}
+
+			if (packet.program != program) {
+				program = packet.program;
+				maps    = nullptr;
+				shader::use(program);
+
+				// camera comes from Camera block, everything else stays in program once set
+				auto& uniforms = uniforms_for(program);
+				if (!uniforms.set) {
+					uniforms.set = true;
+					uniforms.shininess.set(32.0f);
+				}
+			}
+
+			// meshes sharing images have their own texture objects, so maps are compared by content
+			if (maps == nullptr || (packet.maps != maps && !packet.maps->same_maps(*maps))) {
+				maps = packet.maps;
+				maps->bind(program);
+			}
+
+			const bool new_vertex_array = packet.geometry->vertex_array() != vertex_array;
+			if (new_vertex_array) {
+				vertex_array = packet.geometry->vertex_array();
+				packet.geometry->bind();
+			}
+
+			if (!multi_draw_) {
+				packet.geometry->bind_instances(buffer,
+				                                instance_offset_ + batch.first_instance * sizeof(instance_data));
+				packet.geometry->draw_bound_instanced(packet.first_index, packet.index_count, batch.item_count);
+				draw_calls_++;
+				i++;
+				continue;
+			}
+
+			// commands address instances through base instance, so attributes point at first instance of frame
+			if (new_vertex_array) {
+				packet.geometry->bind_instances(instance_buffer, instance_base);
+			}
+			size_t last = i + 1;
+			while (last < batches_.size() && shares_state(batch, batches_[last])) {
+				last++;
+			}
+			glMultiDrawElementsIndirect(GL_TRIANGLES, packet.geometry->index_type(),
+			                            reinterpret_cast<const void*>(command_offset_ + i * sizeof(indirect_command)), // NOLINT(*reinterpret-cast,*int-to-ptr)
+			                            static_cast<GLsizei>(last - i), 0);
+			draw_calls_++;
+			i = last;
+		}
+
+		if (multi_draw_) {
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		}
+		draw_lines(buffer);
+		state_->unbind();
+		state_->reset_stencil_test();
+		// depth of this frame is what next frame's culling tests against
+		if (gpu_culler_ != nullptr) {
+			gpu_culler_->build_pyramid(view, proj);
+		}
+		ring_.end_frame();
+	}
+
+} // namespace kanso
@@ -1,9 +1,14 @@
 #include "renderer.hpp"
 #include "glad/glad.h"
 #include "shader.hpp"
+#include "vertex_compression.hpp"
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
 #include <string>
 
 namespace kanso {
@@ -22,6 +27,30 @@ namespace kanso {
 		}
 	} // namespace
 
+	void set_vertex_attributes(vertex_format format) {
+		if (format == vertex_format::compact) {
+			// normalized integers are expanded to [0, 1] and [-1, 1], shaders apply layout and decode normal
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(compact_vertex),
+			                      (void*)offsetof(compact_vertex, pos)); // NOLINT
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(compact_vertex),
+			                      (void*)offsetof(compact_vertex, normal)); // NOLINT
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(compact_vertex),
+			                      (void*)offsetof(compact_vertex, tex_coords)); // NOLINT
+		} else {
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex), static_cast<void*>(nullptr));
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex),
+			                      (void*)offsetof(mesh_vertex, normal)); // NOLINT
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex),
+			                      (void*)offsetof(mesh_vertex, tex_coords)); // NOLINT
+		}
+	}
+
 	opengl_renderer::opengl_renderer(const glm::vec3& start, const glm::vec3& end) : vao_(gen_vao()), vbo_(gen_buf()) {
 		glBindVertexArray(vao_);
 		glBindBuffer(GL_ARRAY_BUFFER, vbo_);
@@ -32,7 +61,8 @@ namespace kanso {
 		glEnableVertexAttribArray(0);
 	}
 
-	opengl_renderer::opengl_renderer(const std::vector<mesh_vertex>& vertices, const std::vector<int>& indices)
+	opengl_renderer::opengl_renderer(const std::vector<mesh_vertex>& vertices, const std::vector<int>& indices,
+	                                 vertex_format format)
 	    : vao_(gen_vao()),
 	      vbo_(gen_buf()),
 	      ebo_(gen_buf()),
@@ -40,21 +70,30 @@ namespace kanso {
 		glBindVertexArray(vao_);
 		glBindBuffer(GL_ARRAY_BUFFER, vbo_);
 
-		glBufferData(GL_ARRAY_BUFFER, static_cast<int>(vertices.size() * sizeof(mesh_vertex)), vertices.data(),
-		             GL_STATIC_DRAW);
+		if (format == vertex_format::compact) {
+			layout_           = make_compact_layout(vertices);
+			const auto packed = pack_vertices(vertices, layout_);
+			glBufferData(GL_ARRAY_BUFFER, static_cast<int>(packed.size() * sizeof(compact_vertex)), packed.data(),
+			             GL_STATIC_DRAW);
+		} else {
+			glBufferData(GL_ARRAY_BUFFER, static_cast<int>(vertices.size() * sizeof(mesh_vertex)), vertices.data(),
+			             GL_STATIC_DRAW);
+		}
+		set_vertex_attributes(format);
 
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<int>(indices.size() * sizeof(int)), indices.data(),
-		             GL_STATIC_DRAW);
-
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex), static_cast<void*>(nullptr));
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex),
-		                      (void*)offsetof(mesh_vertex, normal)); // NOLINT
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex),
-		                      (void*)offsetof(mesh_vertex, tex_coords)); // NOLINT
+		if (fits_short_indices(vertices.size())) {
+			index_type_ = GL_UNSIGNED_SHORT;
+			std::vector<uint16_t> short_indices(indices.size());
+			std::transform(indices.begin(), indices.end(), short_indices.begin(),
+			               [](int index) { return static_cast<uint16_t>(index); });
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<int>(short_indices.size() * sizeof(uint16_t)),
+			             short_indices.data(), GL_STATIC_DRAW);
+		} else {
+			index_type_ = GL_UNSIGNED_INT;
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<int>(indices.size() * sizeof(int)), indices.data(),
+			             GL_STATIC_DRAW);
+		}
 
 		glBindVertexArray(0);
 	}
@@ -66,13 +105,82 @@ namespace kanso {
 	}
 
 	void opengl_renderer::draw_triangles() {
+		draw_triangles(0, static_cast<size_t>(indices_count_));
+	}
+
+	void opengl_renderer::draw_triangles(size_t first_index, size_t index_count) {
+		bind();
+		draw_bound(first_index, index_count);
+		unbind();
+	}
+
+	void opengl_renderer::bind() {
 		glBindVertexArray(vao_);
-		glDrawElements(GL_TRIANGLES, indices_count_, GL_UNSIGNED_INT, nullptr);
+	}
+
+	void opengl_renderer::draw_bound(size_t first_index, size_t index_count) {
+		const size_t index_size = index_type_ == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+		glDrawElements(GL_TRIANGLES, static_cast<int>(index_count), index_type_,
+		               reinterpret_cast<const void*>(first_index * index_size)); // NOLINT(*reinterpret-cast,*int-to-ptr)
+	}
 
+	void opengl_renderer::bind_instances(uint buffer, size_t offset) {
+		// without base instance, batches select their slice of buffer through attribute offsets
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		for (uint column = 0; column < 4; column++) {
+			const size_t column_offset = offset + offsetof(instance_data, model) + column * sizeof(glm::vec4);
+			glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + column);
+			glVertexAttribPointer(INSTANCE_MODEL_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(instance_data),
+			                      reinterpret_cast<const void*>(column_offset)); // NOLINT(*reinterpret-cast,*int-to-ptr)
+			glVertexAttribDivisor(INSTANCE_MODEL_LOCATION + column, 1);
+		}
+		for (uint column = 0; column < 3; column++) {
+			const size_t column_offset = offset + offsetof(instance_data, normal) + column * sizeof(glm::vec3);
+			glEnableVertexAttribArray(INSTANCE_NORMAL_LOCATION + column);
+			glVertexAttribPointer(INSTANCE_NORMAL_LOCATION + column, 3, GL_FLOAT, GL_FALSE, sizeof(instance_data),
+			                      reinterpret_cast<const void*>(column_offset)); // NOLINT(*reinterpret-cast,*int-to-ptr)
+			glVertexAttribDivisor(INSTANCE_NORMAL_LOCATION + column, 1);
+		}
+
+		glEnableVertexAttribArray(INSTANCE_OFFSET_LOCATION);
+		glVertexAttribPointer(INSTANCE_OFFSET_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(instance_data),
+		                      reinterpret_cast<const void*>(offset + offsetof(instance_data, vertex_offset))); // NOLINT(*reinterpret-cast,*int-to-ptr)
+		glVertexAttribDivisor(INSTANCE_OFFSET_LOCATION, 1);
+		glEnableVertexAttribArray(INSTANCE_SCALE_LOCATION);
+		glVertexAttribPointer(INSTANCE_SCALE_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(instance_data),
+		                      reinterpret_cast<const void*>(offset + offsetof(instance_data, vertex_scale))); // NOLINT(*reinterpret-cast,*int-to-ptr)
+		glVertexAttribDivisor(INSTANCE_SCALE_LOCATION, 1);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	void opengl_renderer::draw_bound_instanced(size_t first_index, size_t index_count, size_t instances) {
+		const size_t index_size = index_type_ == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+		glDrawElementsInstanced(GL_TRIANGLES, static_cast<int>(index_count), index_type_,
+		                        reinterpret_cast<const void*>(first_index * index_size), // NOLINT(*reinterpret-cast,*int-to-ptr)
+		                        static_cast<int>(instances));
+	}
+
+	void opengl_renderer::unbind() {
 		glBindVertexArray(0);
 		glActiveTexture(GL_TEXTURE0);
 	}
 
+	uint opengl_renderer::vertex_array() const {
+		return vao_;
+	}
+
+	size_t opengl_renderer::base_index() const {
+		return 0;
+	}
+
+	int opengl_renderer::base_vertex() const {
+		return 0;
+	}
+
+	uint opengl_renderer::index_type() const {
+		return index_type_;
+	}
+
 	void opengl_renderer::draw_line() {
 		glEnableVertexAttribArray(0);
 		glBindVertexArray(vao_);
@@ -80,24 +188,84 @@ namespace kanso {
 		glBindVertexArray(0);
 	}
 
-	uint opengl_renderer::load_texture(uint8_t* bytes, int nr_channels, int width, int height) {
-		if (bytes == nullptr) {
-			throw std::invalid_argument("Texture binary data is nullptr");
+	uint opengl_renderer::load_texture(const std::vector<rgba_image>& levels) {
+		if (levels.empty() || levels.front().pixels.empty()) {
+			throw std::invalid_argument("Texture binary data is empty");
 		}
 
-		GLenum format{};
-		switch (nr_channels) {
-			case 1:
-				format = GL_RED;
+		uint texture_id{};
+		glGenTextures(1, &texture_id);
+		glBindTexture(GL_TEXTURE_2D, texture_id);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<int>(levels.size()) - 1);
+
+		// levels are RGBA8 with mip chain built by import workers, so driver neither converts nor filters here
+		size_t size = 0;
+		for (const auto& level : levels) {
+			size += level.pixels.size();
+		}
+
+		// copy through pixel unpack buffer so transfer to texture memory runs asynchronously to this thread
+		uint pbo = gen_buf();
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+		auto* staging = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size),
+		                                                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+		if (staging != nullptr) {
+			size_t offset = 0;
+			for (const auto& level : levels) {
+				std::memcpy(staging + offset, level.pixels.data(), level.pixels.size()); // NOLINT(*pointer-arithmetic)
+				offset += level.pixels.size();
+			}
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		} else {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+
+		size_t offset = 0;
+		for (size_t level = 0; level < levels.size(); level++) {
+			const auto& image  = levels[level];
+			const void* pixels = staging != nullptr ? reinterpret_cast<const void*>(offset) // NOLINT(*reinterpret-cast, *int-to-ptr)
+			                                        : static_cast<const void*>(image.pixels.data());
+			glTexImage2D(GL_TEXTURE_2D, static_cast<int>(level), GL_RGBA8, image.width, image.height, 0, GL_RGBA,
+			             GL_UNSIGNED_BYTE, pixels);
+			offset += image.pixels.size();
+		}
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glDeleteBuffers(1, &pbo);
+
+		return texture_id;
+	}
+
+	uint opengl_renderer::load_compressed_texture(const compressed_texture& texture) {
+		if (texture.levels.empty()) {
+			throw std::invalid_argument("Compressed texture has no levels");
+		}
+
+		GLenum internal_format{};
+		switch (texture.format) {
+			case block_format::bc1:
+				internal_format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+				break;
+			case block_format::bc3:
+				internal_format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+				break;
+			case block_format::bc4:
+				internal_format = GL_COMPRESSED_RED_RGTC1;
 				break;
-			case 3:
-				format = GL_RGB;
+			case block_format::bc5:
+				internal_format = GL_COMPRESSED_RG_RGTC2;
 				break;
-			case 4:
-				format = GL_RGBA;
+			case block_format::bc7:
+				internal_format = GL_COMPRESSED_RGBA_BPTC_UNORM_ARB;
 				break;
-			default:
-				throw std::invalid_argument("Wrong texture format");
 		}
 
 		uint texture_id{};
@@ -109,31 +277,62 @@ namespace kanso {
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<int>(texture.levels.size()) - 1);
 
-		glTexImage2D(GL_TEXTURE_2D, 0, static_cast<int>(format), width, height, 0, format, GL_UNSIGNED_BYTE, bytes);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		if (texture.nr_channels == 2) {
+			// grey and alpha are cooked into red and green
+			const std::array<int, 4> swizzle{ GL_RED, GL_RED, GL_RED, GL_GREEN };
+			glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle.data());
+		}
+
+		// mip chain is prebuilt, so no glGenerateMipmap here
+		for (size_t level = 0; level < texture.levels.size(); level++) {
+			const int width  = std::max(texture.width >> level, 1);
+			const int height = std::max(texture.height >> level, 1);
+			glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<int>(level), internal_format, width, height, 0,
+			                       static_cast<int>(texture.levels[level].size()), texture.levels[level].data());
+		}
 
 		return texture_id;
 	}
 
+	bool opengl_renderer::supports_compression(block_format format) const {
+		switch (format) {
+			case block_format::bc1:
+			case block_format::bc3:
+				return GLAD_GL_EXT_texture_compression_s3tc != 0;
+			case block_format::bc4:
+			case block_format::bc5:
+				// RGTC is core since 3.0
+				return GLAD_GL_VERSION_3_0 != 0;
+			case block_format::bc7:
+				return GLAD_GL_ARB_texture_compression_bptc != 0;
+		}
+		return false;
+	}
+
 	void opengl_renderer::bind_texture(uint shader, const std::string& type, uint id, uint& diffuse_nr,
 	                                   uint& specular_nr, uint& height_nr, uint& normal_nr, uint& number, uint index) {
 		glActiveTexture(GL_TEXTURE0 + index);
-		auto name = type;
-		if (name == "texture_diffuse") {
+		if (type == "texture_diffuse") {
 			number = diffuse_nr++;
-		} else if (name == "texture_specular") {
+		} else if (type == "texture_specular") {
 			number = specular_nr++;
-		} else if (name == "texture_height") {
+		} else if (type == "texture_height") {
 			number = height_nr++;
-		} else if (name == "texture_normal") {
+		} else if (type == "texture_normal") {
 			number = normal_nr++;
 		} else {
-			spdlog::error("Unknown texture type {}", name);
+			spdlog::error("Unknown texture type {}", type);
 		}
 
-		name += std::to_string(number);
-		shader::set_uniform(shader, name, static_cast<int>(index));
+		// sampler name is type followed by number, hashed piece by piece instead of building the string
+		std::array<char, 16> digits{};
+		const char*          end  = std::to_chars(digits.data(), digits.data() + digits.size(), number).ptr;
+		const auto           hash = uniform_hash({ digits.data(), static_cast<size_t>(end - digits.data()) },
+		                                         uniform_hash(type));
+		shader::set_uniform(shader, uniform_name::from_hash(hash, type), static_cast<int>(index));
 		glBindTexture(GL_TEXTURE_2D, id);
 	}
 
@@ -169,4 +368,8 @@ namespace kanso {
 		glViewport(0, 0, width, height);
 	}
 
+	vertex_layout opengl_renderer::layout() const {
+		return layout_;
+	}
+
 } // namespace kanso
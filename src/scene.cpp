@@ -1,22 +1,78 @@
 #include "scene.hpp"
-#include "light.hpp"
 #include "model.hpp"
 
 namespace kanso {
 
-	scene::scene(std::shared_ptr<object_manager> manager)
-	    :  obj_manager_(std::move(manager)) {}
+	scene::scene(std::shared_ptr<object_manager> manager, thread_pool& pool)
+	    : obj_manager_(std::move(manager)),
+	      pool_(pool),
+	      lights_(pool_) {}
 
 	void scene::draw(const camera& camera, const window& window) {
 		auto view       = camera.view();
 		auto proj       = camera.proj(window);
 		auto camera_pos = camera.pos();
 
+		// lights are shared by every program and sorted into view clusters, so fragments only shade nearby ones
+		lights_.update(obj_manager_->lights(), view, proj, window.real_width(), window.real_height());
+
+		// models only describe their draws, queue orders them by state and depth before anything reaches GL
+		queue_.clear();
+		frustum_culler culler(view, proj, camera_pos, min_screen_size_);
+
+		// models with bounds are tested together, everything else is always drawn
+		model_boxes_.clear();
+		boxed_models_.clear();
 		for (auto model_it = obj_manager_->model_begin(), model_end = obj_manager_->model_end(); model_it != model_end; ++model_it) {
-			for (auto light_it = obj_manager_->light_begin(), light_end = obj_manager_->light_end(); light_it != light_end; ++light_it) {
-				light_it->get()->bind_to(model_it->get()->render_shader());
+			const auto& model = *model_it;
+			if (!model->is_scene_model()) {
+				model->enqueue(queue_, culler, proj, camera_pos);
+				continue;
+			}
+			const auto* bounded = static_cast<const scene_model*>(model.get());
+			model_boxes_.push(bounded->aabb_min(), bounded->aabb_max());
+			boxed_models_.push_back(bounded);
+		}
+
+		const auto visible            = culler.cull(model_boxes_, model_visible_, &pool_);
+		culler.stats().models_visible = visible;
+		culler.stats().models_culled  = model_boxes_.count - visible;
+		occlude(culler.stats(), view, proj);
+		for (size_t i = 0; i < boxed_models_.size(); i++) {
+			if (model_visible_[i] != 0) {
+				boxed_models_[i]->enqueue(queue_, culler, proj, camera_pos);
+			}
+		}
+		queue_.submit(view, proj, camera_pos);
+		lights_.end_frame();
+
+		stats_ = { culler.stats(), occlusion_.stats(), queue_.draw_calls(), queue_.upload_stats(),
+		           queue_.gpu_culling() };
+	}
+
+	void scene::occlude(cull_stats& stats, const glm::mat4& view, const glm::mat4& proj) {
+		// designated occluders in view are drawn into CPU depth, models entirely behind them are never enqueued
+		occlusion_.begin(proj * view);
+		for (size_t i = 0; i < boxed_models_.size(); i++) {
+			const auto* hull = boxed_models_[i]->occluder_hull();
+			if (model_visible_[i] != 0 && hull != nullptr) {
+				occlusion_.add_occluder(*hull, boxed_models_[i]->model_matrix());
+			}
+		}
+		if (occlusion_.stats().occluders == 0) {
+			return;
+		}
+		occlusion_.render(&pool_);
+
+		for (size_t i = 0; i < boxed_models_.size(); i++) {
+			if (model_visible_[i] == 0 || boxed_models_[i]->is_occluder()) {
+				continue;
+			}
+			if (!occlusion_.visible(boxed_models_[i]->aabb_min(), boxed_models_[i]->aabb_max())) {
+				model_visible_[i] = 0;
+				stats.models_visible--;
+				stats.models_occluded++;
 			}
-			model_it->get()->draw(view, proj, camera_pos);
 		}
 	}
 
@@ -32,6 +88,14 @@ namespace kanso {
 		return obj_manager_->view_end();
 	}
 
+	void scene::set_transform(size_t index, const glm::vec3& pos, const glm::vec3& scale, const glm::vec3& rot) {
+		obj_manager_->set_transform(index, pos, scale, rot);
+	}
+
+	std::shared_ptr<model> scene::pick(const raycast& ray) const {
+		return obj_manager_->pick(ray);
+	}
+
 	std::vector<std::shared_ptr<model>>::const_iterator scene::model_begin() {
 		return obj_manager_->model_begin();
 	}
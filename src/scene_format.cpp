@@ -0,0 +1,379 @@
+#include "scene_format.hpp"
+#include "binary_io.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <array>
+#include <fstream>
+#include <unordered_map>
+
+namespace kanso {
+
+	namespace {
+
+		constexpr std::array<char, 4> SCENE_MAGIC   = { 'K', 'S', 'C', 'N' };
+		constexpr uint32_t            SCENE_VERSION = 2;
+		constexpr uint32_t            HAS_CAMERA    = 1U << 0U;
+		constexpr size_t              ENTRY_ALIGN   = 8; // string block is padded so entries stay aligned when mapped
+
+		struct binary_scene_header {
+			std::array<char, 4> magic{};
+			uint32_t            version{};
+			uint32_t            flags{};
+			float               lod_screen_error{};
+			scene_camera        camera;
+			uint32_t            string_count{};
+			uint32_t            string_bytes{}; // padded to ENTRY_ALIGN
+			uint32_t            model_count{};
+			uint32_t            light_count{};
+			uint64_t            payload_size{};
+			uint64_t            payload_hash{};
+		};
+
+		// layout: header | string_ref[string_count] | string bytes | scene_model_entry[] | scene_light_entry[]
+		struct string_ref {
+			uint32_t offset{};
+			uint32_t size{};
+		};
+
+		// deduplicates strings while scene is being built
+		class string_table {
+			public:
+				string_table(std::vector<std::string>& strings) : strings_(strings) {}
+
+				uint32_t add(const std::string& str) {
+					auto [it, inserted] = indices_.try_emplace(str, static_cast<uint32_t>(strings_.size()));
+					if (inserted) {
+						strings_.push_back(str);
+					}
+					return it->second;
+				}
+
+			private:
+				std::vector<std::string>&                 strings_;
+				std::unordered_map<std::string, uint32_t> indices_;
+		};
+
+		glm::vec3 vec3_from_json(const nlohmann::json& j, const char* name) {
+			const auto& values = j.at(name);
+			return { values.at(0).get<float>(), values.at(1).get<float>(), values.at(2).get<float>() };
+		}
+
+		glm::vec3 vec3_from_json(const nlohmann::json& j, const char* name, const glm::vec3& fallback) {
+			return j.contains(name) ? vec3_from_json(j, name) : fallback;
+		}
+
+		nlohmann::json vec3_to_json(const glm::vec3& v) {
+			return nlohmann::json::array({ v.x, v.y, v.z });
+		}
+
+		scene_model_entry model_from_json(const nlohmann::json& model_json, string_table& strings) {
+			scene_model_entry model;
+			model.path           = strings.add(model_json.at("path").get<std::string>());
+			model.render_shader  = strings.add(model_json.at("render_shader").get<std::string>());
+			model.outline_shader = strings.add(model_json.at("outline_shader").get<std::string>());
+			model.position       = vec3_from_json(model_json, "position", glm::vec3{ 0.0f });
+			model.scale          = vec3_from_json(model_json, "scale", glm::vec3{ 1.0f });
+			model.rotation       = vec3_from_json(model_json, "rotation", glm::vec3{ 0.0f });
+			if (model_json.contains("lod_screen_error")) {
+				model.lod_screen_error = model_json["lod_screen_error"].get<float>();
+			}
+			if (model_json.contains("occluder")) {
+				model.occluder = model_json["occluder"].get<bool>() ? 1 : 0;
+			}
+			return model;
+		}
+
+		point_light_data point_from_json(const nlohmann::json& light_json) {
+			return { vec3_from_json(light_json, "position"), light_json.at("constant").get<float>(),
+				     light_json.at("linear").get<float>(), light_json.at("quadratic").get<float>() };
+		}
+
+		std::optional<scene_light_entry> light_from_json(const nlohmann::json& light_json) {
+			scene_light_entry light;
+			light.common = { vec3_from_json(light_json, "ambient"), vec3_from_json(light_json, "diffuse"),
+				             vec3_from_json(light_json, "specular") };
+
+			const auto type = light_json.at("light_type").get<std::string>();
+			if (type == "POINT_LIGHT") {
+				light.type                   = scene_light_type::point;
+				light.spot.point_light_part = point_from_json(light_json);
+			} else if (type == "SPOT_LIGHT") {
+				light.type                   = scene_light_type::spot;
+				light.spot.point_light_part = point_from_json(light_json);
+				light.spot.direction        = vec3_from_json(light_json, "direction");
+				light.spot.inner_cut_off    = light_json.at("inner_cut_off_angle").get<float>();
+				light.spot.outer_cut_off    = light_json.at("outer_cut_off_angle").get<float>();
+			} else if (type == "DIRECTIONAL_LIGHT") {
+				light.type           = scene_light_type::directional;
+				light.spot.direction = vec3_from_json(light_json, "direction");
+			} else {
+				spdlog::warn("Unknow light type: {}", type);
+				return std::nullopt;
+			}
+			return light;
+		}
+
+		nlohmann::json light_to_json(const scene_light_entry& light) {
+			nlohmann::json light_json = {
+				{ "ambient", vec3_to_json(light.common.ambient) },
+				{ "diffuse", vec3_to_json(light.common.diffuse) },
+				{ "specular", vec3_to_json(light.common.specular) },
+			};
+
+			const auto& point = light.spot.point_light_part;
+			const auto  write_point = [&light_json, &point]() {
+				light_json["constant"]  = point.constant;
+				light_json["linear"]    = point.linear;
+				light_json["quadratic"] = point.quadratic;
+				light_json["position"]  = vec3_to_json(point.pos);
+			};
+
+			switch (light.type) {
+				case scene_light_type::point:
+					light_json["light_type"] = "POINT_LIGHT";
+					write_point();
+					break;
+				case scene_light_type::spot:
+					light_json["light_type"]          = "SPOT_LIGHT";
+					light_json["inner_cut_off_angle"] = light.spot.inner_cut_off;
+					light_json["outer_cut_off_angle"] = light.spot.outer_cut_off;
+					light_json["direction"]           = vec3_to_json(light.spot.direction);
+					write_point();
+					break;
+				case scene_light_type::directional:
+					light_json["light_type"] = "DIRECTIONAL_LIGHT";
+					light_json["direction"]  = vec3_to_json(light.spot.direction);
+					break;
+			}
+			return light_json;
+		}
+
+		bool is_binary_scene(const std::string& path) {
+			std::array<char, 4> magic{};
+			std::ifstream       file(path, std::ios::binary);
+			return file.read(magic.data(), magic.size()) && magic == SCENE_MAGIC;
+		}
+
+		[[noreturn]] void corrupt(const std::string& path, std::string_view reason) {
+			spdlog::error("Binary scene {}: {}", path, reason);
+			throw exception::bad_scene_file_exception("Passed scene file is in wrong format");
+		}
+
+	} // namespace
+
+	namespace scene_format {
+
+		scene_description load(const std::string& path) {
+			if (is_binary_scene(path)) {
+				return read_binary(path);
+			}
+
+			std::ifstream file(path);
+			if (!file) {
+				throw exception::bad_scene_file_exception(fmt::format("Can't open scene file {}", path));
+			}
+			return from_json(nlohmann::json::parse(file));
+		}
+
+		void save(const std::string& path, const scene_description& scene) {
+			if (!path.ends_with(".json")) {
+				write_binary(path, scene);
+				return;
+			}
+
+			const auto text    = to_json(scene).dump(1, '\t');
+			const bool written = write_file_atomically(path, [&text](std::ostream& out) { out << text << '\n'; });
+			if (!written) {
+				throw exception::bad_scene_file_exception(fmt::format("Failed to write scene file {}", path));
+			}
+		}
+
+		scene_description from_json(const nlohmann::json& json) {
+			scene_description scene;
+			string_table      strings(scene.strings);
+
+			try {
+				for (const auto& item : json) {
+					const auto& type = item.at("type");
+					if (type == "camera") {
+						scene.camera = scene_camera{ vec3_from_json(item, "position"), item.at("fov").get<float>(),
+							                         item.at("near").get<float>(), item.at("far").get<float>() };
+					} else if (type == "lod") {
+						if (item.contains("screen_error")) {
+							scene.lod_screen_error = item["screen_error"].get<float>();
+						}
+					} else if (type == "model") {
+						const auto& values = item.at("values");
+						scene.models.reserve(scene.models.size() + values.size());
+						for (const auto& model_json : values) {
+							scene.models.push_back(model_from_json(model_json, strings));
+						}
+					} else if (type == "light") {
+						for (const auto& light_json : item.at("values")) {
+							if (auto light = light_from_json(light_json)) {
+								scene.lights.push_back(*light);
+							}
+						}
+					}
+				}
+			} catch (const nlohmann::json::exception& e) {
+				spdlog::error(e.what());
+				throw exception::bad_scene_file_exception("Passed scene file is in wrong format");
+			}
+
+			return scene;
+		}
+
+		nlohmann::json to_json(const scene_description& scene) {
+			nlohmann::json json = nlohmann::json::object();
+
+			if (scene.camera) {
+				json["camera"] = { { "type", "camera" },
+					               { "position", vec3_to_json(scene.camera->position) },
+					               { "fov", scene.camera->fov },
+					               { "near", scene.camera->near },
+					               { "far", scene.camera->far } };
+			}
+
+			json["lod"] = { { "type", "lod" }, { "screen_error", scene.lod_screen_error } };
+
+			auto models = nlohmann::json::array();
+			for (const auto& model : scene.models) {
+				nlohmann::json model_json = { { "model_type", "LOADED_MODEL" },
+					                          { "path", scene.strings[model.path] },
+					                          { "position", vec3_to_json(model.position) },
+					                          { "scale", vec3_to_json(model.scale) },
+					                          { "rotation", vec3_to_json(model.rotation) },
+					                          { "render_shader", scene.strings[model.render_shader] },
+					                          { "outline_shader", scene.strings[model.outline_shader] } };
+				if (model.lod_screen_error >= 0.0f) {
+					model_json["lod_screen_error"] = model.lod_screen_error;
+				}
+				if (model.occluder != 0) {
+					model_json["occluder"] = true;
+				}
+				models.push_back(std::move(model_json));
+			}
+			json["models"] = { { "type", "model" }, { "values", std::move(models) } };
+
+			auto lights = nlohmann::json::array();
+			for (const auto& light : scene.lights) {
+				lights.push_back(light_to_json(light));
+			}
+			json["lights"] = { { "type", "light" }, { "values", std::move(lights) } };
+
+			return json;
+		}
+
+		scene_description read_binary(const std::string& path) {
+			const mapped_file file(path);
+			if (file.data() == nullptr) {
+				throw exception::bad_scene_file_exception(fmt::format("Can't open scene file {}", path));
+			}
+
+			byte_reader         reader(file.data(), file.size());
+			binary_scene_header header;
+			if (!reader.read(header) || header.magic != SCENE_MAGIC) {
+				corrupt(path, "not a binary scene");
+			}
+			if (header.version != SCENE_VERSION) {
+				corrupt(path, fmt::format("version {} is not supported, expected {}", header.version, SCENE_VERSION));
+			}
+
+			const uint64_t expected = uint64_t{ header.string_count } * sizeof(string_ref) + header.string_bytes +
+			                          uint64_t{ header.model_count } * sizeof(scene_model_entry) +
+			                          uint64_t{ header.light_count } * sizeof(scene_light_entry);
+			const size_t payload_offset = reader.offset();
+			if (header.payload_size != expected || header.payload_size != file.size() - payload_offset ||
+			    header.payload_hash != fnv1a(file.data() + payload_offset, header.payload_size)) // NOLINT(*pointer-arithmetic)
+			{
+				corrupt(path, "size or checksum mismatch");
+			}
+
+			scene_description scene;
+			scene.lod_screen_error = header.lod_screen_error;
+			if ((header.flags & HAS_CAMERA) != 0) {
+				scene.camera = header.camera;
+			}
+
+			// sizes were checked above, every read below succeeds and only references need validation
+			std::vector<string_ref> refs;
+			std::string             string_bytes;
+			reader.read(refs, header.string_count);
+			reader.read(string_bytes, header.string_bytes);
+			reader.read(scene.models, header.model_count);
+			reader.read(scene.lights, header.light_count);
+
+			scene.strings.reserve(refs.size());
+			for (const auto& ref : refs) {
+				if (ref.offset > string_bytes.size() || ref.size > string_bytes.size() - ref.offset) {
+					corrupt(path, "string out of range");
+				}
+				scene.strings.emplace_back(string_bytes, ref.offset, ref.size);
+			}
+			for (const auto& model : scene.models) {
+				if (model.path >= refs.size() || model.render_shader >= refs.size() || model.outline_shader >= refs.size()) {
+					corrupt(path, "model references missing string");
+				}
+			}
+			for (const auto& light : scene.lights) {
+				if (light.type != scene_light_type::directional && light.type != scene_light_type::point &&
+				    light.type != scene_light_type::spot)
+				{
+					corrupt(path, "unknown light type");
+				}
+			}
+
+			return scene;
+		}
+
+		void write_binary(const std::string& path, const scene_description& scene) {
+			std::vector<string_ref> refs;
+			std::string             string_bytes;
+			refs.reserve(scene.strings.size());
+			for (const auto& str : scene.strings) {
+				refs.push_back({ static_cast<uint32_t>(string_bytes.size()), static_cast<uint32_t>(str.size()) });
+				string_bytes += str;
+			}
+			string_bytes.resize((string_bytes.size() + ENTRY_ALIGN - 1) / ENTRY_ALIGN * ENTRY_ALIGN, '\0');
+
+			binary_scene_header header;
+			header.magic            = SCENE_MAGIC;
+			header.version          = SCENE_VERSION;
+			header.flags            = scene.camera ? HAS_CAMERA : 0U;
+			header.lod_screen_error = scene.lod_screen_error;
+			header.camera           = scene.camera.value_or(scene_camera{});
+			header.string_count     = static_cast<uint32_t>(refs.size());
+			header.string_bytes     = static_cast<uint32_t>(string_bytes.size());
+			header.model_count      = static_cast<uint32_t>(scene.models.size());
+			header.light_count      = static_cast<uint32_t>(scene.lights.size());
+
+			const auto refs_size   = refs.size() * sizeof(string_ref);
+			const auto models_size = scene.models.size() * sizeof(scene_model_entry);
+			const auto lights_size = scene.lights.size() * sizeof(scene_light_entry);
+			header.payload_size    = refs_size + string_bytes.size() + models_size + lights_size;
+
+			// NOLINTBEGIN(*reinterpret-cast)
+			uint64_t hash = fnv1a(reinterpret_cast<const uint8_t*>(refs.data()), refs_size);
+			hash          = fnv1a(reinterpret_cast<const uint8_t*>(string_bytes.data()), string_bytes.size(), hash);
+			hash          = fnv1a(reinterpret_cast<const uint8_t*>(scene.models.data()), models_size, hash);
+			hash          = fnv1a(reinterpret_cast<const uint8_t*>(scene.lights.data()), lights_size, hash);
+			// NOLINTEND(*reinterpret-cast)
+			header.payload_hash = hash;
+
+			const bool written = write_file_atomically(path, [&](std::ostream& out) {
+				write(out, header);
+				write(out, refs);
+				out.write(string_bytes.data(), static_cast<std::streamsize>(string_bytes.size()));
+				write(out, scene.models);
+				write(out, scene.lights);
+			});
+			if (!written) {
+				throw exception::bad_scene_file_exception(fmt::format("Failed to write scene file {}", path));
+			}
+		}
+
+	} // namespace scene_format
+
+} // namespace kanso
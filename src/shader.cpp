@@ -1,4 +1,5 @@
 #include "shader.hpp"
+#include "shader_cache.hpp"
 #include "glad/glad.h"
 
 #include <spdlog/spdlog.h>
@@ -10,37 +11,6 @@
 namespace kanso {
 
 	namespace {
-		std::pair<std::string, std::string> load_shaders(std::string_view vert_file, std::string_view frag_file) {
-			std::ifstream vert_fs;
-			std::ifstream frag_fs;
-			std::string   vert_code;
-			std::string   frag_code;
-
-			vert_fs.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-			frag_fs.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-			try {
-				vert_fs.open(vert_file);
-				frag_fs.open(frag_file);
-
-				std::stringstream vert_stream;
-				std::stringstream frag_stream;
-
-				vert_stream << vert_fs.rdbuf();
-				frag_stream << frag_fs.rdbuf();
-
-				vert_fs.close();
-				frag_fs.close();
-
-				vert_code = vert_stream.str();
-				frag_code = frag_stream.str();
-			} catch (std::ifstream::failure& e) {
-				spdlog::error("Failed to read shader: {}, {}", vert_file, frag_file);
-				throw exception::shader_load_exception(e.what());
-			}
-
-			return { vert_code, frag_code };
-		}
-
 		uint compile_shader(const char* code, GLenum type) {
 			const uint vert = glCreateShader(type);
 			int        res{};
@@ -56,59 +26,143 @@ namespace kanso {
 
 			return vert;
 		}
+	} // namespace
 
-		uint create_shader(std::string_view vert_file, std::string_view frag_file) {
-			auto code_pair = load_shaders(vert_file, frag_file);
+	std::pair<std::string, std::string> read_shader_sources(std::string_view vert_file, std::string_view frag_file) {
+		std::ifstream vert_fs;
+		std::ifstream frag_fs;
+		std::string   vert_code;
+		std::string   frag_code;
 
-			const char* vert_str = code_pair.first.c_str();
-			const char* frag_str = code_pair.second.c_str();
-			int         res{};
-			uint        vert{};
-			uint        frag{};
+		vert_fs.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+		frag_fs.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+		try {
+			vert_fs.open(vert_file);
+			frag_fs.open(frag_file);
 
-			vert = compile_shader(vert_str, GL_VERTEX_SHADER);
-			frag = compile_shader(frag_str, GL_FRAGMENT_SHADER);
+			std::stringstream vert_stream;
+			std::stringstream frag_stream;
 
-			const uint id = glCreateProgram();
-			glAttachShader(id, vert);
-			glAttachShader(id, frag);
-			glLinkProgram(id);
-			glGetProgramiv(id, GL_LINK_STATUS, &res);
-			if (res == GL_FALSE) {
-				std::array<char, 512> info{};
-				glGetProgramInfoLog(id, sizeof(info), nullptr, info.data());
-				throw exception::shader_linkage_exception(
-				    fmt::format("Failed to link shaders: {}, {}", vert_file, frag_file));
-			}
+			vert_stream << vert_fs.rdbuf();
+			frag_stream << frag_fs.rdbuf();
 
-			glDeleteShader(vert);
-			glDeleteShader(frag);
+			vert_fs.close();
+			frag_fs.close();
 
-			return id;
+			vert_code = vert_stream.str();
+			frag_code = frag_stream.str();
+		} catch (std::ifstream::failure& e) {
+			spdlog::error("Failed to read shader: {}, {}", vert_file, frag_file);
+			throw exception::shader_load_exception(e.what());
 		}
-	} // namespace
+
+		return { vert_code, frag_code };
+	}
+
+	uint link_program(const std::string& vert_code, const std::string& frag_code, std::string_view name,
+	                  bool retrievable) {
+		int  res{};
+		uint vert{};
+		uint frag{};
+
+		vert = compile_shader(vert_code.c_str(), GL_VERTEX_SHADER);
+		frag = compile_shader(frag_code.c_str(), GL_FRAGMENT_SHADER);
+
+		const uint id = glCreateProgram();
+		if (retrievable) {
+			glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+		glAttachShader(id, vert);
+		glAttachShader(id, frag);
+		glLinkProgram(id);
+		glGetProgramiv(id, GL_LINK_STATUS, &res);
+		if (res == GL_FALSE) {
+			std::array<char, 512> info{};
+			glGetProgramInfoLog(id, sizeof(info), nullptr, info.data());
+			throw exception::shader_linkage_exception(fmt::format("Failed to link shaders: {}", name));
+		}
+
+		glDeleteShader(vert);
+		glDeleteShader(frag);
+
+		reflect(id);
+		return id;
+	}
+
+	uint link_compute_program(std::string_view comp_file) {
+		std::string code;
+		try {
+			std::ifstream comp_fs;
+			comp_fs.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+			comp_fs.open(comp_file);
+			std::stringstream comp_stream;
+			comp_stream << comp_fs.rdbuf();
+			code = comp_stream.str();
+		} catch (std::ifstream::failure& e) {
+			spdlog::error("Failed to read shader: {}", comp_file);
+			throw exception::shader_load_exception(e.what());
+		}
+
+		const uint comp = compile_shader(code.c_str(), GL_COMPUTE_SHADER);
+		const uint id   = glCreateProgram();
+		int        res{};
+		glAttachShader(id, comp);
+		glLinkProgram(id);
+		glGetProgramiv(id, GL_LINK_STATUS, &res);
+		glDeleteShader(comp);
+		if (res == GL_FALSE) {
+			std::array<char, 512> info{};
+			glGetProgramInfoLog(id, sizeof(info), nullptr, info.data());
+			spdlog::error("{}", info.data());
+			throw exception::shader_linkage_exception(fmt::format("Failed to link shader: {}", comp_file));
+		}
+
+		reflect(id);
+		return id;
+	}
 
 	// TODO: shader failed loading is not held anywhere
-	shader::shader(std::string_view vert_file, std::string_view frag_file) : id_(create_shader(vert_file, frag_file)) {}
+	shader::shader(std::string_view vert_file, std::string_view frag_file)
+	    : id_(shader_cache::instance().program_of_files(vert_file, frag_file).id()) {}
+
+	void set_uniform_value(int location, const glm::vec3& vector) {
+		glUniform3fv(location, 1, &vector[0]);
+	}
+
+	void set_uniform_value(int location, const glm::mat4& matrix) {
+		glUniformMatrix4fv(location, 1, GL_FALSE, &matrix[0][0]);
+	}
+
+	void set_uniform_value(int location, bool val) {
+		glUniform1i(location, static_cast<int>(val));
+	}
+
+	void set_uniform_value(int location, int val) {
+		glUniform1i(location, val);
+	}
+
+	void set_uniform_value(int location, float val) {
+		glUniform1f(location, val);
+	}
 
-	void shader::set_uniform(uint shader, std::string_view name, const glm::vec3& vector) {
-		glUniform3fv(glGetUniformLocation(shader, name.data()), 1, &vector[0]);
+	void shader::set_uniform(uint shader, uniform_name name, const glm::vec3& vector) {
+		set_uniform_value(reflect(shader).location(name.hash()), vector);
 	}
 
-	void shader::set_uniform(uint shader, std::string_view name, bool val) {
-		glUniform1i(glGetUniformLocation(shader, name.data()), static_cast<int>(val));
+	void shader::set_uniform(uint shader, uniform_name name, bool val) {
+		set_uniform_value(reflect(shader).location(name.hash()), val);
 	}
 
-	void shader::set_uniform(uint shader, std::string_view name, int val) {
-		glUniform1i(glGetUniformLocation(shader, name.data()), val);
+	void shader::set_uniform(uint shader, uniform_name name, int val) {
+		set_uniform_value(reflect(shader).location(name.hash()), val);
 	}
 
-	void shader::set_uniform(uint shader, std::string_view name, float val) {
-		glUniform1f(glGetUniformLocation(shader, name.data()), val);
+	void shader::set_uniform(uint shader, uniform_name name, float val) {
+		set_uniform_value(reflect(shader).location(name.hash()), val);
 	}
 
-	void shader::set_uniform(uint shader, std::string_view name, const glm::mat4& matrix) {
-		glUniformMatrix4fv(glGetUniformLocation(shader, name.data()), 1, GL_FALSE, &matrix[0][0]);
+	void shader::set_uniform(uint shader, uniform_name name, const glm::mat4& matrix) {
+		set_uniform_value(reflect(shader).location(name.hash()), matrix);
 	}
 
 	void shader::use(uint shader) {
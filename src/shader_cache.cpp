@@ -0,0 +1,202 @@
+#include "shader_cache.hpp"
+#include "binary_io.hpp"
+#include "glad/glad.h"
+
+#include <spdlog/spdlog.h>
+
+#include <array>
+
+namespace kanso {
+
+	namespace {
+
+		constexpr std::array<char, 4> BINARY_MAGIC   = { 'K', 'P', 'R', 'G' };
+		constexpr uint32_t            BINARY_VERSION = 1;
+
+		struct binary_header {
+			std::array<char, 4> magic{};
+			uint32_t            version{};
+			uint32_t            format{}; // driver specific, as returned by glGetProgramBinary
+			uint32_t            reserved{};
+			uint64_t            key{};
+			uint64_t            payload_size{};
+			uint64_t            payload_hash{};
+		};
+
+		std::string gl_string(GLenum name) {
+			const auto* str = glGetString(name);
+			return str != nullptr ? reinterpret_cast<const char*>(str) : ""; // NOLINT(*reinterpret-cast)
+		}
+
+		std::string with_defines(const std::string& code, const std::vector<std::string>& defines) {
+			if (defines.empty()) {
+				return code;
+			}
+
+			std::string block;
+			for (const auto& define : defines) {
+				block += fmt::format("#define {}\n", define);
+			}
+
+			// #version has to stay first, so defines go right after it
+			size_t at = 0;
+			if (code.starts_with("#version")) {
+				const auto line_end = code.find('\n');
+				at                  = line_end == std::string::npos ? code.size() : line_end + 1;
+			}
+			auto result = code;
+			result.insert(at, block);
+			return result;
+		}
+
+		uint64_t hash_string(const std::string& str, uint64_t hash) {
+			// size separates neighbouring strings, so "ab"+"c" and "a"+"bc" differ
+			const uint64_t size = str.size();
+			hash = fnv1a(reinterpret_cast<const uint8_t*>(&size), sizeof(size), hash); // NOLINT(*reinterpret-cast)
+			return fnv1a(reinterpret_cast<const uint8_t*>(str.data()), str.size(), hash); // NOLINT(*reinterpret-cast)
+		}
+
+	} // namespace
+
+	shader_cache& shader_cache::instance() {
+		static shader_cache cache;
+		return cache;
+	}
+
+	std::string shader_cache::entry_path(uint64_t key) const {
+		return fmt::format("{}/{:016x}.kprg", cache_dir_, key);
+	}
+
+	shader shader_cache::program(std::string_view name, const std::vector<std::string>& defines) {
+		auto key = std::string(name);
+		for (const auto& define : defines) {
+			key += '\n' + define;
+		}
+		if (auto it = programs_.find(key); it != programs_.end()) {
+			return it->second;
+		}
+
+		const auto [vert_code, frag_code] =
+		    read_shader_sources(fmt::format("shaders/{}.vert", name), fmt::format("shaders/{}.frag", name));
+		return link(std::move(key), name, with_defines(vert_code, defines), with_defines(frag_code, defines));
+	}
+
+	shader shader_cache::program_of_files(std::string_view vert_file, std::string_view frag_file) {
+		// '|' never appears in names, so keys of files and of named programs stay apart
+		auto key = fmt::format("{}|{}", vert_file, frag_file);
+		if (auto it = programs_.find(key); it != programs_.end()) {
+			return it->second;
+		}
+
+		const auto [vert_code, frag_code] = read_shader_sources(vert_file, frag_file);
+		return link(std::move(key), fmt::format("{}, {}", vert_file, frag_file), vert_code, frag_code);
+	}
+
+	shader shader_cache::link(std::string key, std::string_view name, const std::string& vert_code,
+	                          const std::string& frag_code) {
+		if (!driver_queried_) {
+			driver_queried_ = true;
+			driver_         = fmt::format("{}\n{}\n{}", gl_string(GL_VENDOR), gl_string(GL_RENDERER),
+			                              gl_string(GL_VERSION));
+			// some drivers support the API but no formats, binaries are useless there
+			int formats = 0;
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+			binaries_supported_ = formats > 0;
+			if (!binaries_supported_) {
+				spdlog::info("Driver exposes no program binary formats, shaders are compiled on every start");
+			}
+		}
+
+		uint     id         = 0;
+		uint64_t binary_key = 0;
+		if (binaries_supported_) {
+			binary_key = hash_string(frag_code, hash_string(vert_code, hash_string(driver_, FNV1A_OFFSET_BASIS)));
+			id         = load_binary(binary_key, name);
+		}
+
+		if (id == 0) {
+			id = link_program(vert_code, frag_code, name, binaries_supported_);
+			if (binaries_supported_) {
+				store_binary(binary_key, id, name);
+			}
+		}
+
+		return programs_.emplace(std::move(key), shader(id)).first->second;
+	}
+
+	uint shader_cache::load_binary(uint64_t key, std::string_view name) const {
+		const auto        path = entry_path(key);
+		const mapped_file file(path);
+		if (file.data() == nullptr) {
+			return 0;
+		}
+
+		byte_reader   reader(file.data(), file.size());
+		binary_header header;
+		if (!reader.read(header) || header.magic != BINARY_MAGIC || header.version != BINARY_VERSION ||
+		    header.key != key)
+		{
+			spdlog::warn("Program binary {} of {} shader is corrupt or outdated", path, name);
+			return 0;
+		}
+
+		const size_t payload_offset = reader.offset();
+		if (header.payload_size != file.size() - payload_offset ||
+		    header.payload_hash != fnv1a(file.data() + payload_offset, header.payload_size)) // NOLINT(*pointer-arithmetic)
+		{
+			spdlog::warn("Program binary {} of {} shader is corrupt", path, name);
+			return 0;
+		}
+
+		const uint id = glCreateProgram();
+		glProgramBinary(id, header.format, file.data() + payload_offset, // NOLINT(*pointer-arithmetic)
+		                static_cast<GLsizei>(header.payload_size));
+
+		// driver may reject binaries of other builds even under the same version string
+		int linked = GL_FALSE;
+		glGetProgramiv(id, GL_LINK_STATUS, &linked);
+		if (linked == GL_FALSE) {
+			spdlog::debug("Driver rejected program binary of {} shader, compiling it", name);
+			glDeleteProgram(id);
+			return 0;
+		}
+
+		spdlog::debug("Loaded {} shader from program binary", name);
+		reflect(id);
+		return id;
+	}
+
+	void shader_cache::store_binary(uint64_t key, uint program, std::string_view name) const {
+		int size = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+		if (size <= 0) {
+			return;
+		}
+
+		std::vector<uint8_t> payload(static_cast<size_t>(size));
+		GLenum               format = 0;
+		glGetProgramBinary(program, size, &size, &format, payload.data());
+		payload.resize(static_cast<size_t>(size));
+
+		binary_header header;
+		header.magic        = BINARY_MAGIC;
+		header.version      = BINARY_VERSION;
+		header.format       = format;
+		header.key          = key;
+		header.payload_size = payload.size();
+		header.payload_hash = fnv1a(payload.data(), payload.size());
+
+		const auto path    = entry_path(key);
+		const bool written = write_file_atomically(path, [&](std::ostream& out) {
+			write(out, header);
+			write(out, payload);
+		});
+		if (!written) {
+			spdlog::warn("Failed to write program binary of {} shader", name);
+			return;
+		}
+
+		spdlog::debug("Cached program binary of {} shader to {}", name, path);
+	}
+
+} // namespace kanso
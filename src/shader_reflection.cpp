@@ -0,0 +1,148 @@
+#include "shader_reflection.hpp"
+#include "glad/glad.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+
+namespace kanso {
+
+	namespace {
+
+		struct block_binding {
+			uniform_name name;
+			uint         binding;
+		};
+
+		// GL 4.1 has no layout(binding = N) for blocks, engine owned blocks are bound here once per program
+		constexpr std::array<block_binding, 3> BLOCK_BINDINGS = { {
+		    { "Lights", LIGHTS_BLOCK_BINDING },
+		    { "Camera", CAMERA_BLOCK_BINDING },
+		    { "CullParams", CULL_BLOCK_BINDING },
+		} };
+
+		// same for samplers engine binds itself, they keep their unit in every program
+		constexpr std::array<block_binding, 4> SAMPLER_UNITS = { {
+		    { "depthPyramid", DEPTH_PYRAMID_UNIT },
+		    { "lightData", LIGHT_DATA_UNIT },
+		    { "clusterGrid", CLUSTER_GRID_UNIT },
+		    { "lightIndices", LIGHT_INDEX_UNIT },
+		} };
+
+		template <typename Info>
+		void sort_by_hash(std::vector<Info>& infos) {
+			std::sort(infos.begin(), infos.end(), [](const auto& a, const auto& b) { return a.hash < b.hash; });
+		}
+
+		template <typename Info>
+		const Info* find_by_hash(const std::vector<Info>& infos, uint64_t hash) {
+			auto it = std::lower_bound(infos.begin(), infos.end(), hash,
+			                           [](const auto& info, uint64_t value) { return info.hash < value; });
+			return it != infos.end() && it->hash == hash ? &*it : nullptr;
+		}
+
+	} // namespace
+
+	program_reflection::program_reflection(uint program) {
+		int count      = 0;
+		int max_length = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+		std::string name(static_cast<size_t>(std::max(max_length, 1)), '\0');
+		for (int i = 0; i < count; i++) {
+			GLsizei length = 0;
+			GLint   size   = 0;
+			GLenum  type   = 0;
+			glGetActiveUniform(program, static_cast<GLuint>(i), max_length, &length, &size, &type, name.data());
+
+			std::string uniform(name.data(), static_cast<size_t>(length));
+			// members of uniform blocks have no location, they are reached through their block
+			const int location = glGetUniformLocation(program, uniform.c_str());
+			if (location < 0) {
+				continue;
+			}
+
+			// arrays are reported as "name[0]", every element gets its own entry and bare name maps to first one
+			if (uniform.ends_with("[0]")) {
+				const auto base = uniform.substr(0, uniform.size() - 3);
+				uniforms_.push_back({ base, uniform_hash(base), location, type, size });
+				for (int element = 1; element < size; element++) {
+					auto element_name = fmt::format("{}[{}]", base, element);
+					uniforms_.push_back({ element_name, uniform_hash(element_name),
+					                      glGetUniformLocation(program, element_name.c_str()), type, 1 });
+				}
+			}
+			uniforms_.push_back({ uniform, uniform_hash(uniform), location, type, size });
+
+			for (const auto& known : SAMPLER_UNITS) {
+				if (known.name.hash() == uniforms_.back().hash) {
+					glProgramUniform1i(program, location, static_cast<GLint>(known.binding));
+				}
+			}
+		}
+
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_length);
+		name.assign(static_cast<size_t>(std::max(max_length, 1)), '\0');
+		for (int i = 0; i < count; i++) {
+			GLsizei length    = 0;
+			GLint   data_size = 0;
+			glGetActiveUniformBlockName(program, static_cast<GLuint>(i), max_length, &length, name.data());
+			glGetActiveUniformBlockiv(program, static_cast<GLuint>(i), GL_UNIFORM_BLOCK_DATA_SIZE, &data_size);
+
+			std::string block(name.data(), static_cast<size_t>(length));
+			blocks_.push_back({ block, uniform_hash(block), static_cast<uint>(i), data_size });
+
+			for (const auto& known : BLOCK_BINDINGS) {
+				if (known.name.hash() == blocks_.back().hash) {
+					glUniformBlockBinding(program, static_cast<GLuint>(i), known.binding);
+				}
+			}
+		}
+
+		sort_by_hash(uniforms_);
+		sort_by_hash(blocks_);
+
+		const auto collision = std::adjacent_find(uniforms_.begin(), uniforms_.end(),
+		                                          [](const auto& a, const auto& b) { return a.hash == b.hash; });
+		if (collision != uniforms_.end()) {
+			spdlog::warn("Uniform names {} and {} of program {} have the same hash", collision->name,
+			             std::next(collision)->name, program);
+		}
+		spdlog::debug("Reflected program {}: {} uniforms, {} uniform blocks", program, uniforms_.size(),
+		              blocks_.size());
+	}
+
+	int program_reflection::location(uint64_t hash) const {
+		const auto* info = find_by_hash(uniforms_, hash);
+		return info != nullptr ? info->location : -1;
+	}
+
+	uint program_reflection::block_index(uint64_t hash) const {
+		const auto* info = find_by_hash(blocks_, hash);
+		return info != nullptr ? info->index : GL_INVALID_INDEX;
+	}
+
+	const program_reflection& reflect(uint program) {
+		static std::unordered_map<uint, program_reflection> programs;
+		// consecutive lookups mostly hit the program bound last
+		static uint                      last_program    = 0;
+		static const program_reflection* last_reflection = nullptr;
+
+		if (program == last_program && last_reflection != nullptr) {
+			return *last_reflection;
+		}
+
+		auto it = programs.find(program);
+		if (it == programs.end()) {
+			it = programs.emplace(program, program_reflection(program)).first;
+		}
+		last_program    = program;
+		last_reflection = &it->second;
+		return it->second;
+	}
+
+} // namespace kanso
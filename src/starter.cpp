@@ -1,19 +1,19 @@
 #include "starter.hpp"
 #include "core.hpp"
 #include "loader.hpp"
+#include "scene_format.hpp"
 
 #include "spdlog/spdlog.h"
 #include "nlohmann/json.hpp"
 
-#include <fstream>
-
 namespace kanso {
 
 
 	namespace {
-		nlohmann::json read_scene(const char* scene_path) {
+		// JSON or binary scene, format is detected from file contents
+		scene_description read_scene(const char* scene_path) {
 			spdlog::debug("Reading '{}' scene", scene_path);
-			return nlohmann::json::parse(std::ifstream(scene_path));
+			return scene_format::load(scene_path);
 		}
 
 	} // namespace
@@ -24,28 +24,50 @@ namespace kanso {
 #endif
 	}
 
+	bool starter::converting() const {
+		auto args = std::span(argv_, static_cast<size_t>(argc_));
+		return argc_ == 4 && std::string_view{ args[1] } == "--convert";
+	}
+
+	void starter::convert() const {
+		auto args = std::span(argv_, static_cast<size_t>(argc_));
+		try {
+			scene_format::save(args[3], read_scene(args[2]));
+			spdlog::info("Converted scene {} to {}", args[2], args[3]);
+		} catch (const nlohmann::json::parse_error& e) {
+			spdlog::error(e.what());
+			throw e;
+		} catch (const kanso::exception::bad_scene_file_exception& e) {
+			spdlog::error(e.what());
+			throw e;
+		}
+	}
+
 	std::unique_ptr<app> starter::make_app() {
 		if (init_) {
 			throw std::runtime_error("Trying to create app twice");
 		}
 
-		auto           args = std::span(argv_, static_cast<size_t>(argc_));
-		nlohmann::json json;
+		auto              args = std::span(argv_, static_cast<size_t>(argc_));
+		scene_description scene;
 
 		try {
 			if (argc_ > 1) {
-				json = read_scene(args[1]);
+				scene = read_scene(args[1]);
 			} else {
-				json = read_scene(kanso::DEFAULT_SCENE_PATH);
+				scene = read_scene(kanso::DEFAULT_SCENE_PATH);
 			}
 		} catch (const nlohmann::json::parse_error& e) {
 			spdlog::error(e.what());
 			throw e;
+		} catch (const kanso::exception::bad_scene_file_exception& e) {
+			spdlog::error(e.what());
+			throw e;
 		}
 
 		try {
 			init_ = true;
-			return std::make_unique<app>(std::move(json));
+			return std::make_unique<app>(std::move(scene));
 		} catch (const kanso::exception::bad_scene_file_exception& e) {
 			spdlog::error(e.what());
 			throw e;
@@ -11,21 +11,44 @@
 #endif
 #include "shader.hpp"
 #include "renderer.hpp"
+#include "texture_cache.hpp"
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+
 namespace kanso {
 
 	tex_map::tex_map(const raw_tex& data)
 	    : type_(data.type),
 	      path_(data.path),
-	      id_(renderer_factory::make_renderer()->load_texture(data.bytes, data.nr_channels, data.width, data.height)) {}
+	      id_(texture_cache::instance().id(data.path)) {}
+
+	texture::texture(std::vector<raw_tex> raw_maps)
+	    : raw_maps_(std::move(raw_maps)),
+	      renderer_(renderer_factory::make_renderer()) {}
+
+	bool texture::resident() {
+		if (resident_) {
+			return true;
+		}
+
+		const auto& cache = texture_cache::instance();
+		if (!std::all_of(raw_maps_.begin(), raw_maps_.end(), [&cache](const auto& raw) { return cache.resident(raw.path); })) {
+			return false;
+		}
 
-	texture::texture(const std::vector<raw_tex>& raw_textures) : renderer_(renderer_factory::make_renderer()) {
-		maps_.reserve(raw_textures.size());
-		for (auto&& raw : raw_textures) {
-			maps_.emplace_back(raw);
+		maps_.reserve(raw_maps_.size());
+		for (const auto& raw : raw_maps_) {
+			tex_map map{ raw };
+			if (map.id() == 0) {
+				continue;
+			}
+			maps_.emplace_back(std::move(map));
 		}
+		resident_ = true;
+
+		return true;
 	}
 
 	void texture::bind(uint shader) const {
@@ -52,4 +75,13 @@ namespace kanso {
 		}
 	}
 
+	uint texture::sort_id() const {
+		return maps_.empty() ? 0 : maps_.front().id();
+	}
+
+	bool texture::same_maps(const texture& other) const {
+		return std::equal(maps_.begin(), maps_.end(), other.maps_.begin(), other.maps_.end(),
+		                  [](const auto& a, const auto& b) { return a.id() == b.id() && a.type() == b.type(); });
+	}
+
 } // namespace kanso
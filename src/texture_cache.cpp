@@ -0,0 +1,155 @@
+#include "texture_cache.hpp"
+#include "thread_pool.hpp"
+#include "upload_queue.hpp"
+#include "renderer.hpp"
+#include "texture_cooker.hpp"
+#include "stb_image.h"
+
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <filesystem>
+
+namespace kanso {
+
+	namespace {
+
+		std::string resolve(std::string_view path) {
+			std::error_code ec;
+			auto            resolved = std::filesystem::weakly_canonical(path, ec);
+			if (ec) {
+				return std::filesystem::path(path).lexically_normal().string();
+			}
+			return resolved.string();
+		}
+
+		// RGBA8 mip chain of source image, empty if image can't be decoded
+		std::vector<rgba_image> decode(const std::string& path) {
+			int      width{};
+			int      height{};
+			int      nr_channels{};
+			uint8_t* bytes = stbi_load(path.c_str(), &width, &height, &nr_channels, 0);
+			if (bytes == nullptr) {
+				spdlog::warn("Null texture {}", path);
+				return {};
+			}
+
+			auto image = expand_to_rgba(bytes, width, height, nr_channels);
+			stbi_image_free(bytes);
+			return build_mip_chain(std::move(image));
+		}
+
+		// render thread time spent in GL calls for one texture
+		template <typename Upload>
+		uint timed(const std::string& key, Upload&& upload) {
+			const auto start = std::chrono::steady_clock::now();
+			const uint id    = upload();
+			spdlog::debug("Uploaded {} in {:.3f} ms", key,
+			              std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+			return id;
+		}
+
+		uint upload(const std::string& key, const std::vector<rgba_image>& levels) {
+			if (levels.empty()) {
+				return 0;
+			}
+
+			try {
+				return renderer_factory::make_renderer()->load_texture(levels);
+			} catch (const std::invalid_argument& e) {
+				spdlog::error("{}: {}", key, e.what());
+			}
+			return 0;
+		}
+
+		// up to date cooked copy, image is cooked now if there is none, std::nullopt if GL can't sample BCn
+		std::optional<compressed_texture> load_compressed(const std::string& path) {
+			const auto renderer = renderer_factory::make_renderer();
+			if (!renderer->supports_compression(block_format::bc1)) {
+				return std::nullopt;
+			}
+
+			const texture_cooker cooker;
+			auto                 cooked = cooker.load(path);
+			if (cooked && renderer->supports_compression(cooked->format)) {
+				return cooked;
+			}
+			return cooker.cook(path, renderer->supports_compression(block_format::bc7));
+		}
+
+		uint upload_compressed(const std::string& key, const compressed_texture& texture) {
+			try {
+				return renderer_factory::make_renderer()->load_compressed_texture(texture);
+			} catch (const std::invalid_argument& e) {
+				spdlog::error("{}: {}", key, e.what());
+			}
+			return 0;
+		}
+
+	} // namespace
+
+	texture_cache& texture_cache::instance() {
+		static texture_cache cache;
+		return cache;
+	}
+
+	std::string texture_cache::request(std::string_view path, thread_pool& pool, upload_queue& uploads) {
+		auto key = resolve(path);
+
+		const std::lock_guard<std::mutex> lock(mut_);
+		if (entries_.find(key) != entries_.end()) {
+			return key;
+		}
+		entries_.emplace(key, entry{});
+
+		// nobody waits on a future, so failures are logged and texture becomes resident without image
+		pool.submit([this, key, &uploads]() {
+			try {
+				if (auto cooked = load_compressed(key)) {
+					auto texture = std::make_shared<compressed_texture>(std::move(*cooked));
+					uploads.push(texture->size(), [this, key, texture]() {
+						finish(key, timed(key, [&key, &texture]() { return upload_compressed(key, *texture); }));
+					});
+					return;
+				}
+
+				auto   levels = std::make_shared<std::vector<rgba_image>>(decode(key));
+				size_t size   = 0;
+				for (const auto& level : *levels) {
+					size += level.pixels.size();
+				}
+				uploads.push(size, [this, key, levels]() {
+					finish(key, timed(key, [&key, &levels]() { return upload(key, *levels); }));
+				});
+			} catch (const std::exception& e) {
+				spdlog::error("Failed to load texture {}: {}", key, e.what());
+				finish(key, 0);
+			} catch (...) {
+				spdlog::error("Failed to load texture {}", key);
+				finish(key, 0);
+			}
+		});
+
+		return key;
+	}
+
+	void texture_cache::finish(const std::string& key, uint id) {
+		const std::lock_guard<std::mutex> lock(mut_);
+		auto&                             cached = entries_[key];
+		cached.id       = id;
+		cached.resident = true;
+	}
+
+	bool texture_cache::resident(const std::string& key) const {
+		const std::lock_guard<std::mutex> lock(mut_);
+		auto                              it = entries_.find(key);
+		return it != entries_.end() && it->second.resident;
+	}
+
+	uint texture_cache::id(const std::string& key) const {
+		const std::lock_guard<std::mutex> lock(mut_);
+		auto                              it = entries_.find(key);
+		return it != entries_.end() ? it->second.id : 0;
+	}
+
+} // namespace kanso
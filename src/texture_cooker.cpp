@@ -0,0 +1,206 @@
+#include "texture_cooker.hpp"
+#include "binary_io.hpp"
+#include "image_ops.hpp"
+#include "stb_image.h"
+
+#include <spdlog/spdlog.h>
+
+#include <array>
+#include <functional>
+
+namespace kanso {
+
+	namespace {
+
+		constexpr std::array<char, 4> CONTAINER_MAGIC   = { 'K', 'T', 'E', 'X' };
+		constexpr uint32_t            CONTAINER_VERSION = 1;
+
+		struct container_header {
+			std::array<char, 4> magic{};
+			uint32_t            version{};
+			uint32_t            format{};
+			uint32_t            width{};
+			uint32_t            height{};
+			uint32_t            nr_channels{};
+			uint32_t            level_count{};
+			uint32_t            path_size{};
+			int64_t             source_mtime{};
+			uint64_t            source_size{};
+			uint64_t            payload_size{};
+			uint64_t            payload_hash{};
+		};
+
+		// byte range of one mip level, offset is relative to the start of level data
+		struct level_index {
+			uint64_t offset{};
+			uint64_t size{};
+		};
+
+		bool valid_format(uint32_t format) {
+			return format <= static_cast<uint32_t>(block_format::bc7);
+		}
+
+		size_t expected_level_size(block_format format, uint32_t width, uint32_t height, uint32_t level) {
+			const size_t w = std::max<size_t>(width >> level, 1);
+			const size_t h = std::max<size_t>(height >> level, 1);
+			return ((w + 3) / 4) * ((h + 3) / 4) * block_bytes(format);
+		}
+
+	} // namespace
+
+	texture_cooker::texture_cooker(std::string cache_dir) : cache_dir_(std::move(cache_dir)) {}
+
+	std::string texture_cooker::entry_path(std::string_view path) const {
+		return fmt::format("{}/{:016x}.ktex", cache_dir_, std::hash<std::string_view>{}(path));
+	}
+
+	std::optional<compressed_texture> texture_cooker::load(std::string_view path) const {
+		int64_t  mtime{};
+		uint64_t size{};
+		if (!source_stamp(path, mtime, size)) {
+			return std::nullopt;
+		}
+
+		const auto        cache_path = entry_path(path);
+		const mapped_file file(cache_path);
+		if (file.data() == nullptr) {
+			return std::nullopt;
+		}
+
+		byte_reader      reader(file.data(), file.size());
+		container_header header;
+		if (!reader.read(header) || header.magic != CONTAINER_MAGIC || header.version != CONTAINER_VERSION ||
+		    !valid_format(header.format) || header.level_count == 0 || header.level_count > 32)
+		{
+			spdlog::warn("Cooked texture {} for {} is corrupt or outdated", cache_path, path);
+			return std::nullopt;
+		}
+
+		std::string cooked_path;
+		if (!reader.read(cooked_path, header.path_size) || cooked_path != path) {
+			return std::nullopt;
+		}
+
+		if (header.source_mtime != mtime || header.source_size != size) {
+			spdlog::debug("Cooked texture for {} is stale", path);
+			return std::nullopt;
+		}
+
+		const size_t payload_offset = reader.offset();
+		if (header.payload_size != file.size() - payload_offset ||
+		    header.payload_hash != fnv1a(file.data() + payload_offset, header.payload_size)) // NOLINT(*pointer-arithmetic)
+		{
+			spdlog::warn("Cooked texture {} for {} is corrupt", cache_path, path);
+			return std::nullopt;
+		}
+
+		std::vector<level_index> index;
+		if (!reader.read(index, header.level_count)) {
+			return std::nullopt;
+		}
+
+		compressed_texture texture;
+		texture.format      = static_cast<block_format>(header.format);
+		texture.width       = static_cast<int>(header.width);
+		texture.height      = static_cast<int>(header.height);
+		texture.nr_channels = static_cast<int>(header.nr_channels);
+		texture.levels.resize(header.level_count);
+
+		const size_t data_offset = reader.offset();
+		for (uint32_t level = 0; level < header.level_count; level++) {
+			const auto& entry = index[level];
+			if (entry.size != expected_level_size(texture.format, header.width, header.height, level) ||
+			    entry.offset > file.size() - data_offset || entry.size > file.size() - data_offset - entry.offset)
+			{
+				spdlog::warn("Cooked texture {} for {} is corrupt", cache_path, path);
+				return std::nullopt;
+			}
+			const auto* begin = file.data() + data_offset + entry.offset; // NOLINT(*pointer-arithmetic)
+			texture.levels[level].assign(begin, begin + entry.size);      // NOLINT(*pointer-arithmetic)
+		}
+
+		return texture;
+	}
+
+	std::optional<compressed_texture> texture_cooker::cook(std::string_view path, bool allow_bc7) const {
+		int      width{};
+		int      height{};
+		int      nr_channels{};
+		uint8_t* pixels = stbi_load(std::string{ path }.c_str(), &width, &height, &nr_channels, 0);
+		if (pixels == nullptr) {
+			spdlog::warn("Null texture {}", path);
+			return std::nullopt;
+		}
+
+		compressed_texture texture;
+		texture.format      = pick_block_format(nr_channels, allow_bc7);
+		texture.width       = width;
+		texture.height      = height;
+		texture.nr_channels = nr_channels;
+
+		auto image = expand_to_rgba(pixels, width, height, nr_channels);
+		stbi_image_free(pixels);
+
+		if (nr_channels == 2) {
+			// BC5 keeps two channels, grey in red and alpha in green
+			for (size_t i = 0; i < image.pixels.size(); i += 4) {
+				image.pixels[i + 1] = image.pixels[i + 3];
+			}
+		}
+
+		for (const auto& level : build_mip_chain(std::move(image))) {
+			texture.levels.push_back(compress_blocks(level.pixels.data(), level.width, level.height, texture.format));
+		}
+
+		store(path, texture);
+
+		spdlog::debug("Cooked {} to format {} with {} levels, {} KiB", path, static_cast<uint32_t>(texture.format),
+		              texture.levels.size(), texture.size() / 1024);
+		return texture;
+	}
+
+	void texture_cooker::store(std::string_view path, const compressed_texture& texture) const {
+		container_header header;
+		header.magic       = CONTAINER_MAGIC;
+		header.version     = CONTAINER_VERSION;
+		header.format      = static_cast<uint32_t>(texture.format);
+		header.width       = static_cast<uint32_t>(texture.width);
+		header.height      = static_cast<uint32_t>(texture.height);
+		header.nr_channels = static_cast<uint32_t>(texture.nr_channels);
+		header.level_count = static_cast<uint32_t>(texture.levels.size());
+		header.path_size   = static_cast<uint32_t>(path.size());
+		if (!source_stamp(path, header.source_mtime, header.source_size)) {
+			return;
+		}
+
+		std::vector<level_index> index;
+		uint64_t                 offset = 0;
+		for (const auto& level : texture.levels) {
+			index.push_back({ offset, level.size() });
+			offset += level.size();
+		}
+
+		// hash runs over level index followed by level data, same bytes as written below
+		const auto index_bytes = index.size() * sizeof(level_index);
+		uint64_t   hash        = fnv1a(reinterpret_cast<const uint8_t*>(index.data()), index_bytes); // NOLINT(*reinterpret-cast)
+		for (const auto& level : texture.levels) {
+			hash = fnv1a(level.data(), level.size(), hash);
+		}
+		header.payload_size = index_bytes + offset;
+		header.payload_hash = hash;
+
+		const auto cache_path = entry_path(path);
+		const bool written    = write_file_atomically(cache_path, [&](std::ostream& out) {
+			write(out, header);
+			out.write(path.data(), static_cast<std::streamsize>(path.size()));
+			write(out, index);
+			for (const auto& level : texture.levels) {
+				write(out, level);
+			}
+		});
+		if (!written) {
+			spdlog::warn("Failed to write cooked texture for {}", path);
+		}
+	}
+
+} // namespace kanso
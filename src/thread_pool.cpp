@@ -0,0 +1,343 @@
+#include "thread_pool.hpp"
+
+#include <spdlog/spdlog.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace kanso {
+
+	namespace {
+
+		constexpr int64_t INITIAL_DEQUE_CAPACITY = 256;
+		constexpr int     SPIN_ROUNDS            = 64; // steal attempts before worker sleeps
+
+		// job node while it is not in use
+		struct free_block {
+			free_block* next;
+		};
+
+		static_assert(sizeof(free_block) <= sizeof(job) && alignof(free_block) <= alignof(job));
+
+		void push_blocks(std::atomic<free_block*>& head, free_block* first, free_block* last) {
+			last->next = head.load(std::memory_order_relaxed);
+			while (!head.compare_exchange_weak(last->next, first, std::memory_order_release,
+			                                   std::memory_order_relaxed))
+			{
+			}
+		}
+
+		// Job nodes freed by any thread. Jobs usually finish on a worker while a render or main thread submits
+		// them, so nodes cannot stay with the thread that freed them. Nodes are only pushed one by one and taken
+		// all at once, so no node is ever popped alone and the list needs no ABA protection.
+		struct returned_blocks {
+			std::atomic<free_block*> head{ nullptr };
+
+			~returned_blocks() {
+				for (auto* block = head.exchange(nullptr); block != nullptr;) {
+					auto* next = block->next;
+					::operator delete(block, std::align_val_t{ alignof(job) });
+					block = next;
+				}
+			}
+		};
+
+		returned_blocks returned;
+
+		// nodes calling thread took from returned list, handed back when thread exits
+		struct job_cache {
+			free_block* blocks = nullptr;
+
+			job_cache() = default;
+
+			job_cache(const job_cache&)            = delete;
+			job_cache& operator=(const job_cache&) = delete;
+			job_cache(job_cache&&)                 = delete;
+			job_cache& operator=(job_cache&&)      = delete;
+
+			~job_cache() {
+				if (blocks == nullptr) {
+					return;
+				}
+				auto* last = blocks;
+				while (last->next != nullptr) {
+					last = last->next;
+				}
+				push_blocks(returned.head, blocks, last);
+			}
+		};
+
+		thread_local job_cache cache;
+
+		// set for workers, so pushes from inside jobs go to worker's own deque
+		thread_local const thread_pool* current_pool  = nullptr;
+		thread_local int                current_index = -1;
+
+		uint32_t next_random(uint32_t& state) {
+			// xorshift32
+			state ^= state << 13U;
+			state ^= state >> 17U;
+			state ^= state << 5U;
+			return state;
+		}
+
+		void pin_to_core(std::thread& thread, size_t core) {
+#if defined(__linux__)
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(core, &set);
+			if (pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) != 0) {
+				spdlog::warn("Failed to pin worker to core {}", core);
+			}
+#elif defined(_WIN32)
+			if (SetThreadAffinityMask(thread.native_handle(), DWORD_PTR{ 1 } << core) == 0) {
+				spdlog::warn("Failed to pin worker to core {}", core);
+			}
+#else
+			(void)thread;
+			(void)core;
+			spdlog::debug("Pinning workers is not supported on this platform");
+#endif
+		}
+
+	} // namespace
+
+	void* job::allocate() {
+		// heap is only hit while more jobs are in flight than ever before
+		if (cache.blocks == nullptr) {
+			cache.blocks = returned.head.exchange(nullptr, std::memory_order_acquire);
+		}
+		if (cache.blocks != nullptr) {
+			auto* block  = cache.blocks;
+			cache.blocks = block->next;
+			return block;
+		}
+		return ::operator new(sizeof(job), std::align_val_t{ alignof(job) });
+	}
+
+	void job::deallocate(void* block) {
+		auto* node = new (block) free_block{ nullptr };
+		push_blocks(returned.head, node, node);
+	}
+
+	work_stealing_deque::work_stealing_deque() {
+		rings_.push_back(std::make_unique<ring>(INITIAL_DEQUE_CAPACITY));
+		ring_.store(rings_.back().get(), std::memory_order_relaxed);
+	}
+
+	work_stealing_deque::~work_stealing_deque() = default;
+
+	void work_stealing_deque::push(job* task) {
+		const int64_t b = bottom_.load(std::memory_order_relaxed);
+		const int64_t t = top_.load(std::memory_order_acquire);
+		ring*         r = ring_.load(std::memory_order_relaxed);
+
+		if (b - t > r->capacity - 1) {
+			auto grown = std::make_unique<ring>(r->capacity * 2);
+			for (int64_t i = t; i < b; i++) {
+				grown->at(i).store(r->at(i).load(std::memory_order_relaxed), std::memory_order_relaxed);
+			}
+			r = grown.get();
+			rings_.push_back(std::move(grown));
+			ring_.store(r, std::memory_order_release);
+		}
+
+		r->at(b).store(task, std::memory_order_relaxed);
+		bottom_.store(b + 1, std::memory_order_release); // publishes job to thieves
+	}
+
+	job* work_stealing_deque::pop() {
+		const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+		ring*         r = ring_.load(std::memory_order_relaxed);
+		bottom_.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = top_.load(std::memory_order_relaxed);
+
+		if (t > b) {
+			bottom_.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		job* task = r->at(b).load(std::memory_order_relaxed);
+		if (t == b) {
+			// last item, race against thieves for it
+			if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				task = nullptr;
+			}
+			bottom_.store(b + 1, std::memory_order_relaxed);
+		}
+		return task;
+	}
+
+	job* work_stealing_deque::steal() {
+		int64_t t = top_.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64_t b = bottom_.load(std::memory_order_acquire);
+		if (t >= b) {
+			return nullptr;
+		}
+
+		ring* r    = ring_.load(std::memory_order_acquire);
+		job*  task = r->at(t).load(std::memory_order_relaxed);
+		if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			return nullptr;
+		}
+		return task;
+	}
+
+	thread_pool::thread_pool(size_t threads, bool pin_threads) {
+		states_.reserve(threads);
+		for (size_t i = 0; i < threads; ++i) {
+			states_.push_back(std::make_unique<worker_state>());
+		}
+
+		const size_t cores = std::max(std::thread::hardware_concurrency(), 1U);
+		workers_.reserve(threads);
+		for (size_t i = 0; i < threads; ++i) {
+			workers_.emplace_back([this, i] { worker_loop(i); });
+			if (pin_threads) {
+				pin_to_core(workers_.back(), i % cores);
+			}
+		}
+	}
+
+	thread_pool::~thread_pool() {
+		{
+			const std::lock_guard<std::mutex> lock(sleep_mutex_);
+			stop_ = true;
+		}
+		wake_.notify_all();
+		for (std::thread& worker : workers_) {
+			worker.join();
+		}
+	}
+
+	int thread_pool::worker_index() const {
+		return current_pool == this ? current_index : -1;
+	}
+
+	void thread_pool::push(job* task) {
+		const int index = worker_index();
+		if (index >= 0) {
+			states_[static_cast<size_t>(index)]->deque.push(task);
+		} else {
+			const std::lock_guard<std::mutex> lock(injected_mutex_);
+			injected_.push_back(task);
+		}
+		wake(1);
+	}
+
+	void thread_pool::push_batch(job* const* tasks, size_t count) {
+		if (count == 0) {
+			return;
+		}
+		const int index = worker_index();
+		if (index >= 0) {
+			for (size_t i = 0; i < count; i++) {
+				states_[static_cast<size_t>(index)]->deque.push(tasks[i]); // NOLINT(*pointer-arithmetic)
+			}
+		} else {
+			const std::lock_guard<std::mutex> lock(injected_mutex_);
+			injected_.insert(injected_.end(), tasks, tasks + count); // NOLINT(*pointer-arithmetic)
+		}
+		wake(static_cast<int64_t>(count));
+	}
+
+	void thread_pool::wake(int64_t count) {
+		// pending_ and sleeping_ are both seq_cst, so either sleeper sees new jobs or we see sleeper
+		pending_.fetch_add(count);
+		if (sleeping_.load() == 0) {
+			return;
+		}
+
+		const std::lock_guard<std::mutex> lock(sleep_mutex_);
+		if (count == 1) {
+			wake_.notify_one();
+		} else {
+			wake_.notify_all();
+		}
+	}
+
+	job* thread_pool::find_job(size_t index, uint32_t& seed) {
+		job* task = nullptr;
+		if (index < states_.size()) {
+			task = states_[index]->deque.pop();
+		}
+
+		if (task == nullptr && pending_.load(std::memory_order_relaxed) > 0) {
+			const std::lock_guard<std::mutex> lock(injected_mutex_);
+			if (!injected_.empty()) {
+				task = injected_.front();
+				injected_.pop_front();
+			}
+		}
+
+		// random starting victim, so thieves don't all hit the same worker
+		const size_t count = states_.size();
+		const size_t start = count > 0 ? next_random(seed) % count : 0;
+		for (size_t i = 0; task == nullptr && i < count; i++) {
+			const size_t victim = (start + i) % count;
+			if (victim != index) {
+				task = states_[victim]->deque.steal();
+			}
+		}
+
+		if (task != nullptr) {
+			pending_.fetch_sub(1, std::memory_order_relaxed);
+		}
+		return task;
+	}
+
+	void thread_pool::run(job* task) {
+		(*task)();
+		task->~job();
+		job::deallocate(task);
+	}
+
+	bool thread_pool::run_one() {
+		const int index = worker_index();
+		// NOLINTNEXTLINE(*reinterpret-cast)
+		thread_local uint32_t seed = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&seed)) | 1U;
+
+		job* task = find_job(index >= 0 ? static_cast<size_t>(index) : states_.size(), seed);
+		if (task == nullptr) {
+			return false;
+		}
+		run(task);
+		return true;
+	}
+
+	void thread_pool::worker_loop(size_t index) {
+		current_pool  = this;
+		current_index = static_cast<int>(index);
+		uint32_t seed = static_cast<uint32_t>(index) * 2654435761U + 1U;
+
+		for (;;) {
+			job* task = nullptr;
+			for (int round = 0; task == nullptr && round < SPIN_ROUNDS; round++) {
+				task = find_job(index, seed);
+				if (task == nullptr && pending_.load(std::memory_order_relaxed) == 0) {
+					break;
+				}
+			}
+
+			if (task != nullptr) {
+				run(task);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(sleep_mutex_);
+			sleeping_.fetch_add(1);
+			wake_.wait(lock, [this] { return stop_ || pending_.load() > 0; });
+			sleeping_.fetch_sub(1);
+			if (stop_ && pending_.load() == 0) {
+				return;
+			}
+		}
+	}
+
+} // namespace kanso
@@ -0,0 +1,267 @@
+#include "triangle_bvh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+
+namespace kanso {
+
+	namespace {
+
+		// cost of visiting a node relative to testing one triangle
+		constexpr float TRAVERSAL_COST = 1.0f;
+
+		// parallel rays and triangles seen edge on are missed
+		constexpr float MIN_DETERMINANT = 1e-12f;
+
+		struct bounds {
+			glm::vec3 min{ std::numeric_limits<float>::max() };
+			glm::vec3 max{ -std::numeric_limits<float>::max() };
+
+			void grow(const glm::vec3& point) {
+				min = glm::min(min, point);
+				max = glm::max(max, point);
+			}
+
+			void grow(const bounds& other) {
+				min = glm::min(min, other.min);
+				max = glm::max(max, other.max);
+			}
+
+			// half of surface area, 0 while empty
+			[[nodiscard]] float area() const {
+				const glm::vec3 size = glm::max(max - min, glm::vec3(0.0f));
+				return size.x * size.y + size.y * size.z + size.z * size.x;
+			}
+		};
+
+		struct bin {
+			bounds box;
+			size_t count = 0;
+		};
+
+		// centroids in bins below plane go left
+		struct split {
+			int    axis = -1; // -1 if centroids do not spread along any axis
+			float  cost = std::numeric_limits<float>::max();
+			size_t plane{};
+			float  min{};
+			float  scale{};
+		};
+
+		// range of triangles still to be split, node is already allocated
+		struct build_task {
+			uint32_t node;
+			uint32_t first;
+			uint32_t count;
+		};
+
+		// bin a centroid falls in along axis of centroid bounds
+		size_t bin_of(float centroid, float min, float scale) {
+			return std::min(static_cast<size_t>(std::max((centroid - min) * scale, 0.0f)), BVH_BINS - 1);
+		}
+
+		split find_split(const std::vector<uint32_t>& triangles, uint32_t first, uint32_t count,
+		                 const std::vector<bounds>& boxes, const std::vector<glm::vec3>& centroids) {
+			bounds centroid_bounds;
+			for (uint32_t i = first; i < first + count; i++) {
+				centroid_bounds.grow(centroids[triangles[i]]);
+			}
+
+			split best;
+			for (int axis = 0; axis < 3; axis++) {
+				const float min    = centroid_bounds.min[axis];
+				const float extent = centroid_bounds.max[axis] - min;
+				if (extent <= 0.0f) {
+					continue;
+				}
+
+				const float               scale = static_cast<float>(BVH_BINS) / extent;
+				std::array<bin, BVH_BINS> bins{};
+				for (uint32_t i = first; i < first + count; i++) {
+					auto& target = bins[bin_of(centroids[triangles[i]][axis], min, scale)];
+					target.box.grow(boxes[triangles[i]]);
+					target.count++;
+				}
+
+				// sweeps from both ends, every plane between two bins costs its sides' area times triangles
+				std::array<float, BVH_BINS - 1> left_cost{};
+				bounds                          left;
+				size_t                          left_count = 0;
+				for (size_t plane = 0; plane < BVH_BINS - 1; plane++) {
+					left.grow(bins[plane].box);
+					left_count += bins[plane].count;
+					left_cost[plane] = left.area() * static_cast<float>(left_count);
+				}
+				bounds right;
+				size_t right_count = 0;
+				for (size_t plane = BVH_BINS - 1; plane > 0; plane--) {
+					right.grow(bins[plane].box);
+					right_count += bins[plane].count;
+					const float cost = left_cost[plane - 1] + right.area() * static_cast<float>(right_count);
+					if (right_count < count && cost < best.cost) {
+						best = { axis, cost, plane, min, scale };
+					}
+				}
+			}
+			return best;
+		}
+
+		float entry_distance(const triangle_bvh::node& node, const glm::vec3& origin, const glm::vec3& inv_direction) {
+			const glm::vec3 t_min = (node.min - origin) * inv_direction;
+			const glm::vec3 t_max = (node.max - origin) * inv_direction;
+			const glm::vec3 t1    = glm::min(t_min, t_max);
+			const glm::vec3 t2    = glm::max(t_min, t_max);
+			const float     entry = std::max(std::max(t1.x, t1.y), std::max(t1.z, 0.0f));
+			const float     exit  = std::min(std::min(t2.x, t2.y), t2.z);
+			return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+		}
+
+	} // namespace
+
+	triangle_bvh::triangle_bvh(std::vector<node> nodes, std::vector<uint32_t> triangles)
+	    : nodes_(std::move(nodes)),
+	      triangles_(std::move(triangles)) {}
+
+	triangle_bvh triangle_bvh::build(const std::vector<mesh_vertex>& vertices, const std::vector<int>& indices) {
+		triangle_bvh bvh;
+		const auto   triangle_count = static_cast<uint32_t>(indices.size() / 3);
+		if (triangle_count == 0) {
+			return bvh;
+		}
+
+		std::vector<bounds>    boxes(triangle_count);
+		std::vector<glm::vec3> centroids(triangle_count);
+		for (uint32_t i = 0; i < triangle_count; i++) {
+			for (size_t corner = 0; corner < 3; corner++) {
+				boxes[i].grow(vertices[static_cast<size_t>(indices[3 * i + corner])].pos);
+			}
+			centroids[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+		}
+
+		bvh.triangles_.resize(triangle_count);
+		for (uint32_t i = 0; i < triangle_count; i++) {
+			bvh.triangles_[i] = i;
+		}
+
+		// at most 2n - 1 nodes, so reserved storage never moves while tasks hold indices
+		bvh.nodes_.reserve(2 * static_cast<size_t>(triangle_count) - 1);
+		bvh.nodes_.push_back({});
+		std::vector<build_task> tasks{ { 0, 0, triangle_count } };
+		while (!tasks.empty()) {
+			const auto task = tasks.back();
+			tasks.pop_back();
+
+			bounds box;
+			for (uint32_t i = task.first; i < task.first + task.count; i++) {
+				box.grow(boxes[bvh.triangles_[i]]);
+			}
+			auto& current = bvh.nodes_[task.node];
+			current       = { box.min, task.first, box.max, task.count };
+			if (task.count == 1) {
+				continue;
+			}
+
+			// small leaves stay unless a split pays for the extra node, large ones are split whenever possible
+			const auto  best       = find_split(bvh.triangles_, task.first, task.count, boxes, centroids);
+			const float leaf_cost  = static_cast<float>(task.count);
+			const float split_cost = TRAVERSAL_COST + best.cost / std::max(box.area(), 1e-30f);
+			if (best.axis < 0 || (task.count <= BVH_MAX_LEAF_SIZE && split_cost >= leaf_cost)) {
+				continue;
+			}
+
+			const auto begin  = bvh.triangles_.begin() + task.first;
+			const auto middle = std::partition(begin, begin + task.count, [&](uint32_t triangle) {
+				return bin_of(centroids[triangle][best.axis], best.min, best.scale) < best.plane;
+			});
+			const auto left_count = static_cast<uint32_t>(middle - begin);
+			if (left_count == 0 || left_count == task.count) {
+				continue;
+			}
+
+			const auto left = static_cast<uint32_t>(bvh.nodes_.size());
+			current.offset  = left;
+			current.count   = 0;
+			bvh.nodes_.emplace_back();
+			bvh.nodes_.emplace_back();
+			tasks.push_back({ left, task.first, left_count });
+			tasks.push_back({ left + 1, task.first + left_count, task.count - left_count });
+		}
+		bvh.nodes_.shrink_to_fit();
+		return bvh;
+	}
+
+	std::optional<triangle_bvh::hit> triangle_bvh::intersect(const std::vector<mesh_vertex>& vertices,
+	                                                         const std::vector<int>& indices, const glm::vec3& origin,
+	                                                         const glm::vec3& direction, float max_distance) const {
+		std::optional<hit> best;
+		if (nodes_.empty()) {
+			return best;
+		}
+
+		const glm::vec3 inv_direction = 1.0f / direction;
+		float           best_distance = max_distance;
+
+		// nearer child first, children entered beyond best hit so far are skipped
+		auto enter = [this, &origin, &inv_direction](uint32_t index) {
+			return std::pair{ index, entry_distance(nodes_[index], origin, inv_direction) };
+		};
+		std::vector<std::pair<uint32_t, float>> stack{ enter(0) };
+		while (!stack.empty()) {
+			const auto [index, entry] = stack.back();
+			stack.pop_back();
+			if (entry >= best_distance) {
+				continue;
+			}
+
+			const auto& current = nodes_[index];
+			if (current.count == 0) {
+				auto nearer  = enter(current.offset);
+				auto farther = enter(current.offset + 1);
+				if (farther.second < nearer.second) {
+					std::swap(nearer, farther);
+				}
+				if (farther.second < best_distance) {
+					stack.push_back(farther);
+				}
+				if (nearer.second < best_distance) {
+					stack.push_back(nearer);
+				}
+				continue;
+			}
+
+			// Moller-Trumbore, https://www.graphics.cornell.edu/pubs/1997/MT97.pdf
+			for (uint32_t i = current.offset; i < current.offset + current.count; i++) {
+				const uint32_t  triangle = triangles_[i];
+				const glm::vec3 a        = vertices[static_cast<size_t>(indices[3 * triangle])].pos;
+				const glm::vec3 ab       = vertices[static_cast<size_t>(indices[3 * triangle + 1])].pos - a;
+				const glm::vec3 ac       = vertices[static_cast<size_t>(indices[3 * triangle + 2])].pos - a;
+
+				const glm::vec3 p           = glm::cross(direction, ac);
+				const float     determinant = glm::dot(ab, p);
+				if (std::abs(determinant) < MIN_DETERMINANT) {
+					continue;
+				}
+				const float     inv_determinant = 1.0f / determinant;
+				const glm::vec3 to_origin       = origin - a;
+				const float     u               = glm::dot(to_origin, p) * inv_determinant;
+				if (u < 0.0f || u > 1.0f) {
+					continue;
+				}
+				const glm::vec3 q = glm::cross(to_origin, ab);
+				const float     v = glm::dot(direction, q) * inv_determinant;
+				if (v < 0.0f || u + v > 1.0f) {
+					continue;
+				}
+				const float distance = glm::dot(ac, q) * inv_determinant;
+				if (distance >= 0.0f && distance < best_distance) {
+					best_distance = distance;
+					best          = hit{ triangle, distance, { u, v } };
+				}
+			}
+		}
+		return best;
+	}
+
+} // namespace kanso
@@ -0,0 +1,40 @@
+#include "upload_queue.hpp"
+
+namespace kanso {
+
+	void upload_queue::push(size_t bytes, std::function<void()> upload) {
+		const std::lock_guard<std::mutex> lock(mut_);
+		jobs_.push_back({ bytes, std::move(upload) });
+	}
+
+	size_t upload_queue::drain(size_t byte_budget) {
+		size_t uploaded = 0;
+
+		while (uploaded < byte_budget) {
+			upload_job job;
+			{
+				const std::lock_guard<std::mutex> lock(mut_);
+				if (jobs_.empty()) {
+					break;
+				}
+				if (uploaded > 0 && uploaded + jobs_.front().bytes > byte_budget) {
+					break;
+				}
+				job = std::move(jobs_.front());
+				jobs_.pop_front();
+			}
+
+			// jobs may push follow-up work, so run them without holding the lock
+			job.upload();
+			uploaded += job.bytes;
+		}
+
+		return uploaded;
+	}
+
+	bool upload_queue::empty() const {
+		const std::lock_guard<std::mutex> lock(mut_);
+		return jobs_.empty();
+	}
+
+} // namespace kanso
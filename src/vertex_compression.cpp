@@ -0,0 +1,86 @@
+#include "vertex_compression.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace kanso {
+
+	vertex_layout make_compact_layout(const std::vector<mesh_vertex>& vertices) {
+		vertex_layout layout;
+		layout.format = vertex_format::compact;
+		if (vertices.empty()) {
+			return layout;
+		}
+
+		glm::vec3 min = vertices.front().pos;
+		glm::vec3 max = vertices.front().pos;
+		for (const auto& vertex : vertices) {
+			min = glm::min(min, vertex.pos);
+			max = glm::max(max, vertex.pos);
+		}
+
+		layout.offset = min;
+		layout.scale  = max - min;
+		return layout;
+	}
+
+	std::vector<compact_vertex> pack_vertices(const std::vector<mesh_vertex>& vertices, const vertex_layout& layout) {
+		glm::vec3 inv_scale{ 0.0f };
+		for (int i = 0; i < 3; i++) {
+			inv_scale[i] = layout.scale[i] > 0.0f ? 1.0f / layout.scale[i] : 0.0f;
+		}
+
+		std::vector<compact_vertex> packed;
+		packed.reserve(vertices.size());
+		for (const auto& vertex : vertices) {
+			compact_vertex out;
+
+			const auto pos = glm::clamp((vertex.pos - layout.offset) * inv_scale, 0.0f, 1.0f);
+			for (int i = 0; i < 3; i++) {
+				out.pos[static_cast<size_t>(i)] = glm::packUnorm1x16(pos[i]);
+			}
+
+			const auto normal = encode_octahedral(vertex.normal);
+			out.normal        = { static_cast<int16_t>(glm::packSnorm1x16(normal.x)),
+			                      static_cast<int16_t>(glm::packSnorm1x16(normal.y)) };
+
+			out.tex_coords = { glm::packHalf1x16(vertex.tex_coords.x), glm::packHalf1x16(vertex.tex_coords.y) };
+
+			packed.push_back(out);
+		}
+		return packed;
+	}
+
+	glm::vec2 encode_octahedral(const glm::vec3& normal) {
+		const float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+		if (l1 == 0.0f) {
+			return glm::vec2{ 0.0f };
+		}
+
+		glm::vec2 p{ normal.x / l1, normal.y / l1 };
+		if (normal.z < 0.0f) {
+			// fold lower hemisphere over diagonals
+			const glm::vec2 folded{ (1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+			                        (1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f) };
+			p = folded;
+		}
+		return p;
+	}
+
+	bool fits_short_indices(size_t vertex_count) {
+		return vertex_count <= std::numeric_limits<uint16_t>::max();
+	}
+
+	size_t vertex_stride(vertex_format format) {
+		return format == vertex_format::compact ? sizeof(compact_vertex) : sizeof(mesh_vertex);
+	}
+
+	size_t index_stride(size_t vertex_count) {
+		return fits_short_indices(vertex_count) ? sizeof(uint16_t) : sizeof(uint32_t);
+	}
+
+} // namespace kanso
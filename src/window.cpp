@@ -3,6 +3,7 @@
 #include "core.hpp"
 #include "renderer.hpp"
 
+#include <array>
 #include <iostream>
 #include <fstream>
 
@@ -13,6 +14,17 @@ namespace kanso {
 
 	void parse_json(int& framebuf_width, int& framebuf_height, std::string& title);
 
+	namespace {
+
+		// newest first, compute shaders behind GPU culling need 4.3 and older drivers still get the 4.1 renderer
+#ifdef __APPLE__
+		constexpr std::array<int, 1> CONTEXT_MINOR_VERSIONS = { 1 };
+#else
+		constexpr std::array<int, 4> CONTEXT_MINOR_VERSIONS = { 6, 5, 3, 1 };
+#endif
+
+	} // namespace
+
 	glfw_window::glfw_window() : renderer_(renderer_factory::make_renderer()) {
 		auto err_callback = [](int code, const char* err_str) {
 			std::cerr << "GLFW error: (" << code << "): " << err_str << std::endl;
@@ -31,7 +43,6 @@ namespace kanso {
 		}
 
 		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
 
 #ifdef __APPLE__
 		glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -45,7 +56,17 @@ namespace kanso {
 
 		parse_json(framebuf_width, framebuf_height, title);
 
-		window_ = glfwCreateWindow(framebuf_width, framebuf_height, title.c_str(), nullptr, nullptr);
+		for (const int minor : CONTEXT_MINOR_VERSIONS) {
+			// versions the driver lacks are expected to fail, only the last one is worth reporting
+			const bool last = minor == CONTEXT_MINOR_VERSIONS.back();
+			glfwSetErrorCallback(last ? static_cast<GLFWerrorfun>(err_callback) : nullptr);
+			glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
+			window_ = glfwCreateWindow(framebuf_width, framebuf_height, title.c_str(), nullptr, nullptr);
+			if (window_ != nullptr) {
+				break;
+			}
+		}
+		glfwSetErrorCallback(err_callback);
 		width_  = framebuf_width;
 		height_ = framebuf_height;
 
@@ -61,6 +82,7 @@ namespace kanso {
 			glfwTerminate();
 			throw std::runtime_error("Failed to initialize GLAD");
 		}
+		spdlog::info("OpenGL {}.{} context created", GLVersion.major, GLVersion.minor);
 
 		renderer_->enable_depth();
 		renderer_->enable_stencil(0xff);